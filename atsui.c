@@ -53,18 +53,245 @@ Copyright 
 
 */ 
 
+#include <pthread.h>
+
 #include "globals.h"
 #include "atsui.h"
+#include "dilate.h"
+#include "glyphcache.h"
+#include "policy.h"
+#include "displist.h"
+#include "textsource.h"
+#include "textstore.h"
+#include "fontruns.h"
+#include "stylepool.h"
+#include "strokecal.h"
+#include "trace.h"
 
-// Globals for just this source module
+// Globals for just this source module.  gFont and gPointSize make up the base
+// style, which text is in unless it is given a style of its own; gStyle is its
+// ATSUI style, and gBoldfaceStyle that of its boldface partner.  The two are only
+// ever replaced, in UpdateATSUIStyle(), never changed.
 //
 static ATSUStyle			gStyle = NULL;
-static CFStringRef			gString = NULL;
-static UniChar				*gText = NULL;
+static ATSUStyle			gBoldfaceStyle = NULL;
+static const UniChar		*gText = NULL;
 static UniCharCount			gLength = 0;
 static Fixed				gPointSize;
 static ATSUFontID			gFont = 0;
 
+// gText and gLength are the text in gTextStore, which is changed by edits that say
+// what they changed.  gTextBuffer holds a string's characters while they are compared
+// with the stored text, when CF does not hand them out directly.  A text file is only
+// ever decoded a window at a time; the store holds the start of its first paragraph.
+//
+static TextStore			gTextStore = { NULL, 0, 0 };
+static UniChar				*gTextBuffer = NULL;
+static UniCharCount			gTextBufferCapacity = 0;
+static TextSource			gTextSourceStorage;
+static TextSource			*gTextSource = NULL;		// NULL unless the text came from a file
+
+// At most this much of a text file's first paragraph is shown in the window
+//
+#define kViewWindowUnits		4096
+
+// Text from a file is broken into lines for printing this many paragraphs at a time
+//
+#define kPrintWindowParagraphs	1024
+
+// Every style the text has been set in, each stored once.  A style's ATSUI style,
+// CGFont and coverage are made when it is added and kept as long as the pool, so
+// everything made from the text is stored with a StyleID.  gStyleRuns says which
+// part of gText is in which style.  Once there are more than kMaxStyles the pool is
+// started over with just the styles the text is in; see CompactStyles().
+//
+typedef struct {
+    ATSUStyle			style;				// Its refCon is the StyleID
+    ATSUFontID			font;				// The font the glyphs are in
+    CGFontRef			cgFont;
+    const FontCoverage	*coverage;			// The characters the font has glyphs for
+    StyleID				boldface;			// The style in boldface; kNoStyle until asked for
+    Boolean				doubleStruck;		// Boldface without a bold face: drawn twice, a pixel apart
+    Boolean				hasCalibration;		// The font and size are in gStrokeCalibration
+    float				calibratedFactor;	// From gStrokeCalibration, if they are
+} MyStyleObjects;
+
+static StylePool			gStylePool = { NULL, 0, 0, NULL, 0 };
+static MyStyleObjects		*gStyleObjects = NULL;		// Indexed by StyleID
+static StyleID				gStyleObjectsCapacity = 0;
+static StyleRuns			gStyleRuns = { NULL, 0, 0, 0 };
+static StyleID				gBaseStyle = kNoStyle;
+static StyleID				gBoldfaceBaseStyle = kNoStyle;
+
+#define kMaxStyles				64
+
+// Fonts ATSUI picked for characters the fonts of the styles have no glyphs for.
+// They are kept for the life of the app, so ATSUI is asked about a character at
+// most once.  Text one of them covers is set in its style, in the fallback font.
+//
+typedef struct {
+    ATSUFontID			font;
+    const FontCoverage	*coverage;
+} MyFallbackFont;
+
+#define kMaxFallbackFonts	31
+static MyFallbackFont		gFallbackFonts[kMaxFallbackFonts];
+static int					gNumFallbackFonts = 0;
+
+// The stroke factors sbcalibrate measured for each font and size band, mapped from
+// the app's resources.  Empty if the app has none, and every font is emboldened by
+// the slider's factor.
+//
+static StrokeCalibration	gStrokeCalibration = { NULL, 0, 0, 0, NULL, NULL, NULL, 0 };
+
+// The coverage of every font looked at so far, made from its 'cmap' once, and the
+// characters that stay in the font although its 'cmap' does not cover them, because
+// ATSUI found no better font for them
+//
+typedef struct MyFontCoverage {
+    ATSUFontID				font;
+    FontCoverage			coverage;
+    FontCoverage			unmatched;			// Empty until ATSUI is first asked
+    struct MyFontCoverage	*next;
+} MyFontCoverage;
+
+static MyFontCoverage		*gFontCoverages = NULL;
+static const FontCoverage	gNoCoverage = { NULL, 0 };
+
+// Shaping results for a layout of gText, produced by ShapeText() and kept until the
+// text or the styles change.  The glyphs and positions are also stored in the form
+// CGContextShowGlyphsAtPositions() wants them.
+//
+typedef struct {
+    MyGlyphRecord		*records;
+    CGGlyph				*glyphs;
+    CGPoint				*positions;
+    StyleID				*styles;			// The style of each glyph
+    ItemCount			count;
+    float				width;
+    float				ascent;
+    float				descent;
+    Boolean				valid;
+} MyShapedText;
+
+// The text in its styles, for box 1 and the emboldened box 2, and in the boldface
+// partners of its styles, for box 2 when it shows the kATSUQDBoldfaceTag look
+//
+static MyShapedText			gShapedText = { NULL, NULL, NULL, NULL, 0, 0, 0, 0, false };
+static MyShapedText			gBoldfaceText = { NULL, NULL, NULL, NULL, 0, 0, 0, 0, false };
+
+// The text layout is created once and kept for the life of the app.  Changes to the
+// text, the style or the line width are recorded here and only applied to the layout
+// the next time it is needed, so a live resize that does not change the width
+// (or a redraw that changes nothing) does no ATSUI work at all.
+//
+typedef struct {
+    ATSUTextLayout		layout;				// NULL until first needed
+    Boolean				textChanged;		// gText was replaced
+    Boolean				styleChanged;		// The styles were changed
+    ATSUTextMeasurement	width;				// The kATSULineWidthTag value currently set
+    Boolean				boldface;			// The text is set in the boldface partners of its styles
+} MyLayoutCache;
+
+static MyLayoutCache		gLayoutCache = { NULL, true, true, 0, false };
+static MyLayoutCache		gBoldfaceLayoutCache = { NULL, true, true, 0, true };
+
+// Printing lays the text out again, broken into lines at the width of the page.
+// It gets its own layout so that printing does not disturb the one on screen.
+//
+static MyLayoutCache		gPrintLayoutCache = { NULL, true, true, 0, false };
+
+// The printed lines, kept until the style or the line width change.  An edit to the
+// text only breaks the paragraphs it touched again.
+//
+static ItemCount			gNumLines = 0;
+static ItemCount			gLineCapacity = 0;
+static float				gLineBreakWidth = 0;
+static float				gLineHeight = 0;		// Ascent plus descent
+static float				gLineAscent = 0;
+static Boolean				gLineBreaksValid = false;
+
+// The glyphs of every printed line, taken out of the layout along with the line
+// breaks.  Line i's glyphs are gLineGlyphs[gLineGlyphStarts[i]] up to the start of
+// line i + 1, positioned from the start of the line.  The pages of text in memory
+// are recorded straight from here on other threads, so nothing here changes while
+// a document is printed.
+//
+static CGGlyph				*gLineGlyphs = NULL;
+static CGPoint				*gLinePositions = NULL;
+static StyleID				*gLineGlyphStyles = NULL;
+static ItemCount			*gLineGlyphStarts = NULL;	// gNumLines + 1 entries
+static UniCharArrayOffset	*gLineTextStarts = NULL;	// Where each line starts in the text
+static ItemCount			gNumLineGlyphs = 0;
+static ItemCount			gLineGlyphCapacity = 0;
+
+// Text from a file can be too big to keep the glyphs of every line, so only where each
+// line starts is kept, along with where each window of paragraphs starts.  The
+// glyphs of the lines being printed are laid out again by PrepareATSUIStuffLines().
+//
+typedef struct {
+    ItemCount				firstLine;
+    size_t					paragraph;				// The window's first paragraph in the file
+    UniCharArrayOffset		base;					// Where the window starts in the whole text
+} MyLineWindow;
+
+static MyLineWindow			*gLineWindows = NULL;
+static ItemCount			gNumLineWindows = 0;
+static ItemCount			gLineWindowCapacity = 0;
+static Boolean				gKeepLineGlyphs = true;	// False while a file is broken into lines
+
+// Every printed line is drawn twice, regular and then emboldened, followed by half
+// a line of space.  This is the height of that pair, in lines.
+//
+#define kLinePairHeight		2.5
+
+// Emboldened glyph outlines, ready to be filled.  This is an open hash table keyed
+// by style and glyph ID.  Styles never change, so it is only flushed when
+// gEmboldenedFactor does.  The table is shared with the threads recording printed
+// pages, so it is only used with gEmboldenedGlyphsLock held.
+//
+#define EmboldenedGlyphKey(style, glyph)	(((UInt32) (style) << 16) | (glyph))
+
+typedef struct {
+    UInt32				glyph;				// EmboldenedGlyphKey()
+    CGPathRef			path;				// NULL marks an empty slot
+} MyEmboldenedGlyph;
+
+static MyEmboldenedGlyph	*gEmboldenedGlyphs = NULL;
+static UInt32				gEmboldenedGlyphsCapacity = 0;
+static UInt32				gEmboldenedGlyphsCount = 0;
+static float				gEmboldenedFactor = 0;
+static pthread_mutex_t		gEmboldenedGlyphsLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Rendered glyph masks for drawing on screen.  Each entry's userData is a CGImage
+// mask made from its pixels.
+//
+static GlyphCache			gGlyphBitmaps;
+static Boolean				gGlyphBitmapsReady = false;
+
+// The text in the two boxes, recorded once and played back on every draw.  Each
+// line is recorded with its origin at (0, 0), so a draw only has to translate it
+// to the middle of its box; a live resize does no layout, shaping or rendering.
+// The lists are recorded again when the text, the style or anything below changes;
+// a change of stroke factor only affects the bold box, so only its list goes.
+//
+typedef struct {
+    MyDisplayList		regular;			// The line in box 1
+    MyDisplayList		bold;				// The line in box 2
+    float				boldWidth;			// The width of the line in box 2
+    Boolean				valid;				// Both lists are up to date
+    Boolean				useStrokeMethod;	// What the lists were recorded with
+    UInt32				emboldenMethod;
+    float				strokeFactor;
+} MyRetainedText;
+
+static MyRetainedText		gRetainedText;
+
+static ATSCubicMoveToUPP	gMoveToUPP = NULL;
+static ATSCubicLineToUPP	gLineToUPP = NULL;
+static ATSCubicCurveToUPP	gCurveToUPP = NULL;
+static ATSCubicClosePathUPP	gClosePathUPP = NULL;
+
 
 // Sets the font
 //
@@ -82,186 +309,2556 @@ void SetATSUIStuffFontSize(Fixed inSize)
 }
 
 
-// Updates the ATSUI style to the current font and size
+// Releases all cached emboldened outlines
 //
-void UpdateATSUIStyle(void)
+static void FlushEmboldenedGlyphs(void)
 {
-    ATSUAttributeTag		tags[2];
-    ByteCount				sizes[2];
-    ATSUAttributeValuePtr	values[2];
+    UInt32					i;
 
-    tags[0] = kATSUFontTag;
-    sizes[0] = sizeof(ATSUFontID);
-    values[0] = &gFont;
-    
-    tags[1] = kATSUSizeTag;
-    sizes[1] = sizeof(Fixed);
-    values[1] = &gPointSize;
-    
-    verify_noerr( ATSUSetAttributes(gStyle, 2, tags, sizes, values) );
+    for (i = 0; i < gEmboldenedGlyphsCapacity; i++) {
+        if (gEmboldenedGlyphs[i].path != NULL) {
+            CGPathRelease(gEmboldenedGlyphs[i].path);
+            gEmboldenedGlyphs[i].path = NULL;
+        }
+    }
+    gEmboldenedGlyphsCount = 0;
 }
 
 
-// Sets up the text based on the specified CFString
+// Finds the slot for a glyph in the emboldened outline table
 //
-void UpdateATSUIStuffString(CFStringRef string)
+static MyEmboldenedGlyph *FindEmboldenedGlyphSlot(MyEmboldenedGlyph *table, UInt32 capacity, UInt32 glyph)
 {
-    free(gText);
-    gLength = CFStringGetLength(string);
-    gText = (UniChar *)malloc(gLength * sizeof(UniChar));
-    CFStringGetCharacters(string, CFRangeMake(0, gLength), gText);
+    UInt32					i = (glyph * 40503U) & (capacity - 1);
+
+    while (table[i].path != NULL && table[i].glyph != glyph)
+        i = (i + 1) & (capacity - 1);
+    return &table[i];
 }
 
 
-// Creates the ATSUI data
+// Adds an outline to the table, growing it when it gets half full
 //
-void SetUpATSUIStuff(void)
-{    
-    CFStringRef	string = CFSTR("Hello World!");
-	UpdateATSUIStuffString(string);
-	
-    verify_noerr( ATSUCreateStyle(&gStyle) );
-    UpdateATSUIStyle();
-    
-    gLength = CFStringGetLength(string);
-    gText = (UniChar *)malloc(gLength * sizeof(UniChar));
-    CFStringGetCharacters(string, CFRangeMake(0, gLength), gText);
+static void AddEmboldenedGlyph(UInt32 glyph, CGPathRef path)
+{
+    MyEmboldenedGlyph		*slot;
+
+    if ((gEmboldenedGlyphsCount + 1) * 2 > gEmboldenedGlyphsCapacity) {
+        UInt32				newCapacity = (gEmboldenedGlyphsCapacity == 0) ? 256 : gEmboldenedGlyphsCapacity * 2;
+        MyEmboldenedGlyph	*newTable = (MyEmboldenedGlyph *) calloc(newCapacity, sizeof(MyEmboldenedGlyph));
+        UInt32				i;
+
+        if (newTable == NULL) {
+            CGPathRelease(path);
+            return;
+        }
+        for (i = 0; i < gEmboldenedGlyphsCapacity; i++) {
+            if (gEmboldenedGlyphs[i].path != NULL)
+                *FindEmboldenedGlyphSlot(newTable, newCapacity, gEmboldenedGlyphs[i].glyph) = gEmboldenedGlyphs[i];
+        }
+        free(gEmboldenedGlyphs);
+        gEmboldenedGlyphs = newTable;
+        gEmboldenedGlyphsCapacity = newCapacity;
+    }
+
+    slot = FindEmboldenedGlyphSlot(gEmboldenedGlyphs, gEmboldenedGlyphsCapacity, glyph);
+    slot->glyph = glyph;
+    slot->path = path;
+    gEmboldenedGlyphsCount++;
 }
 
 
-// Sets kATSUQDBoldfaceTag for the given style
+// Maps a glyph path point to Quartz coordinates (glyph paths have Y pointing down)
 //
-void MySetBoldfaceTag(ATSUStyle iStyle)
+static void MyTransformPoint(const MyCurveCallbackData *data, const Float32Point *pt, float *x, float *y)
 {
-    Boolean					setToTrue = true;
-    ATSUAttributeTag		tag = kATSUQDBoldfaceTag;
-    ByteCount				size = sizeof(Boolean);
-    ATSUAttributeValuePtr	value = (ATSUAttributeValuePtr) &setToTrue;
-    
-    verify_noerr( ATSUSetAttributes(iStyle, 1, &tag, &size, &value) );
+    *x = data->origin.x + pt->x;
+    *y = data->windowHeight - (data->origin.y + pt->y);
 }
 
 
-// Sets kATSUQDBoldfaceTag for the given style
+// Curve callbacks for ATSUGlyphGetCubicPaths().  They collect the glyph's contours
+// in a GlyphOutline so it can be emboldened.
 //
-void MyClearBoldfaceTag(ATSUStyle iStyle)
+static OSStatus MyCubicMoveTo(const Float32Point *pt, void *callBackDataPtr)
+{
+    MyCurveCallbackData		*data = (MyCurveCallbackData *) callBackDataPtr;
+    float					x, y;
+
+    MyTransformPoint(data, pt, &x, &y);
+    GlyphOutlineMoveTo(data->outline, x, y);
+    data->first = false;
+    data->current = *pt;
+    return noErr;
+}
+
+
+static OSStatus MyCubicLineTo(const Float32Point *pt, void *callBackDataPtr)
+{
+    MyCurveCallbackData		*data = (MyCurveCallbackData *) callBackDataPtr;
+    float					x, y;
+
+    // Filter out degenerate segments
+    if (pt->x == data->current.x && pt->y == data->current.y)
+        return noErr;
+
+    MyTransformPoint(data, pt, &x, &y);
+    GlyphOutlineLineTo(data->outline, x, y);
+    data->current = *pt;
+    return noErr;
+}
+
+
+static OSStatus MyCubicCurveTo(const Float32Point *pt1, const Float32Point *pt2, const Float32Point *pt3, void *callBackDataPtr)
+{
+    MyCurveCallbackData		*data = (MyCurveCallbackData *) callBackDataPtr;
+    float					x1, y1, x2, y2, x3, y3;
+
+    MyTransformPoint(data, pt1, &x1, &y1);
+    MyTransformPoint(data, pt2, &x2, &y2);
+    MyTransformPoint(data, pt3, &x3, &y3);
+    GlyphOutlineCubicTo(data->outline, x1, y1, x2, y2, x3, y3);
+    data->current = *pt3;
+    return noErr;
+}
+
+
+static OSStatus MyCubicClosePath(void *callBackDataPtr)
 {
-    ATSUAttributeTag		tag = kATSUQDBoldfaceTag;
+    MyCurveCallbackData		*data = (MyCurveCallbackData *) callBackDataPtr;
 
-    verify_noerr( ATSUClearAttributes(iStyle, 1, &tag) );
+    GlyphOutlineClose(data->outline);
+    return noErr;
 }
 
 
-// Checks the global preference to see if text at the specified point size
-// will be drawn antialiased or not.
+// Converts an outline to a CGPath, keeping its curves
 //
-// Note that iSize is of type Fixed!
+static CGPathRef CreatePathFromOutline(const GlyphOutline *outline)
+{
+    CGMutablePathRef		path = CGPathCreateMutable();
+    const RasterPoint		*p = outline->points;
+    int						c, i, start = 0;
+
+    for (c = 0; c < outline->numContours; c++) {
+        int					end = outline->contourEnds[c];
+        const RasterPoint	*first = &p[start];
+
+        CGPathMoveToPoint(path, NULL, first->x, first->y);
+        for (i = start + 1; i < end; ) {
+            if (outline->tags[i] == kGlyphOutlineQuadControl) {
+                const RasterPoint	*to = (i + 1 < end) ? &p[i + 1] : first;
+                CGPathAddQuadCurveToPoint(path, NULL, p[i].x, p[i].y, to->x, to->y);
+                i += 2;
+            }
+            else if (outline->tags[i] == kGlyphOutlineCubicControl && i + 1 < end) {
+                const RasterPoint	*to = (i + 2 < end) ? &p[i + 2] : first;
+                CGPathAddCurveToPoint(path, NULL, p[i].x, p[i].y, p[i + 1].x, p[i + 1].y, to->x, to->y);
+                i += 3;
+            }
+            else {
+                CGPathAddLineToPoint(path, NULL, p[i].x, p[i].y);
+                i++;
+            }
+        }
+        CGPathCloseSubpath(path);
+        start = end;
+    }
+    return path;
+}
+
+
+// Returns the stroke width / point size a style is emboldened by when the slider is
+// at inSliderFactor: its own, if it is synthetic bold; the factor measured for its
+// font and size, scaled by the slider, if there is one; otherwise the slider's
 //
-Boolean IsAntiAliased(Fixed iSize)
+static float GetCalibratedStrokeFactor(StyleID inStyle, float inSliderFactor)
 {
-    Boolean					keyExistsAndHasValidFormat;
-    CFIndex					value;
+    const StyleAttributes	*attributes = StylePoolGet(&gStylePool, inStyle);
 
-    value = CFPreferencesGetAppIntegerValue(CFSTR("AppleAntiAliasingThreshold"), kCFPreferencesCurrentApplication, &keyExistsAndHasValidFormat);
+    if (attributes->syntheticBold)
+        return attributes->strokeFactor;
+    if (gStyleObjects[inStyle].hasCalibration)
+        return gStyleObjects[inStyle].calibratedFactor * inSliderFactor / kDefaultStrokeThicknessFactor;
+    return inSliderFactor;
+}
 
-    if (keyExistsAndHasValidFormat)
-        return (Fix2X(iSize) > value); // 'value' is the maximum not-antialiasing size
-    else
-        return true;
+
+static float GetStyleStrokeFactor(StyleID inStyle)
+{
+    return GetCalibratedStrokeFactor(inStyle, gStrokeThicknessFactor);
 }
 
 
-void DrawATSUIStuff(CGContextRef inContext, HIRect bounds)
+// Returns the heaviest stroke factor any glyph of the shaped text is emboldened by
+// when the slider is at inSliderFactor.  Text in a fallback font can have a
+// different factor from the base style.
+//
+static float GetShapedTextStrokeFactor(float inSliderFactor)
 {
-    float								windowHeight, windowWidth, quarter;
-    Boolean								needToUseCGStrokeMethod;
-	HIRect								box1, box2;
-	HIThemeTextInfo						textInfo = { 0 };
-	ATSUTextLayout						layout;
-	ATSUAttributeTag					tags[3];
-	ByteCount							sizes[3];
-	ATSUAttributeValuePtr				values[3];
-	Fixed								flush;
-	ATSUTextMeasurement					width;
-	
-    // Divide the window into vertical quarters, and draw the text in the middle two quarters
-    windowHeight = bounds.size.height;
-	windowWidth = bounds.size.width;
-    quarter = windowHeight / 4.0;	// 1/4 window height
-	
-	// Set up box 1
-	box1 = bounds;
-	box1.origin.y += ((windowHeight / 4.0) * 2.0);
-	box1.size.height -= (windowHeight / 4.0);
-	CGContextStrokeRect(inContext, box1);
-	
-	// Set up box 2
-	box2 = bounds;
-	box2.origin.y += (windowHeight / 4.0);
-	box2.size.height -= ((windowHeight / 4.0) * 2.0);
-	CGContextStrokeRect(inContext, box2);
+    float					factor = GetCalibratedStrokeFactor(gBaseStyle, inSliderFactor), styleFactor;
+    StyleID					last = gBaseStyle;
+    ItemCount				i;
 
-	// Create an ATSUI Layout object
-	verify_noerr( ATSUCreateTextLayout(&layout) );
-	
-	// Attatch text to layout
-	verify_noerr( ATSUSetTextPointerLocation(layout, gText, kATSUFromTextBeginning, kATSUToTextEnd, gLength) );
-	
-	// Combine the ATSU Style and Layout together
-	verify_noerr( ATSUSetRunStyle(layout, gStyle, kATSUFromTextBeginning, kATSUToTextEnd) );
-	
-	// Add CGContext to ATSU object
-	tags[0] = kATSUCGContextTag;
-	sizes[0] = sizeof(CGContextRef);
-	values[0] = &inContext;
-	
-	// Make the text centered...
-	flush = kATSUCenterAlignment;
-	tags[1] = kATSULineFlushFactorTag;
-	sizes[1] = sizeof(flush);
-	values[1] = &flush;
-	
-	// Within the width of the box
-	width = X2Fix(bounds.size.width);
-	tags[2] = kATSULineWidthTag;
-	sizes[2] = sizeof(ATSUTextMeasurement);
-	values[2] = &width;
-	
-	verify_noerr( ATSUSetLayoutControls(layout, 3, tags, sizes, values) );
-	
-    // Draw the text once without the extra bold	
-	verify_noerr(ATSUDrawText(layout, kATSUFromTextBeginning, kATSUToTextEnd, X2Fix(box1.origin.x), X2Fix((box1.origin.y + box1.size.height) / 2.0)));
+    for (i = 0; i < gShapedText.count; i++) {
+        if (gShapedText.styles[i] == last)
+            continue;
+        last = gShapedText.styles[i];
+        styleFactor = GetCalibratedStrokeFactor(last, inSliderFactor);
+        if (styleFactor > factor)
+            factor = styleFactor;
+    }
+    return factor;
+}
+
+
+// Creates the outline of a glyph in a style as a CGPath with its origin at (0, 0),
+// grown by 'distance' on every side
+//
+static CGPathRef CreateGlyphPath(StyleID style, GlyphID glyph, float distance)
+{
+    MyCurveCallbackData		data;
+    GlyphOutline			outline;
+    CGPathRef				path;
+    OSStatus				callbackResult;
+
+    if (gMoveToUPP == NULL) {
+        gMoveToUPP = NewATSCubicMoveToUPP(MyCubicMoveTo);
+        gLineToUPP = NewATSCubicLineToUPP(MyCubicLineTo);
+        gCurveToUPP = NewATSCubicCurveToUPP(MyCubicCurveTo);
+        gClosePathUPP = NewATSCubicClosePathUPP(MyCubicClosePath);
+    }
+
+    GlyphOutlineInit(&outline);
+    data.origin.x = data.origin.y = 0;
+    data.windowHeight = 0;
+    data.first = true;
+    data.current = data.origin;
+    data.outline = &outline;
+
+    verify_noerr( ATSUGlyphGetCubicPaths(gStyleObjects[style].style, glyph, gMoveToUPP, gLineToUPP, gCurveToUPP, gClosePathUPP, &data, &callbackResult) );
+    GlyphOutlineEmbolden(&outline, distance);
+
+    path = CreatePathFromOutline(&outline);
+    GlyphOutlineDispose(&outline);
+    return path;
+}
+
+
+// Returns the emboldened outline of a glyph, with its origin at (0, 0).  The
+// outline is offset by half the stroke width, which gives the same weight as
+// stroking with kCGTextFillStroke.  Outlines are computed once and cached.
+// gEmboldenedGlyphsLock must be held.
+//
+static CGPathRef GetEmboldenedGlyphPath(StyleID style, GlyphID glyph)
+{
+    const StyleAttributes	*attributes = StylePoolGet(&gStylePool, style);
+    UInt32					key = EmboldenedGlyphKey(style, glyph);
+    MyEmboldenedGlyph		*slot;
+    CGPathRef				path;
+
+    // The emboldened outlines depend on the stroke factor, which the slider changes directly
+    if (gEmboldenedFactor != gStrokeThicknessFactor) {
+        FlushEmboldenedGlyphs();
+        gEmboldenedFactor = gStrokeThicknessFactor;
+    }
+
+    if (gEmboldenedGlyphsCapacity != 0) {
+        slot = FindEmboldenedGlyphSlot(gEmboldenedGlyphs, gEmboldenedGlyphsCapacity, key);
+        if (slot->path != NULL)
+            return slot->path;
+    }
+
+    path = CreateGlyphPath(style, glyph, GetStyleStrokeFactor(style) * Fix2X(attributes->size) / 2.0);
+    AddEmboldenedGlyph(key, path);
+    return path;
+}
+
+
+// Same as GetEmboldenedGlyphPath(), but takes the lock, so it is safe to call while
+// printed pages are being recorded on other threads.  The path is returned
+// retained, so it stays valid if another thread flushes the table.  The threads
+// recording pages find their outlines already made by PrepareATSUIStuffLines(), so
+// they only hold the lock for the lookup.
+//
+static CGPathRef CopyEmboldenedGlyphPath(StyleID style, GlyphID glyph)
+{
+    CGPathRef				path;
+
+    pthread_mutex_lock(&gEmboldenedGlyphsLock);
+    path = CGPathRetain(GetEmboldenedGlyphPath(style, glyph));
+    pthread_mutex_unlock(&gEmboldenedGlyphsLock);
+    return path;
+}
+
+
+// Frees the pixels of a dilated mask once CG is done with its image
+//
+static void MyReleaseMaskData(void *info, const void *data, size_t size)
+{
+    free((void *) data);
+}
 
-    needToUseCGStrokeMethod = gCurrentlyPrinting || IsAntiAliased(gPointSize);
-    if ( needToUseCGStrokeMethod )
+
+// Releases a cached glyph mask.  The mask's data provider frees the pixels.
+//
+static void MyReleaseGlyphBitmap(GlyphBitmap *bitmap)
+{
+    if (bitmap->userData != NULL)
+        CGImageRelease((CGImageRef) bitmap->userData);
+}
+
+
+// Renders a glyph into a new image mask, with the glyph origin (subX, subY) past
+// the bottom left corner of its (left, top - height) pixel.  Glyphs without ink
+// get an empty bitmap.
+//
+static void RenderGlyphBitmap(StyleID style, GlyphID glyph, Boolean antialias, Boolean emboldened, float subX, float subY, GlyphBitmap *outBitmap)
+{
+    static const CGFloat	decode[2] = { 1.0, 0.0 };		// Full coverage paints
+    CGPathRef				path;
+    CGRect					bounds;
+    CGColorSpaceRef			gray;
+    CGContextRef			bitmapContext;
+    CGDataProviderRef		provider;
+    unsigned char			*pixels;
+    int						left, bottom, width, height, rowBytes;
+
+    memset(outBitmap, 0, sizeof(GlyphBitmap));
+    path = emboldened ? CopyEmboldenedGlyphPath(style, glyph) : CreateGlyphPath(style, glyph, 0);
+    bounds = CGPathGetBoundingBox(path);
+    if ( CGRectIsEmpty(bounds) )
+	{
+        CGPathRelease(path);
+        return;
+    }
+
+    left = (int) floorf(bounds.origin.x + subX) - 1;
+    bottom = (int) floorf(bounds.origin.y + subY) - 1;
+    width = (int) ceilf(CGRectGetMaxX(bounds) + subX) + 1 - left;
+    height = (int) ceilf(CGRectGetMaxY(bounds) + subY) + 1 - bottom;
+    rowBytes = (width + 15) & ~15;
+
+    pixels = (unsigned char *) calloc(rowBytes, height);
+    gray = CGColorSpaceCreateDeviceGray();
+    bitmapContext = (pixels != NULL) ? CGBitmapContextCreate(pixels, width, height, 8, rowBytes, gray, kCGImageAlphaNone) : NULL;
+    if (bitmapContext != NULL)
 	{
-        CGContextSaveGState(inContext);
-        CGContextSetTextDrawingMode(inContext, kCGTextFillStroke);
-        CGContextSetLineWidth(inContext, gStrokeThicknessFactor * Fix2X(gPointSize));
-        // You might want to call CGContextSetStrokeColor() here,
-        // just to make certain it is the same as the text/fill color.
+        // Coverage is drawn white on black
+        CGContextSetShouldAntialias(bitmapContext, antialias);
+        CGContextSetGrayFillColor(bitmapContext, 1.0, 1.0);
+        CGContextTranslateCTM(bitmapContext, subX - left, subY - bottom);
+        CGContextAddPath(bitmapContext, path);
+        CGContextFillPath(bitmapContext);
+        CGContextRelease(bitmapContext);
+
+        // From here on the data provider owns the pixels
+        provider = CGDataProviderCreateWithData(NULL, pixels, rowBytes * height, MyReleaseMaskData);
+        outBitmap->userData = (void *) CGImageMaskCreate(width, height, 8, 8, rowBytes, provider, decode, false);
+        CGDataProviderRelease(provider);
+
+        if (outBitmap->userData != NULL)
+		{
+            outBitmap->pixels = pixels;
+            outBitmap->width = width;
+            outBitmap->height = height;
+            outBitmap->rowBytes = rowBytes;
+            outBitmap->left = left;
+            outBitmap->top = bottom + height;
+        }
     }
     else
-        MySetBoldfaceTag(gStyle); // This will look very strong on-screen when CG anti-aliasing is off
+        free(pixels);
+
+    CGColorSpaceRelease(gray);
+    CGPathRelease(path);
+}
+
+
+// Records the shaped glyphs with their line origin at (x, y) as rendered masks out
+// of the glyph cache.  Glyphs that are not in the cache yet are rendered first.  The
+// masks are placed on whole pixels, so this is only for drawing on screen.  Glyphs
+// in a synthetic bold style are emboldened either way.  The cache is keyed by style,
+// which stands for the font and size since styles never change.
+//
+static void RecordCachedGlyphs(MyDisplayList *list, const MyShapedText *text, float x, float y, Boolean antialias, Boolean emboldened)
+{
+    GlyphCacheKey			key;
+    GlyphBitmap				rendered;
+    ItemCount				i;
+    int						strike;
+    Boolean					uncached;
+
+    memset(&key, 0, sizeof(key));
+    key.antialias = antialias;
+
+    for (i = 0; i < text->count; i++) {
+        const StyleAttributes	*attributes = StylePoolGet(&gStylePool, text->styles[i]);
+        Boolean				bold = emboldened || attributes->syntheticBold;
+        const GlyphBitmap	*bitmap;
+        int					wholeX, wholeY;
+
+        key.fontID = text->styles[i];
+        key.pixelSize = Fix2X(attributes->size);
+        key.strokeFactor = bold ? GetStyleStrokeFactor(text->styles[i]) : 0;
+        key.bold = bold;
+        wholeX = GlyphCacheQuantize(x + text->records[i].relativeOrigin.x, &key.subpixelX);
+        wholeY = GlyphCacheQuantize(y + text->records[i].relativeOrigin.y, &key.subpixelY);
+        key.glyphID = text->records[i].glyphID;
 
-    // Draw the text again with the extra bold for comparison
-	verify_noerr( ATSUDrawText(layout, kATSUFromTextBeginning, kATSUToTextEnd, X2Fix(box2.origin.x), X2Fix((box2.origin.y + box2.size.height) / 2.0)) );
+        // A mask too big for the cache is recorded all the same, and released after
+        bitmap = GlyphCacheLookup(&gGlyphBitmaps, &key);
+        uncached = false;
+        if (bitmap == NULL)
+		{
+            RenderGlyphBitmap(text->styles[i], key.glyphID, antialias, bold, (float) key.subpixelX / kGlyphCacheSubpixelSteps,
+                              (float) key.subpixelY / kGlyphCacheSubpixelSteps, &rendered);
+            bitmap = GlyphCacheInsert(&gGlyphBitmaps, &key, &rendered);
+            if (bitmap == NULL)
+			{
+                bitmap = &rendered;
+                uncached = true;
+            }
+        }
 
-    // Undo the previous CG text mode setting
-    if ( needToUseCGStrokeMethod )
-        CGContextRestoreGState(inContext);
+        // The list keeps its own reference, so the cache is free to evict the mask
+        if (bitmap->userData != NULL)
+		{
+            for (strike = 0; strike <= gStyleObjects[text->styles[i]].doubleStruck; strike++)
+                verify_noerr( DisplayListAddImage(list, (CGImageRef) bitmap->userData, CGRectMake(wholeX + strike + bitmap->left, wholeY + bitmap->top - bitmap->height, bitmap->width, bitmap->height)) );
+        }
+        if (uncached)
+            MyReleaseGlyphBitmap(&rendered);
+    }
+}
+
+
+// Returns the glyph cache's hit, miss and eviction counts
+//
+void GetATSUIGlyphCacheStats(GlyphCacheStats *outStats)
+{
+    if (gGlyphBitmapsReady)
+        GlyphCacheGetStats(&gGlyphBitmaps, outStats);
     else
-        MyClearBoldfaceTag(gStyle);
+        memset(outStats, 0, sizeof(GlyphCacheStats));
+}
 
-    // Tear down the CGContext since we are done with it
-	CGContextFlush(inContext);
+
+// Remembers the run of the layout GetStyleAt() last looked up
+//
+typedef struct {
+    UniCharArrayOffset		start;
+    UniCharArrayOffset		end;
+    StyleID					style;
+} MyStyleCursor;
+
+
+// Returns the style of the character at inOffset in the layout.  Consecutive
+// glyphs are mostly in the same run, so ATSUI is only asked when the run changes.
+//
+static StyleID GetStyleAt(ATSUTextLayout layout, UniCharArrayOffset inOffset, MyStyleCursor *ioCursor)
+{
+    ATSUStyle				style;
+    URefCon					refCon;
+    UniCharArrayOffset		runStart;
+    UniCharCount			runLength;
+
+    if (inOffset >= ioCursor->start && inOffset < ioCursor->end)
+        return ioCursor->style;
+
+    ioCursor->style = gBaseStyle;
+    ioCursor->start = ioCursor->end = inOffset;
+    if ( ATSUGetRunStyle(layout, inOffset, &style, &runStart, &runLength) == noErr )
+	{
+        ioCursor->start = runStart;
+        ioCursor->end = runStart + runLength;
+        if ( ATSUGetStyleRefCon(style, &refCon) == noErr && refCon < gStylePool.count )
+            ioCursor->style = (StyleID) refCon;
+    }
+    return ioCursor->style;
 }
 
 
-// Disposes of the ATSUI data
+// Shapes the text in the layout into 'text'.  The work is done once; later calls
+// return at once until the text or the styles change.
 //
-void DisposeATSUIStuff(void)
+static void ShapeText(MyShapedText *text, ATSUTextLayout layout)
+{
+    ATSLayoutRecord			*records = NULL;
+    ItemCount				numRecords = 0, i, count;
+    ATSUTextMeasurement		before, after, ascent, descent;
+
+    if ( ! text->valid ) {
+        verify_noerr( ATSUDirectGetLayoutDataArrayPtrFromTextLayout(layout, 0, kATSUDirectDataLayoutRecordATSLayoutRecordCurrent, (void **) &records, &numRecords) );
+
+        free(text->records);
+        free(text->glyphs);
+        free(text->positions);
+        free(text->styles);
+        text->records = (MyGlyphRecord *) malloc((numRecords + 1) * sizeof(MyGlyphRecord));
+        text->glyphs = (CGGlyph *) malloc((numRecords + 1) * sizeof(CGGlyph));
+        text->positions = (CGPoint *) malloc((numRecords + 1) * sizeof(CGPoint));
+        text->styles = (StyleID *) malloc((numRecords + 1) * sizeof(StyleID));
+
+        // Deleted glyphs (including the end-of-line record) are left out
+        count = 0;
+        if (records != NULL && text->records != NULL && text->glyphs != NULL && text->positions != NULL && text->styles != NULL) {
+            MyStyleCursor		cursor = { 0, 0, kNoStyle };
+
+            for (i = 0; i < numRecords; i++) {
+                if (records[i].glyphID == kATSDeletedGlyphcode) continue;
+
+                text->styles[count] = GetStyleAt(layout, records[i].originalOffset / sizeof(UniChar), &cursor);
+
+                text->records[count].glyphID = records[i].glyphID;
+                text->records[count].relativeOrigin.x = Fix2X(records[i].realPos);
+                text->records[count].relativeOrigin.y = 0;
+                text->glyphs[count] = records[i].glyphID;
+                text->positions[count].x = text->records[count].relativeOrigin.x;
+                text->positions[count].y = 0;
+                count++;
+            }
+        }
+        if (records != NULL)
+            verify_noerr( ATSUDirectReleaseLayoutDataArrayPtr(NULL, kATSUDirectDataLayoutRecordATSLayoutRecordCurrent, (void **) &records) );
+        text->count = count;
+
+        // Remember the width of the line so it can be centered without asking ATSUI again
+        verify_noerr( ATSUGetUnjustifiedBounds(layout, kATSUFromTextBeginning, kATSUToTextEnd, &before, &after, &ascent, &descent) );
+        text->width = Fix2X(after - before);
+        text->ascent = Fix2X(ascent);
+        text->descent = Fix2X(descent);
+
+        text->valid = true;
+    }
+}
+
+
+// Shapes the text in the layout and returns its glyphs, with their origins relative
+// to the origin of the line.  The work is done once; later calls return the same
+// array until UpdateATSUIStuffString() or UpdateATSUIStyle() change something.
+//
+MyGlyphRecord *GetGlyphIDsAndPositions(ATSUTextLayout layout, ItemCount *outNumGlyphs)
+{
+    ShapeText(&gShapedText, layout);
+    *outNumGlyphs = gShapedText.count;
+    return gShapedText.records;
+}
+
+
+// Combines the emboldened outlines of a run of glyphs, with its line origin at
+// (x, y), into one path so the whole line is filled in a single pass.  Safe to call
+// from the threads recording printed pages.
+//
+static CGPathRef CreateEmboldenedLinePath(const StyleID *styles, const CGGlyph *glyphs, const CGPoint *positions, ItemCount count, float x, float y)
+{
+    CGMutablePathRef		line;
+    ItemCount				i;
+
+    line = CGPathCreateMutable();
+    for (i = 0; i < count; i++) {
+        CGAffineTransform	position;
+        CGPathRef			path;
+
+        position = CGAffineTransformMakeTranslation(x + positions[i].x, y + positions[i].y);
+        path = CopyEmboldenedGlyphPath(styles[i], glyphs[i]);
+        CGPathAddPath(line, &position, path);
+        CGPathRelease(path);
+    }
+    return line;
+}
+
+
+// Returns the length of the run of glyphs from inStart on that are all in the same
+// style
+//
+static ItemCount GetGlyphRunLength(const StyleID *styles, ItemCount inStart, ItemCount count)
+{
+    ItemCount				end;
+
+    for (end = inStart + 1; end < count && styles[end] == styles[inStart]; end++)
+        ;
+    return end - inStart;
+}
+
+
+// Draws a run of glyphs with their line origin at (x, y).  Glyphs in a synthetic
+// bold style are filled from their emboldened outlines.
+//
+static void DrawGlyphArray(CGContextRef inContext, const StyleID *styles, const CGGlyph *glyphs, const CGPoint *positions, ItemCount count, float x, float y)
+{
+    ItemCount				start, length;
+
+    CGContextSetTextMatrix(inContext, CGAffineTransformMakeTranslation(x, y));
+    for (start = 0; start < count; start += length) {
+        const StyleAttributes	*attributes = StylePoolGet(&gStylePool, styles[start]);
+
+        length = GetGlyphRunLength(styles, start, count);
+        if (attributes->syntheticBold)
+		{
+            CGPathRef		path = CreateEmboldenedLinePath(&styles[start], &glyphs[start], &positions[start], length, x, y);
+
+            CGContextAddPath(inContext, path);
+            CGContextFillPath(inContext);
+            CGPathRelease(path);
+        }
+        else
+		{
+            CGContextSetFont(inContext, gStyleObjects[styles[start]].cgFont);
+            CGContextSetFontSize(inContext, Fix2X(attributes->size));
+            CGContextShowGlyphsAtPositions(inContext, &glyphs[start], &positions[start], length);
+            if (gStyleObjects[styles[start]].doubleStruck)
+			{
+                CGContextSetTextMatrix(inContext, CGAffineTransformMakeTranslation(x + 1.0, y));
+                CGContextShowGlyphsAtPositions(inContext, &glyphs[start], &positions[start], length);
+                CGContextSetTextMatrix(inContext, CGAffineTransformMakeTranslation(x, y));
+            }
+        }
+    }
+}
+
+
+// Records a run of glyphs with their line origin at (x, y), as one item for each
+// style, or two for a double struck one
+//
+static void RecordGlyphArray(MyDisplayList *list, const StyleID *styles, const CGGlyph *glyphs, const CGPoint *positions, ItemCount count, float x, float y)
+{
+    ItemCount				start, length;
+
+    for (start = 0; start < count; start += length) {
+        const StyleAttributes	*attributes = StylePoolGet(&gStylePool, styles[start]);
+
+        length = GetGlyphRunLength(styles, start, count);
+        if (attributes->syntheticBold)
+		{
+            CGPathRef		path = CreateEmboldenedLinePath(&styles[start], &glyphs[start], &positions[start], length, x, y);
+
+            verify_noerr( DisplayListAddFillPath(list, path) );
+            CGPathRelease(path);
+        }
+        else
+		{
+            verify_noerr( DisplayListAddGlyphs(list, gStyleObjects[styles[start]].cgFont, Fix2X(attributes->size), &glyphs[start], &positions[start], length, x, y) );
+            if (gStyleObjects[styles[start]].doubleStruck)
+                verify_noerr( DisplayListAddGlyphs(list, gStyleObjects[styles[start]].cgFont, Fix2X(attributes->size), &glyphs[start], &positions[start], length, x + 1.0, y) );
+        }
+    }
+}
+
+
+// Draws the shaped glyphs with their line origin at (x, y)
+//
+static void DrawGlyphs(CGContextRef inContext, const MyShapedText *text, float x, float y)
 {
-    verify_noerr( ATSUDisposeStyle(gStyle) );
-    free(gText);
+    DrawGlyphArray(inContext, text->styles, text->glyphs, text->positions, text->count, x, y);
+}
+
+
+// Records one line of text, regular or emboldened.  The glyphs come out of the
+// glyph cache, or if there is none, are drawn from their outlines.
+//
+static void RecordLine(MyDisplayList *list, const MyShapedText *text, float x, float y, Boolean antialias, Boolean emboldened)
+{
+    if ( gGlyphBitmapsReady )
+        RecordCachedGlyphs(list, text, x, y, antialias, emboldened);
+    else if ( emboldened )
+	{
+        CGPathRef			line = CreateEmboldenedLinePath(text->styles, text->glyphs, text->positions, text->count, x, y);
+
+        verify_noerr( DisplayListAddFillPath(list, line) );
+        CGPathRelease(line);
+    }
+    else
+        RecordGlyphArray(list, text->styles, text->glyphs, text->positions, text->count, x, y);
+}
+
+
+// Records a fill of the current fill color through a coverage mask.  Takes
+// ownership of 'pixels'.
+//
+static void RecordCoverageMask(MyDisplayList *list, CGRect rect, unsigned char *pixels, size_t rowBytes, CGColorSpaceRef gray)
+{
+    CGDataProviderRef		provider;
+    CGImageRef				mask;
+
+    provider = CGDataProviderCreateWithData(NULL, pixels, rowBytes * (size_t) rect.size.height, MyReleaseMaskData);
+    mask = CGImageCreate((size_t) rect.size.width, (size_t) rect.size.height, 8, 8, rowBytes, gray, kCGImageAlphaNone, provider, NULL, false, kCGRenderingIntentDefault);
+
+    verify_noerr( DisplayListAddFillMask(list, mask, rect) );
+
+    CGImageRelease(mask);
+    CGDataProviderRelease(provider);
+}
+
+
+// Returns the radius the coverage of a style's glyphs is dilated by: what a stroke
+// of the style's factor * its own point size would add
+//
+static float GetStyleDilateRadius(StyleID inStyle)
+{
+    return DilateRadiusForStroke(GetStyleStrokeFactor(inStyle), Fix2X(StylePoolGet(&gStylePool, inStyle)->size));
+}
+
+
+// Draws the shaped glyphs with their line origin at (x, y) into a grayscale coverage
+// mask, white on black.  With inRadius at zero or more, only the glyphs whose style
+// is dilated by that radius are drawn.
+//
+static Boolean DrawCoverageMask(unsigned char *pixels, size_t width, size_t height, size_t rowBytes, CGColorSpaceRef gray, float x, float y, float inRadius)
+{
+    CGContextRef			maskContext;
+    ItemCount				start, length;
+
+    maskContext = CGBitmapContextCreate(pixels, width, height, 8, rowBytes, gray, kCGImageAlphaNone);
+    if (maskContext == NULL)
+        return false;
+    CGContextSetGrayFillColor(maskContext, 1.0, 1.0);
+    if (inRadius < 0)
+        DrawGlyphs(maskContext, &gShapedText, x, y);
+    else for (start = 0; start < gShapedText.count; start += length) {
+        length = GetGlyphRunLength(gShapedText.styles, start, gShapedText.count);
+        if (GetStyleDilateRadius(gShapedText.styles[start]) == inRadius)
+            DrawGlyphArray(maskContext, &gShapedText.styles[start], &gShapedText.glyphs[start], &gShapedText.positions[start], length, x, y);
+    }
+    CGContextRelease(maskContext);
+    return true;
+}
+
+
+// Makes the bold box's mask when the styles of the shaped text are not all dilated
+// by the same radius.  The glyphs of each radius are drawn and dilated on their
+// own, and outBold is the maximum of the results.
+//
+static Boolean DilateEachRadius(unsigned char *outBold, size_t width, size_t height, size_t rowBytes, CGColorSpaceRef gray, float x, float y)
+{
+    size_t					size = rowBytes * height, p;
+    unsigned char			*glyphs = (unsigned char *) malloc(size);
+    unsigned char			*dilated = (unsigned char *) calloc(rowBytes, height);
+    ItemCount				start, length, other;
+    Boolean					done = (glyphs != NULL && dilated != NULL);
+
+    if (done)
+        memset(outBold, 0, size);
+    for (start = 0; done && start < gShapedText.count; start += length) {
+        float				radius = GetStyleDilateRadius(gShapedText.styles[start]);
+
+        // Each radius is done at its first run
+        length = GetGlyphRunLength(gShapedText.styles, start, gShapedText.count);
+        for (other = 0; other < start; other += GetGlyphRunLength(gShapedText.styles, other, gShapedText.count)) {
+            if (GetStyleDilateRadius(gShapedText.styles[other]) == radius)
+                break;
+        }
+        if (other < start)
+            continue;
+
+        memset(glyphs, 0, size);
+        done = DrawCoverageMask(glyphs, width, height, rowBytes, gray, x, y, radius)
+            && DilateMask(glyphs, rowBytes, dilated, rowBytes, width, height, radius) == 0;
+        for (p = 0; done && p < size; p++) {
+            if (dilated[p] > outBold[p])
+                outBold[p] = dilated[p];
+        }
+    }
+
+    free(glyphs);
+    free(dilated);
+    return done;
+}
+
+
+// Records both boxes from one rendering of the glyphs.  The line is drawn once into a
+// grayscale coverage mask; the regular box is filled through that mask, and the
+// bold box through a copy of it dilated by the amount a stroke of each style's
+// factor * its point size would add.  Text in styles with different radii is
+// dilated a radius at a time.  The font is not touched again for the bold box
+// unless it has to be.  Only used on screen: the mask has a fixed resolution.
+// Returns the boxes that were recorded: the regular box is recorded even if the mask
+// could not be dilated, so only the bold box has to be made some other way then.
+//
+static UInt32 RecordDilatedGlyphs(MyDisplayList *regularList, MyDisplayList *boldList, float x, float y1, float y2)
+{
+    float					minRadius = -1, maxRadius = 0, radius, margin, maskX, maskY;
+    size_t					width, height, rowBytes;
+    CGColorSpaceRef			gray;
+    unsigned char			*regular, *bold;
+    ItemCount				start;
+    Boolean					dilated;
+    UInt32					recorded = 0;
+
+    for (start = 0; start < gShapedText.count; start += GetGlyphRunLength(gShapedText.styles, start, gShapedText.count)) {
+        radius = GetStyleDilateRadius(gShapedText.styles[start]);
+        if (minRadius < 0 || radius < minRadius)
+            minRadius = radius;
+        if (radius > maxRadius)
+            maxRadius = radius;
+    }
+    margin = ceilf(maxRadius) + 1.0;
+
+    width = (size_t) ceilf(gShapedText.width + 2.0 * margin) + 1;
+    height = (size_t) ceilf(gShapedText.ascent + gShapedText.descent + 2.0 * margin) + 1;
+    rowBytes = (width + 15) & ~15;
+    regular = (unsigned char *) calloc(rowBytes, height);
+    bold = (unsigned char *) malloc(rowBytes * height);
+    gray = CGColorSpaceCreateDeviceGray();
+    require( regular != NULL && bold != NULL && gray != NULL, CantCreateMask );
+
+    // The mask is placed on whole pixels; the fractional part of the position is
+    // applied to the glyphs instead
+    maskX = margin + (x - floorf(x));
+    maskY = margin + gShapedText.descent + (y1 - floorf(y1));
+    require( DrawCoverageMask(regular, width, height, rowBytes, gray, maskX, maskY, -1), CantCreateMask );
+
+    // Either list may be NULL if that box does not need recording again
+    if (boldList != NULL)
+	{
+        if (minRadius == maxRadius)
+            dilated = (DilateMask(regular, rowBytes, bold, rowBytes, width, height, maxRadius) == 0);
+        else
+            dilated = DilateEachRadius(bold, width, height, rowBytes, gray, maskX, maskY);
+        if (dilated)
+		{
+            RecordCoverageMask(boldList, CGRectMake(floorf(x) - margin, floorf(y2) - margin - gShapedText.descent, width, height), bold, rowBytes, gray);
+            bold = NULL;
+            recorded |= kATSUIStuffBoldBox;
+        }
+    }
+    if (regularList != NULL)
+	{
+        RecordCoverageMask(regularList, CGRectMake(floorf(x) - margin, floorf(y1) - margin - gShapedText.descent, width, height), regular, rowBytes, gray);
+        regular = NULL;
+        recorded |= kATSUIStuffRegularBox;
+    }
+
+CantCreateMask:
+    free(regular);
+    free(bold);
+    if (gray != NULL)
+        CGColorSpaceRelease(gray);
+    return recorded;
+}
+
+
+// Returns the coverage of a font, made from its 'cmap' table the first time
+//
+static const FontCoverage *GetFontCoverage(ATSUFontID inFont)
+{
+    MyFontCoverage			*entry;
+    ATSFontRef				atsFont = FMGetATSFontRefFromFont(inFont);
+    ByteCount				size = 0;
+    unsigned char			*cmap;
+
+    for (entry = gFontCoverages; entry != NULL; entry = entry->next) {
+        if (entry->font == inFont)
+            return &entry->coverage;
+    }
+
+    entry = (MyFontCoverage *) calloc(1, sizeof(MyFontCoverage));
+    if (entry == NULL)
+        return &gNoCoverage;
+    entry->font = inFont;
+
+    // A font whose 'cmap' cannot be read covers nothing, and is only used where
+    // ATSUI says so
+    cmap = NULL;
+    if ( ATSFontGetTable(atsFont, 'cmap', 0, 0, NULL, &size) == noErr && size > 0 )
+        cmap = (unsigned char *) malloc(size);
+    if ( cmap != NULL && ATSFontGetTable(atsFont, 'cmap', 0, size, cmap, &size) == noErr )
+        verify_noerr( FontCoverageInitFromCmap(&entry->coverage, cmap, size) );
+    else
+        verify_noerr( FontCoverageInit(&entry->coverage) );
+    free(cmap);
+
+    entry->next = gFontCoverages;
+    gFontCoverages = entry;
+    return &entry->coverage;
+}
+
+
+// Returns the characters left in a font although it does not cover them, or NULL
+// if GetFontCoverage() could not make an entry for the font
+//
+static FontCoverage *GetUnmatchedChars(ATSUFontID inFont)
+{
+    MyFontCoverage			*entry;
+
+    for (entry = gFontCoverages; entry != NULL; entry = entry->next) {
+        if (entry->font == inFont)
+            return &entry->unmatched;
+    }
+    return NULL;
+}
+
+
+// Maps the table of stroke factors, StrokeFactors.sbst in the app's resources.  It
+// is made by sbcalibrate from the fonts' real bold faces.
+//
+static void OpenStrokeCalibration(void)
+{
+    CFURLRef				url;
+    char					path[1024];
+
+    url = CFBundleCopyResourceURL(CFBundleGetMainBundle(), CFSTR("StrokeFactors"), CFSTR("sbst"), NULL);
+    if (url == NULL)
+        return;
+    if ( CFURLGetFileSystemRepresentation(url, true, (UInt8 *) path, sizeof(path)) )
+        StrokeCalibrationOpen(&gStrokeCalibration, path);
+    CFRelease(url);
+}
+
+
+// Looks up the stroke factor measured for a font at a size.  Returns false if it
+// was not measured.  The table knows fonts by their PostScript names.
+//
+static Boolean GetCalibratedFactorForFont(ATSUFontID inFont, float inPointSize, float *outFactor)
+{
+    CFStringRef				postScriptName = NULL;
+    char					name[256];
+    Boolean					found = false;
+
+    if (gStrokeCalibration.bytes == NULL)
+        return false;
+    if ( ATSFontGetPostScriptName(FMGetATSFontRefFromFont(inFont), kATSOptionFlagsDefault, &postScriptName) != noErr || postScriptName == NULL )
+        return false;
+    if ( CFStringGetCString(postScriptName, name, sizeof(name), kCFStringEncodingASCII) )
+        found = (StrokeCalibrationLookup(&gStrokeCalibration, name, inPointSize, outFactor) == 0);
+    CFRelease(postScriptName);
+    return found;
+}
+
+
+// Makes the ATSUI style, CGFont and coverage for a style that was just added to
+// the pool, and looks up its stroke factor.  A real bold style is set in the bold face of its font's family, if
+// the family has one, so its glyphs can be drawn from that face directly.  If not,
+// it gets kATSUQDBoldfaceTag, so ATSUI lays it out as QuickDraw boldface, and it is
+// drawn struck twice.
+//
+static Boolean CreateStyleObjects(StyleID inStyle)
+{
+    const StyleAttributes	*attributes = StylePoolGet(&gStylePool, inStyle);
+    MyStyleObjects			*objects = &gStyleObjects[inStyle];
+    ATSUFontID				font = attributes->font;
+    Fixed					size = attributes->size;
+    FMFontFamily			family;
+    FMFontStyle				fontStyle, boldStyle;
+    FMFont					boldFont;
+    ATSFontRef				atsFont;
+    Boolean					boldface = true;
+    ATSUAttributeTag		tags[3];
+    ByteCount				sizes[3];
+    ATSUAttributeValuePtr	values[3];
+
+    objects->boldface = attributes->realBold ? inStyle : kNoStyle;
+    objects->doubleStruck = false;
+    if ( attributes->realBold )
+	{
+        if ( FMGetFontFamilyInstanceFromFont(font, &family, &fontStyle) == noErr
+            && FMGetFontFromFontFamilyInstance(family, fontStyle | bold, &boldFont, &boldStyle) == noErr && (boldStyle & bold) != 0 )
+            font = boldFont;
+        else
+            objects->doubleStruck = true;
+    }
+
+    if ( ATSUCreateStyle(&objects->style) != noErr )
+        return false;
+
+    tags[0] = kATSUFontTag;
+    sizes[0] = sizeof(ATSUFontID);
+    values[0] = &font;
+
+    tags[1] = kATSUSizeTag;
+    sizes[1] = sizeof(Fixed);
+    values[1] = &size;
+
+    tags[2] = kATSUQDBoldfaceTag;
+    sizes[2] = sizeof(Boolean);
+    values[2] = &boldface;
+
+    verify_noerr( ATSUSetAttributes(objects->style, objects->doubleStruck ? 3 : 2, tags, sizes, values) );
+    verify_noerr( ATSUSetStyleRefCon(objects->style, inStyle) );
+
+    objects->calibratedFactor = 0;
+    objects->hasCalibration = GetCalibratedFactorForFont(attributes->font, Fix2X(size), &objects->calibratedFactor);
+
+    atsFont = FMGetATSFontRefFromFont(font);
+    objects->font = font;
+    objects->cgFont = CGFontCreateWithPlatformFont(&atsFont);
+    objects->coverage = GetFontCoverage(font);
+    return true;
+}
+
+
+// Returns the style with the given attributes, adding it to the pool the first
+// time.  Returns kNoStyle if it cannot be made.
+//
+static StyleID InternStyle(const StyleAttributes *inAttributes)
+{
+    StyleID					style = StylePoolIntern(&gStylePool, inAttributes);
+
+    if (style == kNoStyle)
+        return kNoStyle;
+
+    if (style >= gStyleObjectsCapacity)
+	{
+        StyleID				newCapacity = (gStyleObjectsCapacity == 0) ? 32 : gStyleObjectsCapacity * 2;
+        MyStyleObjects		*newObjects = (MyStyleObjects *) realloc(gStyleObjects, newCapacity * sizeof(MyStyleObjects));
+
+        if (newObjects == NULL)
+            return kNoStyle;
+        memset(&newObjects[gStyleObjectsCapacity], 0, (newCapacity - gStyleObjectsCapacity) * sizeof(MyStyleObjects));
+        gStyleObjects = newObjects;
+        gStyleObjectsCapacity = newCapacity;
+    }
+
+    if ( gStyleObjects[style].style == NULL && ! CreateStyleObjects(style) )
+        return kNoStyle;
+    return style;
+}
+
+
+// Returns the boldface partner of a style: the same style, real bold.  It is made
+// the first time it is asked for and remembered.
+//
+static StyleID GetBoldfaceStyle(StyleID inStyle)
+{
+    StyleAttributes			attributes;
+    StyleID					boldface;
+
+    if (gStyleObjects[inStyle].boldface != kNoStyle)
+        return gStyleObjects[inStyle].boldface;
+
+    attributes = *StylePoolGet(&gStylePool, inStyle);
+    attributes.realBold = true;
+    boldface = InternStyle(&attributes);
+    if (boldface == kNoStyle)
+        return inStyle;
+    gStyleObjects[inStyle].boldface = boldface;
+    return boldface;
+}
+
+
+// Returns the style that is inStyle in another font
+//
+static StyleID GetStyleInFont(StyleID inStyle, ATSUFontID inFont)
+{
+    StyleAttributes			attributes = *StylePoolGet(&gStylePool, inStyle);
+
+    attributes.font = inFont;
+    return InternStyle(&attributes);
+}
+
+
+// Returns the index of a font in gFallbackFonts, adding it if need be.  Returns -1
+// if there is no more room.
+//
+static int GetFallbackFont(ATSUFontID inFont)
+{
+    int						i;
+
+    for (i = 0; i < gNumFallbackFonts; i++) {
+        if (gFallbackFonts[i].font == inFont)
+            return i;
+    }
+    if (gNumFallbackFonts == kMaxFallbackFonts)
+        return -1;
+
+    gFallbackFonts[gNumFallbackFonts].font = inFont;
+    gFallbackFonts[gNumFallbackFonts].coverage = GetFontCoverage(inFont);
+    return gNumFallbackFonts++;
+}
+
+
+// Adds the characters from inStart up to inEnd to a font's unmatched characters
+//
+static void AddUnmatchedChars(FontCoverage *unmatched, const UniChar *inText, UniCharArrayOffset inStart, UniCharArrayOffset inEnd)
+{
+    UniCharArrayOffset		i;
+
+    if (unmatched == NULL || (unmatched->pages == NULL && FontCoverageInit(unmatched) != 0))
+        return;
+    for (i = inStart; i < inEnd; i++) {
+        unsigned long		c = inText[i];
+
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < inEnd && inText[i + 1] >= 0xDC00 && inText[i + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (inText[i + 1] - 0xDC00);
+            i++;
+        }
+        verify_noerr( FontCoverageAdd(unmatched, c, c) );
+    }
+}
+
+
+// Asks ATSUI which fonts have the characters from inStart up to inEnd, which are in
+// inStyle but not covered by any font so far, and adds them to the fallback fonts.
+// What ATSUI leaves in the style's font, or finds no font for, goes in the font's
+// unmatched characters.
+//
+static void MatchFallbackFonts(ATSUTextLayout layout, const UniChar *inText, UniCharArrayOffset inStart, UniCharArrayOffset inEnd, StyleID inStyle)
+{
+    FontCoverage			*unmatched = GetUnmatchedChars(gStyleObjects[inStyle].font);
+    UniCharArrayOffset		offset = inStart, changedOffset;
+    UniCharCount			changedLength;
+    ATSUFontID				font;
+    OSStatus				status;
+    unsigned long			c;
+    int						fallback;
+
+    verify_noerr( ATSUSetRunStyle(layout, gStyleObjects[inStyle].style, inStart, inEnd - inStart) );
+    while (offset < inEnd) {
+        status = ATSUMatchFontsToText(layout, offset, inEnd - offset, &font, &changedOffset, &changedLength);
+        if (status != kATSUFontsMatched && status != kATSUFontsNotMatched) {
+            AddUnmatchedChars(unmatched, inText, offset, inEnd);
+            break;
+        }
+        AddUnmatchedChars(unmatched, inText, offset, changedOffset);
+
+        // A font that does not cover the characters by its own 'cmap' would be asked
+        // about again every time, so they are left in the style's font too
+        c = inText[changedOffset];
+        if (c >= 0xD800 && c <= 0xDBFF && changedOffset + 1 < inEnd && inText[changedOffset + 1] >= 0xDC00 && inText[changedOffset + 1] <= 0xDFFF)
+            c = 0x10000 + ((c - 0xD800) << 10) + (inText[changedOffset + 1] - 0xDC00);
+        fallback = (status == kATSUFontsMatched) ? GetFallbackFont(font) : -1;
+        if (fallback < 0 || ! FontCoverageContains(gFallbackFonts[fallback].coverage, c))
+            AddUnmatchedChars(unmatched, inText, changedOffset, changedOffset + changedLength);
+
+        if (changedLength == 0)
+            break;
+        offset = changedOffset + changedLength;
+    }
+}
+
+
+// Sets the text of the layout from inStart up to inEnd, which is all in inStyle, in
+// fonts that have glyphs for it: the style's own font where it can, and otherwise
+// the style in a fallback font.  The runs are found from the fonts' coverage; ATSUI
+// is only asked about characters no font covers, and only the first time they are
+// seen.
+//
+static void ApplyFontRuns(ATSUTextLayout layout, const UniChar *inText, UniCharArrayOffset inStart, UniCharArrayOffset inEnd, StyleID inStyle)
+{
+    const FontCoverage		*coverages[kMaxFallbackFonts + 1];
+    FontRun					*runs;
+    StyleID					style;
+    size_t					numRuns, r;
+    Boolean					unmatched;
+    int						f, pass;
+
+    if (inStart >= inEnd)
+        return;
+    runs = (FontRun *) malloc((inEnd - inStart) * sizeof(FontRun));
+    if (runs == NULL)
+	{
+        verify_noerr( ATSUSetRunStyle(layout, gStyleObjects[inStyle].style, inStart, inEnd - inStart) );
+        return;
+    }
+
+    // Split the text, then if some of it is in no font, find fonts for it and split
+    // again.  Anything still not covered after that stays in the style's font.
+    for (pass = 0; pass < 2; pass++) {
+        coverages[0] = gStyleObjects[inStyle].coverage;
+        for (f = 0; f < gNumFallbackFonts; f++)
+            coverages[f + 1] = gFallbackFonts[f].coverage;
+        numRuns = FontRunsSplit(inText, inStart, inEnd, coverages, gNumFallbackFonts + 1, GetUnmatchedChars(gStyleObjects[inStyle].font), runs);
+
+        unmatched = false;
+        for (r = 0; r < numRuns && pass == 0; r++) {
+            if (runs[r].font < 0) {
+                MatchFallbackFonts(layout, inText, runs[r].start, runs[r].start + runs[r].length, inStyle);
+                unmatched = true;
+            }
+        }
+        if ( ! unmatched )
+            break;
+    }
+
+    for (r = 0; r < numRuns; r++) {
+        style = (runs[r].font <= 0) ? inStyle : GetStyleInFont(inStyle, gFallbackFonts[runs[r].font - 1].font);
+        if (style == kNoStyle)
+            style = inStyle;
+        verify_noerr( ATSUSetRunStyle(layout, gStyleObjects[style].style, runs[r].start, runs[r].length) );
+    }
+    free(runs);
+}
+
+
+// Sets the text of the layout from inStart up to inEnd in its styles, as given by
+// inRuns, or in their boldface partners.  Without runs, all of it is in the base
+// style.
+//
+static void ApplyStyleRuns(ATSUTextLayout layout, const UniChar *inText, UniCharArrayOffset inStart, UniCharArrayOffset inEnd, const StyleRuns *inRuns, Boolean inBoldface)
+{
+    const StyleRun			*run;
+    size_t					r;
+
+    if (inRuns == NULL || inRuns->count == 0)
+	{
+        ApplyFontRuns(layout, inText, inStart, inEnd, inBoldface ? gBoldfaceBaseStyle : gBaseStyle);
+        return;
+    }
+
+    for (r = StyleRunsFind(inRuns, inStart); r < inRuns->count && inRuns->runs[r].start < inEnd; r++) {
+        run = &inRuns->runs[r];
+        ApplyFontRuns(layout, inText, (run->start > inStart) ? run->start : inStart,
+                      (run->start + run->length < inEnd) ? run->start + run->length : inEnd,
+                      inBoldface ? GetBoldfaceStyle(run->style) : run->style);
+    }
+}
+
+
+// Disposes of the ATSUI styles and CGFonts of every style in a pool, and the
+// array that holds them
+//
+static void DisposeStyleObjects(MyStyleObjects *objects, StyleID capacity)
+{
+    StyleID					i;
+
+    for (i = 0; i < capacity; i++) {
+        if (objects[i].style != NULL)
+            verify_noerr( ATSUDisposeStyle(objects[i].style) );
+        if (objects[i].cgFont != NULL)
+            CGFontRelease(objects[i].cgFont);
+    }
+    free(objects);
+}
+
+
+// True if a style in the pool or a fallback font is in the font
+//
+static Boolean IsFontInUse(ATSUFontID inFont)
+{
+    StyleID					i;
+    int						f;
+
+    for (i = 0; i < gStylePool.count; i++) {
+        if (gStyleObjects[i].font == inFont)
+            return true;
+    }
+    for (f = 0; f < gNumFallbackFonts; f++) {
+        if (gFallbackFonts[f].font == inFont)
+            return true;
+    }
+    return false;
+}
+
+
+// Starts the style pool over once it holds more than kMaxStyles, keeping only the
+// styles the text is in.  Everything kept by StyleID goes with the old pool: the
+// emboldened outlines, the glyph masks and the coverage of fonts no longer used.
+// If the base style cannot be made in the new pool, the old one is kept.
+// The caller must have invalidated the layouts, the shaped text and the lines.
+//
+static void CompactStyles(void)
+{
+    StylePool				oldPool = gStylePool;
+    MyStyleObjects			*oldObjects = gStyleObjects;
+    StyleID					oldCapacity = gStyleObjectsCapacity, *map, base, i;
+    MyFontCoverage			**link;
+
+    if (oldPool.count <= kMaxStyles)
+        return;
+    map = (StyleID *) malloc(oldPool.count * sizeof(StyleID));
+    if (map == NULL)
+        return;
+    for (i = 0; i < oldPool.count; i++)
+        map[i] = kNoStyle;
+
+    // The new pool is made beside the old one.  The base style goes first, so a
+    // style that cannot be made again falls back to it.
+    StylePoolInit(&gStylePool);
+    gStyleObjects = NULL;
+    gStyleObjectsCapacity = 0;
+    base = InternStyle(StylePoolGet(&oldPool, gBaseStyle));
+    if (base == kNoStyle)
+	{
+        DisposeStyleObjects(gStyleObjects, gStyleObjectsCapacity);
+        StylePoolDispose(&gStylePool);
+        gStylePool = oldPool;
+        gStyleObjects = oldObjects;
+        gStyleObjectsCapacity = oldCapacity;
+        free(map);
+        return;
+    }
+
+    map[gBaseStyle] = base;
+    for (i = 0; i < gStyleRuns.count; i++) {
+        StyleID				style = gStyleRuns.runs[i].style;
+
+        if (map[style] == kNoStyle)
+            map[style] = InternStyle(StylePoolGet(&oldPool, style));
+        if (map[style] == kNoStyle)
+            map[style] = base;
+    }
+    StyleRunsMapStyles(&gStyleRuns, map);
+    gBaseStyle = base;
+    free(map);
+
+    pthread_mutex_lock(&gEmboldenedGlyphsLock);
+    FlushEmboldenedGlyphs();
+    pthread_mutex_unlock(&gEmboldenedGlyphsLock);
+    if (gGlyphBitmapsReady)
+        GlyphCacheFlush(&gGlyphBitmaps);
+    DisposeStyleObjects(oldObjects, oldCapacity);
+    StylePoolDispose(&oldPool);
+
+    for (link = &gFontCoverages; *link != NULL; ) {
+        MyFontCoverage		*entry = *link;
+
+        if ( IsFontInUse(entry->font) ) {
+            link = &entry->next;
+            continue;
+        }
+        *link = entry->next;
+        FontCoverageDispose(&entry->coverage);
+        FontCoverageDispose(&entry->unmatched);
+        free(entry);
+    }
+
+    gBoldfaceBaseStyle = GetBoldfaceStyle(gBaseStyle);
+    gStyle = gStyleObjects[gBaseStyle].style;
+    gBoldfaceStyle = gStyleObjects[gBoldfaceBaseStyle].style;
+}
+
+
+// Marks everything made from the text in its styles as out of date
+//
+static void InvalidateATSUIStuffStyles(void)
+{
+    gLayoutCache.styleChanged = true;
+    gBoldfaceLayoutCache.styleChanged = true;
+    gPrintLayoutCache.styleChanged = true;
+    gShapedText.valid = gBoldfaceText.valid = false;
+    gRetainedText.valid = false;
+    gLineBreaksValid = false;
+}
+
+
+// Updates the base style to the current font and size, and makes its boldface
+// partner.  This is the only place the pair is replaced; drawing never changes a
+// style.  Text in the old base style moves to the new one; text that was given a
+// style of its own keeps it.
+//
+void UpdateATSUIStyle(void)
+{
+    StyleAttributes			attributes;
+    StyleID					style;
+
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.font = gFont;
+    attributes.size = gPointSize;
+    style = InternStyle(&attributes);
+    if (style == kNoStyle || style == gBaseStyle)
+        return;
+
+    StyleRunsReplaceStyle(&gStyleRuns, gBaseStyle, style);
+    gBaseStyle = style;
+
+    // The glyphs, their positions and the line breaks depend on the font and size.
+    // The emboldened outlines and glyph masks are kept by style, so they stay good,
+    // and switching back to a font does not render it again, until so many styles
+    // have been used that the pool is started over.
+    InvalidateATSUIStuffStyles();
+    CompactStyles();
+
+    gBoldfaceBaseStyle = GetBoldfaceStyle(gBaseStyle);
+    gStyle = gStyleObjects[gBaseStyle].style;
+    gBoldfaceStyle = gStyleObjects[gBoldfaceBaseStyle].style;
+}
+
+
+// Makes sure gTextBuffer can hold inLength characters
+//
+static Boolean ReserveTextBuffer(UniCharCount inLength)
+{
+    if (inLength > gTextBufferCapacity) {
+        UniChar				*newBuffer = (UniChar *) realloc(gTextBuffer, inLength * sizeof(UniChar));
+
+        if (newBuffer == NULL)
+            return false;
+        gTextBuffer = newBuffer;
+        gTextBufferCapacity = inLength;
+    }
+    return true;
+}
+
+
+// Marks everything made from the text as out of date
+//
+static void InvalidateATSUIStuffText(void)
+{
+    gLayoutCache.textChanged = true;
+    gBoldfaceLayoutCache.textChanged = true;
+    gPrintLayoutCache.textChanged = true;
+    gShapedText.valid = gBoldfaceText.valid = false;
+    gRetainedText.valid = false;
+    gLineBreaksValid = false;
+}
+
+
+// Tells a layout about an edit to the text it is attached to, so ATSUI only lays
+// out the changed part again.  A layout that does not have the text yet, or whose
+// text was replaced entirely, is given the text the next time it is used.
+//
+static void NoteLayoutEdit(MyLayoutCache *cache, const TextEdit *edit, UniCharCount inOldLength)
+{
+    if (cache->layout == NULL || cache->textChanged)
+        return;
+    if (edit->oldLength == inOldLength)
+	{
+        cache->textChanged = true;
+        return;
+    }
+
+    if (edit->moved)
+        verify_noerr( ATSUTextMoved(cache->layout, gText) );
+    if (edit->oldLength > 0)
+        verify_noerr( ATSUTextDeleted(cache->layout, edit->start, edit->oldLength) );
+    if (edit->newLength > 0)
+	{
+        verify_noerr( ATSUTextInserted(cache->layout, edit->start, edit->newLength) );
+        if ( ! cache->styleChanged )
+            ApplyStyleRuns(cache->layout, gText, edit->start, edit->start + edit->newLength, &gStyleRuns, cache->boldface);
+    }
+}
+
+
+static Boolean RebreakEditedLines(const TextEdit *edit);
+
+// Brings everything made from the text up to date with an edit to gTextStore
+//
+static void ApplyATSUIStuffEdit(const TextEdit *edit)
+{
+    UniCharCount			oldLength = gLength;
+
+    gText = gTextStore.text;
+    gLength = gTextStore.length;
+    if (edit->oldLength == 0 && edit->newLength == 0)
+        return;
+
+    verify_noerr( StyleRunsEdit(&gStyleRuns, edit->start, edit->oldLength, edit->newLength, gBaseStyle) );
+    NoteLayoutEdit(&gLayoutCache, edit, oldLength);
+    NoteLayoutEdit(&gBoldfaceLayoutCache, edit, oldLength);
+    NoteLayoutEdit(&gPrintLayoutCache, edit, oldLength);
+
+    // The view shows a single line, so it is shaped again; the printed lines are only
+    // broken again around the edit
+    gShapedText.valid = gBoldfaceText.valid = false;
+    gRetainedText.valid = false;
+    if (gLineBreaksValid)
+        gLineBreaksValid = RebreakEditedLines(edit);
+}
+
+
+// Tells a layout that the text from inStart up to inEnd has a new style
+//
+static void NoteLayoutRestyle(MyLayoutCache *cache, UniCharArrayOffset inStart, UniCharArrayOffset inEnd)
+{
+    if (cache->layout != NULL && ! cache->textChanged && ! cache->styleChanged)
+        ApplyStyleRuns(cache->layout, gText, inStart, inEnd, &gStyleRuns, cache->boldface);
+}
+
+
+// Sets the attributes inWhich names (kATSUIStuffStyleFont, kATSUIStuffStyleSize) of
+// inLength characters of the text at inStart to those in inAttributes.  Each run in
+// the range keeps its other attributes.  Text inserted after them takes on the same
+// style.  Only the restyled text is laid out and broken into lines again.  Text
+// printed from a file is all in the base style.
+//
+void SetATSUIStuffStyle(UniCharArrayOffset inStart, UniCharCount inLength, const StyleAttributes *inAttributes, UInt32 inWhich)
+{
+    UniCharArrayOffset		offset, end;
+    TextEdit				edit;
+
+    if (inStart >= gLength || inLength == 0)
+        return;
+    if (inLength > gLength - inStart)
+        inLength = gLength - inStart;
+    end = inStart + inLength;
+
+    // The pool is started over before the new styles are added, not between them
+    if (gStylePool.count > kMaxStyles)
+	{
+        InvalidateATSUIStuffStyles();
+        CompactStyles();
+    }
+
+    for (offset = inStart; offset < end; ) {
+        const StyleRun		*run = &gStyleRuns.runs[StyleRunsFind(&gStyleRuns, offset)];
+        StyleAttributes		attributes = *StylePoolGet(&gStylePool, run->style);
+        UniCharArrayOffset	runEnd = run->start + run->length;
+        StyleID				style;
+
+        if (runEnd > end)
+            runEnd = end;
+        if (inWhich & kATSUIStuffStyleFont)
+            attributes.font = inAttributes->font;
+        if (inWhich & kATSUIStuffStyleSize)
+            attributes.size = inAttributes->size;
+        style = InternStyle(&attributes);
+        if ( style == kNoStyle || StyleRunsSet(&gStyleRuns, offset, runEnd - offset, style) != 0 )
+            break;
+        offset = runEnd;
+    }
+    if (offset == inStart)
+        return;
+
+    NoteLayoutRestyle(&gLayoutCache, inStart, offset);
+    NoteLayoutRestyle(&gBoldfaceLayoutCache, inStart, offset);
+    NoteLayoutRestyle(&gPrintLayoutCache, inStart, offset);
+
+    gShapedText.valid = gBoldfaceText.valid = false;
+    gRetainedText.valid = false;
+    if (gLineBreaksValid && gTextSource == NULL)
+	{
+        edit.start = inStart;
+        edit.oldLength = edit.newLength = offset - inStart;
+        edit.moved = false;
+        gLineBreaksValid = RebreakEditedLines(&edit);
+    }
+}
+
+
+// Sets up the text based on the specified CFString.  Only the characters that differ
+// from the current text are changed, so typing a character into the field and
+// pressing the button lays out one line again, not the whole text.
+//
+void UpdateATSUIStuffString(CFStringRef string)
+{
+    const UniChar			*characters;
+    UniCharCount			length;
+    TextEdit				edit;
+
+    length = CFStringGetLength(string);
+    characters = CFStringGetCharactersPtr(string);
+    if (characters == NULL)
+	{
+        if ( ! ReserveTextBuffer(length) )
+            return;
+        CFStringGetCharacters(string, CFRangeMake(0, length), gTextBuffer);
+        characters = gTextBuffer;
+    }
+
+    if (gTextSource != NULL)
+	{
+        TextSourceDispose(gTextSource);
+        gTextSource = NULL;
+        InvalidateATSUIStuffText();
+    }
+
+    if ( TextStoreSetText(&gTextStore, characters, length, &edit) == 0 )
+        ApplyATSUIStuffEdit(&edit);
+}
+
+
+// Takes the text from a UTF-8 or UTF-16 file.  The file is mapped, not read: the
+// window shows the start of its first paragraph, and printing lays it out a window
+// of paragraphs at a time.
+//
+OSStatus LoadATSUIStuffTextFile(const char *path)
+{
+    const unsigned short	*window;
+    size_t					length, numParagraphs;
+    TextSource				source;
+    TextEdit				edit;
+
+    if ( TextSourceOpen(&source, path) != 0 )
+        return fnfErr;
+    if ( TextSourceGetWindow(&source, 0, 1, kViewWindowUnits, &window, &length, &numParagraphs) != 0
+        || TextStoreReplace(&gTextStore, 0, gTextStore.length, window, length, &edit) != 0 )
+	{
+        TextSourceDispose(&source);
+        return memFullErr;
+    }
+
+    if (gTextSource != NULL)
+        TextSourceDispose(gTextSource);
+    gTextSourceStorage = source;
+    gTextSource = &gTextSourceStorage;
+
+    // The store keeps a copy of the window, which is only good until the next window
+    // is decoded.  The printed lines come from the whole file, so everything is redone.
+    gText = gTextStore.text;
+    gLength = gTextStore.length;
+    StyleRunsDispose(&gStyleRuns);
+    verify_noerr( StyleRunsEdit(&gStyleRuns, 0, 0, gLength, gBaseStyle) );
+    InvalidateATSUIStuffText();
+    return noErr;
+}
+
+
+// Creates the ATSUI data
+//
+void SetUpATSUIStuff(void)
+{    
+    CFStringRef	string = CFSTR("Hello World!");
+    Boolean		keyExistsAndHasValidFormat;
+    CFIndex		budget;
+
+    // The styles look up their stroke factors as they are made, so the table is
+    // mapped before the first one is
+    OpenStrokeCalibration();
+	UpdateATSUIStuffString(string);
+    UpdateATSUIStyle();
+
+    // The glyph cache's budget can be changed with the GlyphCacheBytes user default
+    budget = CFPreferencesGetAppIntegerValue(CFSTR("GlyphCacheBytes"), kCFPreferencesCurrentApplication, &keyExistsAndHasValidFormat);
+    if ( ! keyExistsAndHasValidFormat || budget <= 0 )
+        budget = kGlyphCacheDefaultBudget;
+    gGlyphBitmapsReady = (GlyphCacheInit(&gGlyphBitmaps, budget, MyReleaseGlyphBitmap) == 0);
+}
+
+
+// Returns the cached text layout for gText in its styles, or their boldface partners,
+// with a line width of inWidth.
+// The layout is created on first use; afterwards only what has changed since the last
+// call is passed to ATSUI.
+//
+// No CGContext is attached to the layout.  It is only used to shape and measure the
+// text; the glyphs are drawn with CG directly, and a context tag would change with
+// every draw.
+//
+static ATSUTextLayout GetCachedLayout(MyLayoutCache *cache, ATSUTextMeasurement inWidth)
+{
+    // Create an ATSUI Layout object.  No flush control is set: the glyph positions
+    // start at the line origin and DrawATSUIStuff() centers the line itself.
+    if (cache->layout == NULL)
+	{
+        verify_noerr( ATSUCreateTextLayout(&cache->layout) );
+        cache->textChanged = cache->styleChanged = true;
+        cache->width = 0;
+    }
+
+    // Attach the text to the layout.  Edits are passed on as they are made, by
+    // NoteLayoutEdit(); this is only needed when the text is replaced entirely.
+    if (cache->textChanged)
+	{
+        verify_noerr( ATSUSetTextPointerLocation(cache->layout, gText, kATSUFromTextBeginning, kATSUToTextEnd, gLength) );
+        cache->textChanged = false;
+        cache->styleChanged = true;		// Setting the text drops the style runs
+    }
+
+    // Combine the ATSU Styles and Layout together, each run of text in its style in a
+    // font that has glyphs for it.  Setting the run styles again also makes ATSUI throw away anything
+    // it cached for the old attributes.
+    if (cache->styleChanged)
+	{
+        verify_noerr( ATSUSetRunStyle(cache->layout, cache->boldface ? gBoldfaceStyle : gStyle, kATSUFromTextBeginning, kATSUToTextEnd) );
+        ApplyStyleRuns(cache->layout, gText, 0, gLength, &gStyleRuns, cache->boldface);
+        cache->styleChanged = false;
+    }
+
+    // Within the width of the box
+    if (cache->width != inWidth)
+	{
+        ATSUAttributeTag		tag = kATSULineWidthTag;
+        ByteCount				size = sizeof(ATSUTextMeasurement);
+        ATSUAttributeValuePtr	value = &inWidth;
+
+        verify_noerr( ATSUSetLayoutControls(cache->layout, 1, &tag, &size, &value) );
+        cache->width = inWidth;
+    }
+
+    return cache->layout;
+}
+
+
+// Records the text of the given boxes into gRetainedText, each line with its origin
+// at (0, 0)
+//
+static void RecordATSUIStuff(float inWidth, Boolean useStrokeMethod, UInt32 inBoxes)
+{
+	ATSUTextLayout						layout;
+	ItemCount							numGlyphs;
+	MyDisplayList						*regular = NULL, *bold = NULL;
+	const MyShapedText					*boldText = &gShapedText;
+	TraceScope							scope;
+
+    if (inBoxes & kATSUIStuffRegularBox)
+	{
+        regular = &gRetainedText.regular;
+        DisplayListReset(regular);
+    }
+    if (inBoxes & kATSUIStuffBoldBox)
+	{
+        bold = &gRetainedText.bold;
+        DisplayListReset(bold);
+    }
+
+	// Get the layout, updated for the current text and style, and shape the text
+	// once; both boxes are drawn from the same glyphs
+    TraceBegin(&scope, "RecordATSUIStuff: lay out and shape");
+	layout = GetCachedLayout(&gLayoutCache, X2Fix(inWidth));
+    (void) GetGlyphIDsAndPositions(layout, &numGlyphs);
+    TraceEnd(&scope);
+
+    if ( useStrokeMethod )
+	{
+        UInt32							recorded = 0;
+
+        // Record both boxes from a single rendering of the glyphs; the bold one is
+        // the regular one's coverage, dilated.  Whatever that could not record is
+        // recorded from outlines below.
+        if ( gEmboldenMethod == kEmboldenByDilation )
+            recorded = RecordDilatedGlyphs(regular, bold, 0, 0, 0);
+
+        // The text once without the extra bold
+        if (regular != NULL && (recorded & kATSUIStuffRegularBox) == 0)
+            RecordLine(regular, &gShapedText, 0, 0, true, false);
+
+        // The text again with the extra bold for comparison.  Rather than stroking
+        // every glyph with kCGTextFillStroke on every draw, fill outlines that were
+        // emboldened once by gStrokeThicknessFactor * point size.  The result looks the
+        // same on screen and in print.
+        if (bold != NULL && (recorded & kATSUIStuffBoldBox) == 0)
+            RecordLine(bold, &gShapedText, 0, 0, true, true);
+    }
+    else
+	{
+        // The text once without the extra bold
+        if (regular != NULL)
+            RecordLine(regular, &gShapedText, 0, 0, false, false);
+
+        // The text again in boldface for comparison.  This is what kATSUQDBoldfaceTag
+        // does: the text is set in the bold face of its family, or where there is
+        // none, drawn a second time one pixel to the right.  It will look very strong
+        // on-screen when CG anti-aliasing is off.  The box has its own layout in the
+        // boldface partners of the styles, which are made once, so no style is
+        // changed to draw it.
+        if (bold != NULL)
+		{
+            ShapeText(&gBoldfaceText, GetCachedLayout(&gBoldfaceLayoutCache, X2Fix(inWidth)));
+            boldText = &gBoldfaceText;
+            RecordLine(bold, boldText, 0, 0, false, false);
+        }
+    }
+
+    if (bold != NULL)
+        gRetainedText.boldWidth = boldText->width;
+    gRetainedText.valid = true;
+    gRetainedText.useStrokeMethod = useStrokeMethod;
+    gRetainedText.emboldenMethod = gEmboldenMethod;
+    gRetainedText.strokeFactor = gStrokeThicknessFactor;
+}
+
+
+// Divides the view into vertical quarters; the text goes in the middle two
+//
+static void GetATSUIStuffBoxes(HIRect bounds, HIRect *outBox1, HIRect *outBox2)
+{
+    float								windowHeight = bounds.size.height;
+
+	// Set up box 1
+	*outBox1 = bounds;
+	outBox1->origin.y += ((windowHeight / 4.0) * 2.0);
+	outBox1->size.height -= (windowHeight / 4.0);
+
+	// Set up box 2
+	*outBox2 = bounds;
+	outBox2->origin.y += (windowHeight / 4.0);
+	outBox2->size.height -= ((windowHeight / 4.0) * 2.0);
+}
+
+
+// Returns the baseline of the line in a box.  It is kept on a whole pixel so the
+// recorded glyph masks land exactly where they would if drawn directly.
+//
+static float GetATSUIStuffBaseline(HIRect box)
+{
+    return floorf((box.origin.y + box.size.height) / 2.0 + 0.5);
+}
+
+
+// Returns the part of the view, in Quartz coordinates, that the text in the given
+// boxes can cover: the width of the view and the height of the line, with room for
+// the heavier of the recorded and the current emboldening.  This is what has to be
+// redrawn when only those boxes change.  Until the text has been shaped its height
+// is not known, so the whole view is returned.
+//
+HIRect GetATSUIStuffDamageRect(HIRect bounds, UInt32 inBoxes)
+{
+    HIRect								box1, box2, damage = CGRectNull;
+    float								factor, margin;
+
+    if ( ! gShapedText.valid )
+        return bounds;
+
+    factor = GetShapedTextStrokeFactor((gRetainedText.strokeFactor > gStrokeThicknessFactor) ? gRetainedText.strokeFactor : gStrokeThicknessFactor);
+    margin = ceilf(factor * Fix2X(gPointSize)) + 2.0;
+
+    GetATSUIStuffBoxes(bounds, &box1, &box2);
+    if (inBoxes & kATSUIStuffRegularBox)
+        damage = CGRectUnion(damage, CGRectMake(bounds.origin.x, GetATSUIStuffBaseline(box1) - gShapedText.descent - margin,
+                                                bounds.size.width, gShapedText.ascent + gShapedText.descent + 2.0 * margin));
+    if (inBoxes & kATSUIStuffBoldBox)
+        damage = CGRectUnion(damage, CGRectMake(bounds.origin.x, GetATSUIStuffBaseline(box2) - gShapedText.descent - margin,
+                                                bounds.size.width, gShapedText.ascent + gShapedText.descent + 2.0 * margin));
+    return damage;
+}
+
+
+// Returns the boxes whose text changes with the stroke factor: box 2 when it is
+// emboldened, none when it shows the text in boldface
+//
+UInt32 GetATSUIStuffStrokeFactorBoxes(void)
+{
+    MyRenderPolicy						policy;
+
+    GetRenderPolicy(gPointSize, &policy);
+    return policy.useStrokeMethod ? kATSUIStuffBoldBox : 0;
+}
+
+
+void DrawATSUIStuff(CGContextRef inContext, HIRect bounds)
+{
+    Boolean								needToUseCGStrokeMethod;
+	HIRect								box1, box2, clip;
+	UInt32								stale = 0;
+	float								x1, x2;
+	MyRenderPolicy						policy;
+	TraceScope							drawScope, phaseScope;
+	
+    TraceBegin(&drawScope, "DrawATSUIStuff");
+
+    // Only what is inside the area being redrawn needs drawing.  When the slider
+    // moves, that is just the line in box 2.
+    clip = CGContextGetClipBoundingBox(inContext);
+
+    GetATSUIStuffBoxes(bounds, &box1, &box2);
+    if ( CGRectIntersectsRect(clip, box1) )
+        CGContextStrokeRect(inContext, box1);
+    if ( CGRectIntersectsRect(clip, box2) )
+        CGContextStrokeRect(inContext, box2);
+
+    // ATSUI does not antialias text at or below the antialiasing threshold.  Since
+    // the glyphs are drawn by CG directly, do the same here.  The decision comes from
+    // a snapshot of the preferences, so there is no preferences lookup while drawing.
+    GetRenderPolicy(gPointSize, &policy);
+    needToUseCGStrokeMethod = policy.useStrokeMethod;
+
+    // Record the text again only if something it depends on has changed.  The view's
+    // size is not one of those things, so a live resize just plays it back.
+    if ( ! gRetainedText.valid || gRetainedText.useStrokeMethod != needToUseCGStrokeMethod
+        || gRetainedText.emboldenMethod != gEmboldenMethod )
+        stale = kATSUIStuffBothBoxes;
+    else if ( gRetainedText.strokeFactor != gStrokeThicknessFactor )
+	{
+        // Only the emboldened box depends on the stroke factor; box 2 in boldface
+        // does not, and is left as it was recorded
+        if ( needToUseCGStrokeMethod )
+            stale = kATSUIStuffBoldBox;
+        else
+            gRetainedText.strokeFactor = gStrokeThicknessFactor;
+    }
+    if (stale != 0)
+	{
+        TraceBegin(&phaseScope, stale == kATSUIStuffBoldBox ? "DrawATSUIStuff: record bold box" : "DrawATSUIStuff: record both boxes");
+        RecordATSUIStuff(bounds.size.width, needToUseCGStrokeMethod, stale);
+        TraceEnd(&phaseScope);
+    }
+
+    // Center the line in each box.  In boldface the line in box 2 can be the wider.
+    x1 = floorf(box1.origin.x + (bounds.size.width - gShapedText.width) / 2.0 + 0.5);
+    x2 = floorf(box2.origin.x + (bounds.size.width - gRetainedText.boldWidth) / 2.0 + 0.5);
+
+    CGContextSaveGState(inContext);
+    CGContextSetShouldAntialias(inContext, needToUseCGStrokeMethod);
+    if ( CGRectIntersectsRect(clip, GetATSUIStuffDamageRect(bounds, kATSUIStuffRegularBox)) )
+	{
+        TraceBegin(&phaseScope, "DrawATSUIStuff: replay regular box");
+        DisplayListReplayWithTransform(&gRetainedText.regular, inContext, CGAffineTransformMakeTranslation(x1, GetATSUIStuffBaseline(box1)));
+        TraceEnd(&phaseScope);
+    }
+    if ( CGRectIntersectsRect(clip, GetATSUIStuffDamageRect(bounds, kATSUIStuffBoldBox)) )
+	{
+        TraceBegin(&phaseScope, "DrawATSUIStuff: replay bold box");
+        DisplayListReplayWithTransform(&gRetainedText.bold, inContext, CGAffineTransformMakeTranslation(x2, GetATSUIStuffBaseline(box2)));
+        TraceEnd(&phaseScope);
+    }
+    CGContextRestoreGState(inContext);
+
+    // Tear down the CGContext since we are done with it
+    TraceBegin(&phaseScope, "DrawATSUIStuff: flush");
+	CGContextFlush(inContext);
+    TraceEnd(&phaseScope);
+    TraceEnd(&drawScope);
+}
+
+
+// True for the characters that end a paragraph
+//
+static Boolean IsParagraphSeparator(UniChar c)
+{
+    return c == '\n' || c == '\r' || c == 0x2029;
+}
+
+
+// Makes room for inCount more lines and their glyphs, with at most inGlyphs glyphs
+// between them.  Returns false if there is not enough memory.
+//
+static Boolean ReserveLines(ItemCount inCount, ItemCount inGlyphs)
+{
+    if (gNumLines + inCount + 1 > gLineCapacity) {
+        ItemCount			newCapacity = (gNumLines + inCount + 1) * 2;
+        ItemCount			*newStarts = (ItemCount *) realloc(gLineGlyphStarts, newCapacity * sizeof(ItemCount));
+        UniCharArrayOffset	*newTextStarts;
+
+        if (newStarts == NULL)
+            return false;
+        gLineGlyphStarts = newStarts;
+        newTextStarts = (UniCharArrayOffset *) realloc(gLineTextStarts, newCapacity * sizeof(UniCharArrayOffset));
+        if (newTextStarts == NULL)
+            return false;
+        gLineTextStarts = newTextStarts;
+        gLineCapacity = newCapacity;
+    }
+
+    // Some scripts make more glyphs than characters, so the arrays grow as needed
+    if (gNumLineGlyphs + inGlyphs > gLineGlyphCapacity) {
+        ItemCount			newCapacity = (gNumLineGlyphs + inGlyphs) * 2;
+        CGGlyph				*newGlyphs;
+        CGPoint				*newPositions;
+        StyleID				*newStyles;
+
+        newGlyphs = (CGGlyph *) realloc(gLineGlyphs, newCapacity * sizeof(CGGlyph));
+        if (newGlyphs != NULL)
+            gLineGlyphs = newGlyphs;
+        newPositions = (CGPoint *) realloc(gLinePositions, newCapacity * sizeof(CGPoint));
+        if (newPositions != NULL)
+            gLinePositions = newPositions;
+        newStyles = (StyleID *) realloc(gLineGlyphStyles, newCapacity * sizeof(StyleID));
+        if (newStyles != NULL)
+            gLineGlyphStyles = newStyles;
+        if (newGlyphs == NULL || newPositions == NULL || newStyles == NULL)
+            return false;
+        gLineGlyphCapacity = newCapacity;
+    }
+    return true;
+}
+
+
+// Copies the glyphs of the lines starting at inLineStarts out of the print layout,
+// adding them to the end of gLineGlyphs.  inTextBase is where the layout's text
+// starts in the whole text.  Unless gKeepLineGlyphs is set, only where the lines
+// start is added.  Returns false if there is not enough memory, with only the lines
+// before that one added.
+//
+static Boolean AppendLineGlyphs(ATSUTextLayout layout, const UniCharArrayOffset *inLineStarts, ItemCount inNumLines, UniCharArrayOffset inTextBase)
+{
+    ItemCount				line;
+
+    for (line = 0; line < inNumLines; line++) {
+        ATSLayoutRecord		*records = NULL;
+        ItemCount			numRecords = 0, i;
+        MyStyleCursor		cursor = { 0, 0, kNoStyle };
+
+        if (gKeepLineGlyphs)
+            verify_noerr( ATSUDirectGetLayoutDataArrayPtrFromLineOffset(layout, inLineStarts[line], kATSUDirectDataLayoutRecordATSLayoutRecordCurrent, (void **) &records, &numRecords) );
+        if ( ! ReserveLines(1, numRecords) )
+		{
+            if (records != NULL)
+                verify_noerr( ATSUDirectReleaseLayoutDataArrayPtr(NULL, kATSUDirectDataLayoutRecordATSLayoutRecordCurrent, (void **) &records) );
+            return false;
+        }
+        gLineTextStarts[gNumLines] = inTextBase + inLineStarts[line];
+        gLineGlyphStarts[gNumLines++] = gNumLineGlyphs;
+
+        // Deleted glyphs (the end-of-line record and the paragraph separators) are left out
+        for (i = 0; i < numRecords; i++) {
+            if (records[i].glyphID == kATSDeletedGlyphcode) continue;
+
+            gLineGlyphs[gNumLineGlyphs] = records[i].glyphID;
+            gLineGlyphStyles[gNumLineGlyphs] = GetStyleAt(layout, records[i].originalOffset / sizeof(UniChar), &cursor);
+            gLinePositions[gNumLineGlyphs].x = Fix2X(records[i].realPos - records[0].realPos);
+            gLinePositions[gNumLineGlyphs].y = 0;
+            gNumLineGlyphs++;
+        }
+
+        if (records != NULL)
+            verify_noerr( ATSUDirectReleaseLayoutDataArrayPtr(NULL, kATSUDirectDataLayoutRecordATSLayoutRecordCurrent, (void **) &records) );
+    }
+    return true;
+}
+
+
+// Breaks the paragraphs of the layout's text from inStart up to inEnd into lines no
+// wider than inLineWidth and adds them to the stored lines.  Each paragraph is broken
+// by ATSUI separately.  Returns false if there is not enough memory for the lines.
+//
+static Boolean BreakParagraphs(ATSUTextLayout layout, const UniChar *inText, UniCharArrayOffset inStart, UniCharArrayOffset inEnd, UniCharArrayOffset inTextBase, float inLineWidth)
+{
+    UniCharArrayOffset		*lineStarts, start, end;
+    ItemCount				capacity = inEnd - inStart + 1, numLines = 0, numBreaks;
+    Boolean					appended;
+
+    lineStarts = (UniCharArrayOffset *) malloc(capacity * sizeof(UniCharArrayOffset));
+    if (lineStarts == NULL)
+        return false;
+
+    for (start = inStart; start < inEnd || numLines == 0; start = end) {
+        UniCharCount	length;
+
+        // Find the end of the paragraph; a CR LF pair counts as one separator
+        for (end = start; end < inEnd && ! IsParagraphSeparator(inText[end]); end++)
+            ;
+        length = end - start;
+        if (end < inEnd)
+            end += (inText[end] == '\r' && end + 1 < inEnd && inText[end + 1] == '\n') ? 2 : 1;
+
+        // Make the paragraph start a line of its own, then let ATSUI break it up
+        lineStarts[numLines++] = start;
+        if (start > 0)
+            verify_noerr( ATSUSetSoftLineBreak(layout, start) );
+        if (length > 0) {
+            verify_noerr( ATSUBatchBreakLines(layout, start, length, X2Fix(inLineWidth), &numBreaks) );
+            if (numBreaks > capacity - numLines)
+                numBreaks = capacity - numLines;
+            verify_noerr( ATSUGetSoftLineBreaks(layout, start, length, numBreaks, &lineStarts[numLines], &numBreaks) );
+            numLines += numBreaks;
+        }
+    }
+
+    appended = AppendLineGlyphs(layout, lineStarts, numLines, inTextBase);
+    free(lineStarts);
+    return appended;
+}
+
+
+// Notes that the lines from here on are in the window of the file that starts with
+// paragraph inParagraph, at inTextBase in the whole text.  Returns false if there is
+// not enough memory.
+//
+static Boolean AddLineWindow(size_t inParagraph, UniCharArrayOffset inTextBase)
+{
+    if (gNumLineWindows == gLineWindowCapacity) {
+        ItemCount			newCapacity = (gLineWindowCapacity + 1) * 2;
+        MyLineWindow		*newWindows = (MyLineWindow *) realloc(gLineWindows, newCapacity * sizeof(MyLineWindow));
+
+        if (newWindows == NULL)
+            return false;
+        gLineWindows = newWindows;
+        gLineWindowCapacity = newCapacity;
+    }
+    gLineWindows[gNumLineWindows].firstLine = gNumLines;
+    gLineWindows[gNumLineWindows].paragraph = inParagraph;
+    gLineWindows[gNumLineWindows].base = inTextBase;
+    gNumLineWindows++;
+    return true;
+}
+
+
+// Breaks one window of text into lines and adds them to the stored lines.  Returns
+// false if there is not enough memory for them.
+//
+static Boolean BreakTextWindow(ATSUTextLayout layout, const UniChar *inText, UniCharCount inLength, UniCharArrayOffset inTextBase, float inLineWidth)
+{
+    // Start over without the soft breaks from an earlier window or width
+    verify_noerr( ATSUClearSoftLineBreaks(layout, kATSUFromTextBeginning, kATSUToTextEnd) );
+    return BreakParagraphs(layout, inText, 0, inLength, inTextBase, inLineWidth);
+}
+
+
+// Returns the start of the paragraph that the character at inOffset is in.  A
+// separator belongs to the paragraph it ends.
+//
+static UniCharArrayOffset FindParagraphStart(const UniChar *inText, UniCharCount inLength, UniCharArrayOffset inOffset)
+{
+    if (inOffset > 0 && inOffset < inLength && inText[inOffset] == '\n' && inText[inOffset - 1] == '\r')
+        inOffset--;
+    while (inOffset > 0 && ! IsParagraphSeparator(inText[inOffset - 1]))
+        inOffset--;
+    return inOffset;
+}
+
+
+// Returns the end of the paragraph that the character at inOffset is in, after its
+// separator, or inOffset itself if a paragraph starts there
+//
+static UniCharArrayOffset FindParagraphEnd(const UniChar *inText, UniCharCount inLength, UniCharArrayOffset inOffset)
+{
+    if (FindParagraphStart(inText, inLength, inOffset) == inOffset)
+        return inOffset;
+    while (inOffset < inLength && ! IsParagraphSeparator(inText[inOffset]))
+        inOffset++;
+    if (inOffset < inLength)
+        inOffset += (inText[inOffset] == '\r' && inOffset + 1 < inLength && inText[inOffset + 1] == '\n') ? 2 : 1;
+    return inOffset;
+}
+
+
+// Returns the first stored line that starts at or after inOffset in the text
+//
+static ItemCount FindLineAtOffset(UniCharArrayOffset inOffset)
+{
+    ItemCount				low = 0, high = gNumLines;
+
+    while (low < high) {
+        ItemCount			mid = low + (high - low) / 2;
+
+        if (gLineTextStarts[mid] < inOffset)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+
+// Moves the elements of one of the line arrays around after the edited paragraphs
+// have been broken again.  The array holds inHead elements that stay put, inOld for
+// the old lines, inTail for the lines after them and inNew for the new lines, in that
+// order, with room after them for inNew more.  The new lines end up in place of the
+// old ones, followed by the tail.
+//
+static void ReplaceLineElements(void *inArray, size_t inSize, ItemCount inHead, ItemCount inOld, ItemCount inTail, ItemCount inNew)
+{
+    char					*base = (char *) inArray;
+
+    // Fewer new lines fit where the old ones were without touching the tail.  More
+    // are first set aside past where the tail will end, so moving it along cannot
+    // run over them.
+    if (inNew <= inOld) {
+        memmove(base + inHead * inSize, base + (inHead + inOld + inTail) * inSize, inNew * inSize);
+        memmove(base + (inHead + inNew) * inSize, base + (inHead + inOld) * inSize, inTail * inSize);
+    }
+    else {
+        memmove(base + (inHead + inNew + inTail) * inSize, base + (inHead + inOld + inTail) * inSize, inNew * inSize);
+        memmove(base + (inHead + inNew) * inSize, base + (inHead + inOld) * inSize, inTail * inSize);
+        memmove(base + inHead * inSize, base + (inHead + inNew + inTail) * inSize, inNew * inSize);
+    }
+}
+
+
+// Brings the stored lines up to date with an edit to the text, which the print
+// layout has already been told about.  Only the paragraphs the edit touched are
+// broken again; the lines after them are moved along within the line arrays.
+// Returns false if the lines have to be broken from scratch instead.
+//
+static Boolean RebreakEditedLines(const TextEdit *edit)
+{
+    ATSUTextLayout			layout = gPrintLayoutCache.layout;
+    long					delta = (long) edit->newLength - (long) edit->oldLength;
+    UniCharArrayOffset		paraStart, paraEnd;
+    ItemCount				firstLine, oldLines, newLines, tailLines, line;
+    ItemCount				headGlyphs, oldGlyphs, newGlyphs, tailGlyphs;
+    ItemCount				endLines = gNumLines, endGlyphs = gNumLineGlyphs;
+
+    if ( gTextSource != NULL || layout == NULL || gPrintLayoutCache.textChanged || gPrintLayoutCache.styleChanged
+        || gPrintLayoutCache.width != X2Fix(gLineBreakWidth) )
+        return false;
+
+    // An edit at the start of a paragraph can join it to the one before, by deleting
+    // a separator or completing a CR LF pair, so that one is broken again too
+    paraStart = FindParagraphStart(gText, gLength, edit->start);
+    if (paraStart == edit->start && paraStart > 0)
+        paraStart = FindParagraphStart(gText, gLength, paraStart - 1);
+
+    for (paraEnd = edit->start + edit->newLength; paraEnd < gLength && ! IsParagraphSeparator(gText[paraEnd]); paraEnd++)
+        ;
+    if (paraEnd < gLength)
+        paraEnd += (gText[paraEnd] == '\r' && paraEnd + 1 < gLength && gText[paraEnd + 1] == '\n') ? 2 : 1;
+
+    // Nothing to gain if every paragraph was touched
+    if (paraStart == 0 && paraEnd == gLength)
+        return false;
+
+    // The old lines of the edited paragraphs, and the lines after them
+    firstLine = FindLineAtOffset(paraStart);
+    oldLines = FindLineAtOffset(paraEnd - delta) - firstLine;
+    tailLines = gNumLines - firstLine - oldLines;
+    headGlyphs = gLineGlyphStarts[firstLine];
+    oldGlyphs = gLineGlyphStarts[firstLine + oldLines] - headGlyphs;
+    tailGlyphs = gNumLineGlyphs - headGlyphs - oldGlyphs;
+
+    // Break the edited paragraphs again after the last stored line.  The soft break
+    // at the end keeps the last of them from running on into the next paragraph.
+    verify_noerr( ATSUClearSoftLineBreaks(layout, paraStart, paraEnd - paraStart) );
+    if (paraEnd < gLength)
+        verify_noerr( ATSUSetSoftLineBreak(layout, paraEnd) );
+    if ( ! BreakParagraphs(layout, gText, paraStart, paraEnd, 0, gLineBreakWidth) )
+        return false;
+    newLines = gNumLines - endLines;
+    newGlyphs = gNumLineGlyphs - endGlyphs;
+
+    // Then put the new lines in place of the old ones, and move the lines after them
+    // along by the edit
+    if ( ! ReserveLines(newLines, newGlyphs) )
+        return false;
+    ReplaceLineElements(gLineGlyphStarts, sizeof(ItemCount), firstLine, oldLines, tailLines, newLines);
+    ReplaceLineElements(gLineTextStarts, sizeof(UniCharArrayOffset), firstLine, oldLines, tailLines, newLines);
+    ReplaceLineElements(gLineGlyphs, sizeof(CGGlyph), headGlyphs, oldGlyphs, tailGlyphs, newGlyphs);
+    ReplaceLineElements(gLinePositions, sizeof(CGPoint), headGlyphs, oldGlyphs, tailGlyphs, newGlyphs);
+    ReplaceLineElements(gLineGlyphStyles, sizeof(StyleID), headGlyphs, oldGlyphs, tailGlyphs, newGlyphs);
+
+    for (line = firstLine; line < firstLine + newLines; line++)
+        gLineGlyphStarts[line] -= oldGlyphs + tailGlyphs;
+    for ( ; line < firstLine + newLines + tailLines; line++) {
+        gLineGlyphStarts[line] = gLineGlyphStarts[line] + newGlyphs - oldGlyphs;
+        gLineTextStarts[line] += delta;
+    }
+    gNumLines = firstLine + newLines + tailLines;
+    gNumLineGlyphs = headGlyphs + newGlyphs + tailGlyphs;
+    gLineGlyphStarts[gNumLines] = gNumLineGlyphs;
+    return true;
+}
+
+
+// Breaks the text into lines no wider than inLineWidth, for printing.  The lines'
+// glyphs are stored and kept until the text, the style or the width change, so
+// asking again for the same page width costs nothing.  Text from a file is laid
+// out kPrintWindowParagraphs paragraphs at a time, so the layout never holds more
+// than that, and only where its lines start is kept.  Returns the number of lines
+// in outNumLines, and in outLineHeight the height each line takes up on the page,
+// including its emboldened copy.  Returns memFullErr, with no lines, if there is
+// not enough memory for all of them.
+//
+OSStatus BreakATSUIStuffIntoLines(float inLineWidth, ItemCount *outNumLines, float *outLineHeight)
+{
+    ATSUTextLayout			layout;
+    ATSUTextMeasurement		before, after, ascent, descent;
+    Boolean					broken = true;
+
+    if ( gLineBreaksValid && gLineBreakWidth == inLineWidth ) {
+        *outNumLines = gNumLines;
+        *outLineHeight = gLineHeight * kLinePairHeight;
+        return noErr;
+    }
+
+    layout = GetCachedLayout(&gPrintLayoutCache, X2Fix(inLineWidth));
+    verify_noerr( ATSUGetUnjustifiedBounds(layout, kATSUFromTextBeginning, kATSUToTextEnd, &before, &after, &ascent, &descent) );
+    gLineAscent = Fix2X(ascent);
+    gLineHeight = Fix2X(ascent + descent);
+    if (gLineHeight <= 0)
+        gLineHeight = gLineAscent = Fix2X(gPointSize);
+
+    gNumLines = 0;
+    gNumLineGlyphs = 0;
+    gNumLineWindows = 0;
+    if (gTextSource == NULL)
+        broken = BreakTextWindow(layout, gText, gLength, 0, inLineWidth);
+    else
+	{
+        const unsigned short	*window;
+        size_t					length, numParagraphs, paragraph = 0;
+        UniCharArrayOffset		base = 0;
+
+        gKeepLineGlyphs = false;
+        while ( broken && TextSourceGetWindow(gTextSource, paragraph, kPrintWindowParagraphs, 0, &window, &length, &numParagraphs) == 0 && numParagraphs > 0 )
+		{
+            if ( ! AddLineWindow(paragraph, base) )
+			{
+                broken = false;
+                break;
+            }
+            verify_noerr( ATSUSetTextPointerLocation(layout, window, kATSUFromTextBeginning, kATSUToTextEnd, length) );
+            verify_noerr( ATSUSetRunStyle(layout, gStyle, kATSUFromTextBeginning, kATSUToTextEnd) );
+            ApplyStyleRuns(layout, window, 0, length, NULL, false);
+            broken = BreakTextWindow(layout, window, length, base, inLineWidth);
+            paragraph += numParagraphs;
+            base += length;
+        }
+        gKeepLineGlyphs = true;
+
+        // The layout is left pointing at the source's window; put gText back next time
+        gPrintLayoutCache.textChanged = true;
+    }
+
+    gLineBreakWidth = inLineWidth;
+    // Without room for every line, none of them are printed
+    gLineBreaksValid = broken && ReserveLines(0, 0);
+    if (gLineBreaksValid)
+        gLineGlyphStarts[gNumLines] = gNumLineGlyphs;
+    else
+        gNumLines = gNumLineGlyphs = 0;
+
+    *outNumLines = gNumLines;
+    *outLineHeight = gLineHeight * kLinePairHeight;
+    return gLineBreaksValid ? noErr : memFullErr;
+}
+
+
+// Makes room for inCount more glyphs in lines that PrepareATSUIStuffLines() laid
+// out again.  Returns false if there is not enough memory.
+//
+static Boolean ReserveLineGlyphs(MyLineGlyphs *ioLines, ItemCount inCount)
+{
+    ItemCount				newCount = ioLines->glyphStarts[ioLines->numLines] + inCount;
+    CGGlyph					*newGlyphs;
+    CGPoint					*newPositions;
+    StyleID					*newStyles;
+
+    if (inCount == 0)
+        return true;
+    newGlyphs = (CGGlyph *) realloc(ioLines->glyphs, newCount * sizeof(CGGlyph));
+    if (newGlyphs != NULL)
+        ioLines->glyphs = newGlyphs;
+    newPositions = (CGPoint *) realloc(ioLines->positions, newCount * sizeof(CGPoint));
+    if (newPositions != NULL)
+        ioLines->positions = newPositions;
+    newStyles = (StyleID *) realloc(ioLines->styles, newCount * sizeof(StyleID));
+    if (newStyles != NULL)
+        ioLines->styles = newStyles;
+    return newGlyphs != NULL && newPositions != NULL && newStyles != NULL;
+}
+
+
+// Lays out the lines inFirstLine up to inEnd of text from a file again and copies
+// their glyphs into ioLines, which has room for their starts.  Only the paragraphs
+// those lines are in are broken, a window at a time.  Their lines are added after
+// the stored ones just long enough to be copied.  Returns false if there is not
+// enough memory.
+//
+static Boolean ExtractSourceLines(ItemCount inFirstLine, ItemCount inEnd, MyLineGlyphs *ioLines)
+{
+    ATSUTextLayout			layout = gPrintLayoutCache.layout;
+    ItemCount				numLines = gNumLines, line = inFirstLine, w;
+    Boolean					extracted = (layout != NULL);
+
+    // Start with the last window that starts at or before the first line
+    for (w = gNumLineWindows; w > 1 && gLineWindows[w - 1].firstLine > inFirstLine; w--)
+        ;
+    for (w--; extracted && line < inEnd; w++) {
+        const MyLineWindow		*window = &gLineWindows[w];
+        ItemCount				windowEnd = (w + 1 < gNumLineWindows) ? gLineWindows[w + 1].firstLine : numLines;
+        ItemCount				last = (inEnd < windowEnd) ? inEnd : windowEnd;
+        ItemCount				first, from, to, count, i;
+        const unsigned short	*text;
+        size_t					length, numParagraphs;
+        UniCharArrayOffset		paraStart, paraEnd;
+
+        if ( TextSourceGetWindow(gTextSource, window->paragraph, kPrintWindowParagraphs, 0, &text, &length, &numParagraphs) != 0 )
+		{
+            extracted = false;
+            break;
+        }
+        paraStart = FindParagraphStart(text, length, gLineTextStarts[line] - window->base);
+        paraEnd = (last < windowEnd) ? FindParagraphEnd(text, length, gLineTextStarts[last] - window->base) : length;
+
+        // The new lines start with the stored line the first paragraph starts on
+        first = numLines + line - FindLineAtOffset(window->base + paraStart);
+
+        // Break the paragraphs just as the whole window was broken.  The soft break
+        // at the end keeps the last of them from running on into the next paragraph.
+        verify_noerr( ATSUSetTextPointerLocation(layout, text, kATSUFromTextBeginning, kATSUToTextEnd, length) );
+        verify_noerr( ATSUSetRunStyle(layout, gStyle, kATSUFromTextBeginning, kATSUToTextEnd) );
+        ApplyStyleRuns(layout, text, paraStart, paraEnd, NULL, false);
+        verify_noerr( ATSUClearSoftLineBreaks(layout, kATSUFromTextBeginning, kATSUToTextEnd) );
+        if (paraEnd < length)
+            verify_noerr( ATSUSetSoftLineBreak(layout, paraEnd) );
+        extracted = BreakParagraphs(layout, text, paraStart, paraEnd, window->base, gLineBreakWidth)
+            && ReserveLines(0, 0) && first + last - line <= gNumLines;
+        if (extracted)
+		{
+            gLineGlyphStarts[gNumLines] = gNumLineGlyphs;
+            from = gLineGlyphStarts[first];
+            count = gLineGlyphStarts[first + last - line] - from;
+            extracted = ReserveLineGlyphs(ioLines, count);
+        }
+        if (extracted)
+		{
+            to = ioLines->glyphStarts[ioLines->numLines];
+            memcpy(&ioLines->glyphs[to], &gLineGlyphs[from], count * sizeof(CGGlyph));
+            memcpy(&ioLines->positions[to], &gLinePositions[from], count * sizeof(CGPoint));
+            memcpy(&ioLines->styles[to], &gLineGlyphStyles[from], count * sizeof(StyleID));
+            for (i = first; i < first + last - line; i++) {
+                ioLines->numLines++;
+                ioLines->glyphStarts[ioLines->numLines] = to + gLineGlyphStarts[i + 1] - from;
+            }
+            line = last;
+        }
+
+        gNumLines = numLines;
+        gNumLineGlyphs = 0;
+    }
+
+    // The layout is left pointing at the file's window; put gText back next time
+    gPrintLayoutCache.textChanged = true;
+    gLineGlyphStarts[gNumLines] = gNumLineGlyphs;
+    return extracted;
+}
+
+
+// Gets the glyphs of lines inFirstLine up to (but not including) inFirstLine +
+// inNumLines ready to be recorded, in outLines.  The lines of text in memory are
+// recorded from where they are stored.  Those of text from a file are laid out
+// again, since they are not stored, and are kept in outLines until it is disposed
+// of with DisposeATSUIStuffLines().
+//
+// The emboldened outlines of the glyphs are made here as well, on this thread, so
+// that recording the lines afterwards finds them all in the table and never calls
+// ATSUI.  Pages are recorded on several threads at once; without this they would
+// all wait on the lock while ATSUI made outlines for one of them.
+//
+// BreakATSUIStuffIntoLines() must have been called first.  Returns memFullErr, with
+// no lines, if there is not enough memory for them.
+//
+OSStatus PrepareATSUIStuffLines(ItemCount inFirstLine, ItemCount inNumLines, MyLineGlyphs *outLines)
+{
+    ItemCount				i;
+
+    memset(outLines, 0, sizeof(MyLineGlyphs));
+    if ( ! gLineBreaksValid || inFirstLine >= gNumLines )
+        return noErr;
+    if (inNumLines > gNumLines - inFirstLine)
+        inNumLines = gNumLines - inFirstLine;
+
+    if (gTextSource == NULL)
+	{
+        outLines->glyphs = gLineGlyphs;
+        outLines->positions = gLinePositions;
+        outLines->styles = gLineGlyphStyles;
+        outLines->glyphStarts = &gLineGlyphStarts[inFirstLine];
+        outLines->numLines = inNumLines;
+    }
+    else
+	{
+        outLines->owned = true;
+        outLines->glyphStarts = (ItemCount *) calloc(inNumLines + 1, sizeof(ItemCount));
+        if ( outLines->glyphStarts == NULL || ! ExtractSourceLines(inFirstLine, inFirstLine + inNumLines, outLines) )
+		{
+            DisposeATSUIStuffLines(outLines);
+            return memFullErr;
+        }
+    }
+
+    pthread_mutex_lock(&gEmboldenedGlyphsLock);
+    for (i = outLines->glyphStarts[0]; i < outLines->glyphStarts[outLines->numLines]; i++)
+        (void) GetEmboldenedGlyphPath(outLines->styles[i], outLines->glyphs[i]);
+    pthread_mutex_unlock(&gEmboldenedGlyphsLock);
+    return noErr;
+}
+
+
+// Frees the glyphs PrepareATSUIStuffLines() laid out again for lines of text from
+// a file.  The lines of text in memory are left where they are stored.
+//
+void DisposeATSUIStuffLines(MyLineGlyphs *lines)
+{
+    if (lines->owned)
+	{
+        free(lines->glyphs);
+        free(lines->positions);
+        free(lines->styles);
+        free(lines->glyphStarts);
+    }
+    memset(lines, 0, sizeof(MyLineGlyphs));
+}
+
+
+// Records the lines into a display list, from the top left of bounds down.  Each
+// line is drawn regular and then, below it, emboldened.
+//
+// PrepareATSUIStuffLines() must have been called for the lines, after the text was
+// broken for the width of bounds.  After that this only reads the lines and the
+// emboldened outlines already made, so several pages can be recorded at once on
+// different threads.
+//
+void RecordATSUIStuffLines(MyDisplayList *list, HIRect bounds, const MyLineGlyphs *inLines)
+{
+    float					pairHeight, y;
+    ItemCount				line;
+
+    pairHeight = gLineHeight * kLinePairHeight;
+
+    y = bounds.origin.y + bounds.size.height;
+    for (line = 0; line < inLines->numLines; line++, y -= pairHeight) {
+        const CGGlyph		*glyphs = &inLines->glyphs[inLines->glyphStarts[line]];
+        const CGPoint		*positions = &inLines->positions[inLines->glyphStarts[line]];
+        const StyleID		*styles = &inLines->styles[inLines->glyphStarts[line]];
+        ItemCount			count = inLines->glyphStarts[line + 1] - inLines->glyphStarts[line];
+        float				x = bounds.origin.x, baseline = y - gLineHeight - gLineAscent;
+        CGPathRef			emboldened;
+
+        RecordGlyphArray(list, styles, glyphs, positions, count, x, y - gLineAscent);
+
+        emboldened = CreateEmboldenedLinePath(styles, glyphs, positions, count, x, baseline);
+        verify_noerr( DisplayListAddFillPath(list, emboldened) );
+        CGPathRelease(emboldened);
+    }
+}
+
+
+// Frees the glyphs of a shaped text
+//
+static void DisposeShapedText(MyShapedText *text)
+{
+    free(text->records);
+    free(text->glyphs);
+    free(text->positions);
+    free(text->styles);
+    memset(text, 0, sizeof(MyShapedText));
+}
+
+
+// Disposes of the ATSUI data
+//
+void DisposeATSUIStuff(void)
+{
+    DisplayListDispose(&gRetainedText.regular);
+    DisplayListDispose(&gRetainedText.bold);
+    gRetainedText.valid = false;
+
+    if (gGlyphBitmapsReady)
+        GlyphCacheDispose(&gGlyphBitmaps);
+    gGlyphBitmapsReady = false;
+
+    if (gLayoutCache.layout != NULL)
+        verify_noerr( ATSUDisposeTextLayout(gLayoutCache.layout) );
+    gLayoutCache.layout = NULL;
+    if (gBoldfaceLayoutCache.layout != NULL)
+        verify_noerr( ATSUDisposeTextLayout(gBoldfaceLayoutCache.layout) );
+    gBoldfaceLayoutCache.layout = NULL;
+    if (gPrintLayoutCache.layout != NULL)
+        verify_noerr( ATSUDisposeTextLayout(gPrintLayoutCache.layout) );
+    gPrintLayoutCache.layout = NULL;
+
+    free(gLineGlyphs);
+    free(gLinePositions);
+    free(gLineGlyphStarts);
+    free(gLineTextStarts);
+    free(gLineGlyphStyles);
+    free(gLineWindows);
+    gLineGlyphs = NULL;
+    gLinePositions = NULL;
+    gLineGlyphStyles = NULL;
+    gLineGlyphStarts = NULL;
+    gLineTextStarts = NULL;
+    gNumLines = gLineCapacity = 0;
+    gNumLineGlyphs = gLineGlyphCapacity = 0;
+    gLineBreaksValid = false;
+
+    pthread_mutex_lock(&gEmboldenedGlyphsLock);
+    FlushEmboldenedGlyphs();
+    free(gEmboldenedGlyphs);
+    gEmboldenedGlyphs = NULL;
+    gEmboldenedGlyphsCapacity = 0;
+    pthread_mutex_unlock(&gEmboldenedGlyphsLock);
+
+    if (gTextSource != NULL)
+        TextSourceDispose(gTextSource);
+    gTextSource = NULL;
+    TextStoreDispose(&gTextStore);
+    gText = NULL;
+    gLength = 0;
+    free(gTextBuffer);
+    gTextBuffer = NULL;
+    gTextBufferCapacity = 0;
+    DisposeShapedText(&gShapedText);
+    DisposeShapedText(&gBoldfaceText);
+
+    // The styles, gStyle among them
+    DisposeStyleObjects(gStyleObjects, gStyleObjectsCapacity);
+    gStyleObjects = NULL;
+    gStyleObjectsCapacity = 0;
+    StylePoolDispose(&gStylePool);
+    StyleRunsDispose(&gStyleRuns);
+    gBaseStyle = gBoldfaceBaseStyle = kNoStyle;
+    gStyle = gBoldfaceStyle = NULL;
+    gNumFallbackFonts = 0;
+    while (gFontCoverages != NULL) {
+        MyFontCoverage		*next = gFontCoverages->next;
+
+        FontCoverageDispose(&gFontCoverages->coverage);
+        FontCoverageDispose(&gFontCoverages->unmatched);
+        free(gFontCoverages);
+        gFontCoverages = next;
+    }
+    StrokeCalibrationDispose(&gStrokeCalibration);
 }
@@ -52,6 +52,11 @@ Copyright 
 #ifndef MY_ATSUI_H
 #define MY_ATSUI_H
 
+#include "outline.h"
+#include "glyphcache.h"
+#include "displist.h"
+#include "stylepool.h"
+
 // Application-specific struct that gets passed to the curve callbacks.
 //
 typedef struct {
@@ -59,6 +64,7 @@ typedef struct {
     float				windowHeight;		// Height of the window (used to flip the y-coordinate for CG drawing)
     Boolean				first;				// Keeps track of which segment is first in a glyph
     Float32Point		current;			// The current pen position (used to filter degenerate cases)
+    GlyphOutline		*outline;			// Receives the contours of the glyph
 } MyCurveCallbackData;
 
 // Holds all information needed to draw a particular glyph
@@ -69,13 +75,50 @@ typedef struct {
     Float32Point		relativeOrigin;		// The origin of this glyph -- relative to the origin of the line.
 } MyGlyphRecord;
 
+// The boxes DrawATSUIStuff() draws the text in, for GetATSUIStuffDamageRect()
+//
+enum {
+    kATSUIStuffRegularBox				= 1 << 0,	// Box 1, the text without the extra bold
+    kATSUIStuffBoldBox					= 1 << 1,	// Box 2, the text with the extra bold
+    kATSUIStuffBothBoxes				= kATSUIStuffRegularBox | kATSUIStuffBoldBox
+};
+
+// The glyphs of some printed lines, from PrepareATSUIStuffLines().  Line i's glyphs
+// are glyphs[glyphStarts[i]] up to the start of line i + 1.
+//
+typedef struct {
+    ItemCount			numLines;
+    CGGlyph				*glyphs;
+    CGPoint				*positions;			// From the start of each line
+    StyleID				*styles;
+    ItemCount			*glyphStarts;		// numLines + 1 entries
+    Boolean				owned;				// Laid out again for these lines alone
+} MyLineGlyphs;
+
+// The attributes SetATSUIStuffStyle() sets
+//
+enum {
+    kATSUIStuffStyleFont				= 1 << 0,
+    kATSUIStuffStyleSize				= 1 << 1
+};
+
 
 void SetATSUIStuffFont(ATSUFontID inFont);
 void SetATSUIStuffFontSize(Fixed inSize);
 void UpdateATSUIStuffString(CFStringRef string);
+void SetATSUIStuffStyle(UniCharArrayOffset inStart, UniCharCount inLength, const StyleAttributes *inAttributes, UInt32 inWhich);
+OSStatus LoadATSUIStuffTextFile(const char *path);
 void UpdateATSUIStyle(void);
 void SetUpATSUIStuff(void);
+MyGlyphRecord *GetGlyphIDsAndPositions(ATSUTextLayout layout, ItemCount *outNumGlyphs);
 void DrawATSUIStuff(CGContextRef inContext, HIRect bounds);
+HIRect GetATSUIStuffDamageRect(HIRect bounds, UInt32 inBoxes);
+UInt32 GetATSUIStuffStrokeFactorBoxes(void);
+OSStatus BreakATSUIStuffIntoLines(float inLineWidth, ItemCount *outNumLines, float *outLineHeight);
+OSStatus PrepareATSUIStuffLines(ItemCount inFirstLine, ItemCount inNumLines, MyLineGlyphs *outLines);
+void RecordATSUIStuffLines(MyDisplayList *list, HIRect bounds, const MyLineGlyphs *inLines);
+void DisposeATSUIStuffLines(MyLineGlyphs *lines);
 void DisposeATSUIStuff(void);
+void GetATSUIGlyphCacheStats(GlyphCacheStats *outStats);
 
 #endif  /* MY_ATSUI_H */
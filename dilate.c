@@ -0,0 +1,297 @@
+/*
+
+File: dilate.c
+
+Abstract: Coverage mask dilation with SSE2, AVX2 and plain C kernels for
+SyntheticBoldDemo project. Has no Carbon dependencies.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dilate.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define DILATE_HAS_X86_KERNELS  1
+#include <immintrin.h>
+#endif
+
+// Every kernel does the same thing: for each pixel, the maximum of the 'inner'
+// rows, combined with the maximum of the 'outer' rows scaled by weight / 256.
+// Both passes of the dilation are expressed this way.  The horizontal pass uses
+// shifted pointers into a padded copy of one row; the vertical pass uses
+// pointers to neighbouring rows.  Pixels 'start' to 'width' - 1 are processed.
+//
+typedef void (*DilateKernelProc)(const unsigned char *const *inner, int innerCount,
+                                 const unsigned char *const *outer, int outerCount,
+                                 unsigned int weight, unsigned char *out, int start, int width);
+
+static DilateKernelProc     gDilateKernel = NULL;
+static const char           *gDilateKernelName = "none";
+
+
+// - = - Kernels - = -
+
+static void DilateKernelScalar(const unsigned char *const *inner, int innerCount,
+                               const unsigned char *const *outer, int outerCount,
+                               unsigned int weight, unsigned char *out, int start, int width)
+{
+    int             x, i;
+
+    for (x = start; x < width; x++) {
+        unsigned int    m = 0, o = 0;
+
+        for (i = 0; i < innerCount; i++)
+            if (inner[i][x] > m) m = inner[i][x];
+        for (i = 0; i < outerCount; i++)
+            if (outer[i][x] > o) o = outer[i][x];
+
+        o = (o * weight + 128) >> 8;
+        out[x] = (unsigned char) ((o > m) ? o : m);
+    }
+}
+
+
+#ifdef DILATE_HAS_X86_KERNELS
+
+__attribute__((target("sse2")))
+static void DilateKernelSSE2(const unsigned char *const *inner, int innerCount,
+                             const unsigned char *const *outer, int outerCount,
+                             unsigned int weight, unsigned char *out, int start, int width)
+{
+    const __m128i   zero = _mm_setzero_si128();
+    const __m128i   w = _mm_set1_epi16((short) weight);
+    const __m128i   half = _mm_set1_epi16(128);
+    int             x = start, i;
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i     m = zero, o = zero, lo, hi;
+
+        for (i = 0; i < innerCount; i++)
+            m = _mm_max_epu8(m, _mm_loadu_si128((const __m128i *) (inner[i] + x)));
+
+        if (outerCount > 0) {
+            for (i = 0; i < outerCount; i++)
+                o = _mm_max_epu8(o, _mm_loadu_si128((const __m128i *) (outer[i] + x)));
+
+            // Scale by weight / 256 in 16 bits; 255 * 256 + 128 still fits
+            lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(o, zero), w), half), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(o, zero), w), half), 8);
+            m = _mm_max_epu8(m, _mm_packus_epi16(lo, hi));
+        }
+
+        _mm_storeu_si128((__m128i *) (out + x), m);
+    }
+
+    // Finish the row one pixel at a time
+    if (x < width)
+        DilateKernelScalar(inner, innerCount, outer, outerCount, weight, out, x, width);
+}
+
+
+__attribute__((target("avx2")))
+static void DilateKernelAVX2(const unsigned char *const *inner, int innerCount,
+                             const unsigned char *const *outer, int outerCount,
+                             unsigned int weight, unsigned char *out, int start, int width)
+{
+    const __m256i   zero = _mm256_setzero_si256();
+    const __m256i   w = _mm256_set1_epi16((short) weight);
+    const __m256i   half = _mm256_set1_epi16(128);
+    int             x = start;
+
+    for (; x + 32 <= width; x += 32) {
+        __m256i     m = zero, o = zero, lo, hi;
+        int         i;
+
+        for (i = 0; i < innerCount; i++)
+            m = _mm256_max_epu8(m, _mm256_loadu_si256((const __m256i *) (inner[i] + x)));
+
+        if (outerCount > 0) {
+            for (i = 0; i < outerCount; i++)
+                o = _mm256_max_epu8(o, _mm256_loadu_si256((const __m256i *) (outer[i] + x)));
+
+            // Unpack and pack both work within 128-bit lanes, so the pixel order survives
+            lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(o, zero), w), half), 8);
+            hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(o, zero), w), half), 8);
+            m = _mm256_max_epu8(m, _mm256_packus_epi16(lo, hi));
+        }
+
+        _mm256_storeu_si256((__m256i *) (out + x), m);
+    }
+
+    // Less than 32 pixels are left; the SSE2 kernel handles them
+    if (x < width)
+        DilateKernelSSE2(inner, innerCount, outer, outerCount, weight, out, x, width);
+}
+
+#endif  /* DILATE_HAS_X86_KERNELS */
+
+
+// - = - Kernel selection - = -
+
+// Chooses the kernel to use.  Returns zero on success, or -1 if the CPU cannot run
+// the requested kernel, in which case the current choice is left alone.
+//
+int DilateSetKernel(int kernel)
+{
+#ifdef DILATE_HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if (kernel == kDilateKernelAuto)
+        kernel = __builtin_cpu_supports("avx2") ? kDilateKernelAVX2
+               : __builtin_cpu_supports("sse2") ? kDilateKernelSSE2 : kDilateKernelScalar;
+
+    if (kernel == kDilateKernelAVX2 && __builtin_cpu_supports("avx2")) {
+        gDilateKernel = DilateKernelAVX2;
+        gDilateKernelName = "avx2";
+        return 0;
+    }
+    if (kernel == kDilateKernelSSE2 && __builtin_cpu_supports("sse2")) {
+        gDilateKernel = DilateKernelSSE2;
+        gDilateKernelName = "sse2";
+        return 0;
+    }
+#else
+    if (kernel == kDilateKernelAuto)
+        kernel = kDilateKernelScalar;
+#endif
+
+    if (kernel == kDilateKernelScalar) {
+        gDilateKernel = DilateKernelScalar;
+        gDilateKernelName = "scalar";
+        return 0;
+    }
+    return -1;
+}
+
+
+// Name of the kernel in use, for logging and benchmarks
+//
+const char *DilateGetKernelName(void)
+{
+    if (gDilateKernel == NULL)
+        DilateSetKernel(kDilateKernelAuto);
+    return gDilateKernelName;
+}
+
+
+// - = - Dilation - = -
+
+// The dilation radius that matches emboldening by stroking.  A stroke of width
+// factor * size grows the glyph by half of that on every side.
+//
+float DilateRadiusForStroke(float strokeThicknessFactor, float pointSize)
+{
+    return strokeThicknessFactor * pointSize / 2.0f;
+}
+
+
+// Grows the coverage in 'src' by 'radius' pixels in every direction and writes the
+// result to 'dst', which must not overlap 'src'.  The structuring element is a
+// square whose outermost ring is weighted by the fractional part of the radius, so
+// the weight changes smoothly as the radius does.  Coverage that would grow past
+// the edges of the mask is lost, so the caller leaves a margin of ceil(radius)
+// pixels around the ink.  Returns zero on success.
+//
+int DilateMask(const unsigned char *src, size_t srcRowBytes, unsigned char *dst, size_t dstRowBytes,
+               int width, int height, float radius)
+{
+    const unsigned char     **inner, *outer[2];
+    unsigned char           *temp, *padded, *zeroRow;
+    unsigned int            weight;
+    int                     n, outerCount, y, d;
+
+    if (width <= 0 || height <= 0) return 0;
+    if (gDilateKernel == NULL)
+        DilateSetKernel(kDilateKernelAuto);
+
+    // Split the radius into whole pixels and a weight for the next ring out
+    if (radius < 0) radius = 0;
+    n = (int) floorf(radius);
+    weight = (unsigned int) ((radius - n) * 256.0f + 0.5f);
+    if (weight >= 256) {
+        n++;
+        weight = 0;
+    }
+    outerCount = (weight > 0) ? 2 : 0;
+
+    // One intermediate mask, one padded row for the horizontal pass, and a row of zeros
+    // standing in for the rows above and below the mask in the vertical pass
+    temp = (unsigned char *) malloc((size_t) width * height + (width + 2 * (n + 1)) + width);
+    inner = (const unsigned char **) malloc((2 * n + 1) * sizeof(const unsigned char *));
+    if (temp == NULL || inner == NULL) {
+        free(temp);
+        free((void *) inner);
+        return -1;
+    }
+    padded = temp + (size_t) width * height;
+    zeroRow = padded + width + 2 * (n + 1);
+    memset(padded, 0, width + 2 * (n + 1));
+    memset(zeroRow, 0, width);
+
+    // Horizontal pass, from 'src' into 'temp'
+    for (d = -n; d <= n; d++)
+        inner[d + n] = padded + (n + 1) + d;
+    outer[0] = padded;
+    outer[1] = padded + 2 * (n + 1);
+    for (y = 0; y < height; y++) {
+        memcpy(padded + n + 1, src + y * srcRowBytes, width);
+        gDilateKernel(inner, 2 * n + 1, outer, outerCount, weight, temp + (size_t) y * width, 0, width);
+    }
+
+    // Vertical pass, from 'temp' into 'dst'
+    for (y = 0; y < height; y++) {
+        for (d = -n; d <= n; d++)
+            inner[d + n] = (y + d >= 0 && y + d < height) ? temp + (size_t) (y + d) * width : zeroRow;
+        outer[0] = (y - n - 1 >= 0) ? temp + (size_t) (y - n - 1) * width : zeroRow;
+        outer[1] = (y + n + 1 < height) ? temp + (size_t) (y + n + 1) * width : zeroRow;
+        gDilateKernel(inner, 2 * n + 1, outer, outerCount, weight, dst + y * dstRowBytes, 0, width);
+    }
+
+    free(temp);
+    free((void *) inner);
+    return 0;
+}
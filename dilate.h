@@ -0,0 +1,87 @@
+/*
+
+File: dilate.h
+
+Abstract: Coverage mask dilation for raster-space synthetic bold in
+SyntheticBoldDemo project. Has no Carbon dependencies.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_DILATE_H
+#define MY_DILATE_H
+
+// Raster-space synthetic bold.  Instead of emboldening every glyph outline, the
+// coverage mask of a whole line of text is grown by a fractional radius with a
+// morphological dilation: each pixel becomes the maximum of a square window around
+// it, taken as a horizontal and then a vertical pass.  Each pass reads the whole
+// window, 2 * ceil(radius) + 1 pixels, for every pixel, so the cost grows with the
+// radius; text is emboldened by a few pixels at most.  Plain C with no Carbon
+// dependencies, like raster.h.
+//
+// The inner loop has SSE2 and AVX2 versions on x86.  The fastest one the CPU
+// supports is picked the first time DilateMask() is called; other CPUs use the
+// plain C version.
+
+#include <stddef.h>
+
+// Kernel selection
+//
+enum {
+    kDilateKernelAuto       = 0,                // Fastest kernel the CPU supports
+    kDilateKernelScalar     = 1,
+    kDilateKernelSSE2       = 2,
+    kDilateKernelAVX2       = 3
+};
+
+
+float DilateRadiusForStroke(float strokeThicknessFactor, float pointSize);
+
+int DilateMask(const unsigned char *src, size_t srcRowBytes, unsigned char *dst, size_t dstRowBytes,
+               int width, int height, float radius);
+
+int DilateSetKernel(int kernel);
+const char *DilateGetKernelName(void);
+
+#endif  /* MY_DILATE_H */
@@ -0,0 +1,244 @@
+/*
+
+File: displist.c
+
+Abstract: Display lists: drawing recorded once and played back
+into any CGContext.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include "globals.h"
+#include "displist.h"
+
+
+// Makes room for one more item and returns it, cleared
+//
+static MyDisplayItem *NewDisplayItem(MyDisplayList *list, UInt32 kind)
+{
+    MyDisplayItem			*item;
+
+    if (list->count == list->capacity) {
+        ItemCount			newCapacity = (list->capacity == 0) ? 16 : list->capacity * 2;
+        MyDisplayItem		*newItems;
+
+        newItems = (MyDisplayItem *) realloc(list->items, newCapacity * sizeof(MyDisplayItem));
+        if (newItems == NULL)
+            return NULL;
+        list->items = newItems;
+        list->capacity = newCapacity;
+    }
+
+    item = &list->items[list->count++];
+    memset(item, 0, sizeof(MyDisplayItem));
+    item->kind = kind;
+    return item;
+}
+
+
+void DisplayListInit(MyDisplayList *list)
+{
+    memset(list, 0, sizeof(MyDisplayList));
+}
+
+
+// Releases all the items but keeps the storage for recording again
+//
+void DisplayListReset(MyDisplayList *list)
+{
+    ItemCount				i;
+
+    for (i = 0; i < list->count; i++) {
+        MyDisplayItem		*item = &list->items[i];
+
+        if (item->font != NULL)
+            CGFontRelease(item->font);
+        if (item->path != NULL)
+            CGPathRelease(item->path);
+        if (item->image != NULL)
+            CGImageRelease(item->image);
+        free(item->glyphs);
+        free(item->positions);
+    }
+    list->count = 0;
+}
+
+
+void DisplayListDispose(MyDisplayList *list)
+{
+    DisplayListReset(list);
+    free(list->items);
+    DisplayListInit(list);
+}
+
+
+// Records a run of glyphs with their line origin at (x, y).  The glyphs and
+// positions are copied.
+//
+OSStatus DisplayListAddGlyphs(MyDisplayList *list, CGFontRef font, float fontSize, const CGGlyph *glyphs, const CGPoint *positions, size_t count, float x, float y)
+{
+    MyDisplayItem			*item;
+
+    item = NewDisplayItem(list, kDisplayItemGlyphs);
+    require(item != NULL, CantAddItem);
+
+    item->origin = CGPointMake(x, y);
+    item->font = CGFontRetain(font);
+    item->fontSize = fontSize;
+    item->count = count;
+    item->glyphs = (CGGlyph *) malloc((count + 1) * sizeof(CGGlyph));
+    item->positions = (CGPoint *) malloc((count + 1) * sizeof(CGPoint));
+    require(item->glyphs != NULL && item->positions != NULL, CantAddItem);
+
+    memcpy(item->glyphs, glyphs, count * sizeof(CGGlyph));
+    memcpy(item->positions, positions, count * sizeof(CGPoint));
+    return noErr;
+
+CantAddItem:
+    return memFullErr;
+}
+
+
+// Records a path to be filled.  The path is retained.
+//
+OSStatus DisplayListAddFillPath(MyDisplayList *list, CGPathRef path)
+{
+    MyDisplayItem			*item;
+
+    item = NewDisplayItem(list, kDisplayItemFillPath);
+    require(item != NULL, CantAddItem);
+
+    item->path = CGPathRetain(path);
+    return noErr;
+
+CantAddItem:
+    return memFullErr;
+}
+
+
+// Records an image to be drawn into rect.  The image is retained.
+//
+OSStatus DisplayListAddImage(MyDisplayList *list, CGImageRef image, CGRect rect)
+{
+    MyDisplayItem			*item;
+
+    item = NewDisplayItem(list, kDisplayItemImage);
+    require(item != NULL, CantAddItem);
+
+    item->image = CGImageRetain(image);
+    item->rect = rect;
+    return noErr;
+
+CantAddItem:
+    return memFullErr;
+}
+
+
+// Records a rect to be filled through a mask.  The mask is retained.
+//
+OSStatus DisplayListAddFillMask(MyDisplayList *list, CGImageRef mask, CGRect rect)
+{
+    MyDisplayItem			*item;
+
+    item = NewDisplayItem(list, kDisplayItemFillMask);
+    require(item != NULL, CantAddItem);
+
+    item->image = CGImageRetain(mask);
+    item->rect = rect;
+    return noErr;
+
+CantAddItem:
+    return memFullErr;
+}
+
+
+// Plays the items back into a context, in the order they were recorded
+//
+void DisplayListReplay(const MyDisplayList *list, CGContextRef inContext)
+{
+    ItemCount				i;
+
+    for (i = 0; i < list->count; i++) {
+        const MyDisplayItem	*item = &list->items[i];
+
+        switch (item->kind) {
+            case kDisplayItemGlyphs:
+                if (item->glyphs == NULL || item->positions == NULL)
+                    break;
+                CGContextSetFont(inContext, item->font);
+                CGContextSetFontSize(inContext, item->fontSize);
+                CGContextSetTextMatrix(inContext, CGAffineTransformMakeTranslation(item->origin.x, item->origin.y));
+                CGContextShowGlyphsAtPositions(inContext, item->glyphs, item->positions, item->count);
+                break;
+
+            case kDisplayItemFillPath:
+                CGContextAddPath(inContext, item->path);
+                CGContextFillPath(inContext);
+                break;
+
+            case kDisplayItemImage:
+                CGContextDrawImage(inContext, item->rect, item->image);
+                break;
+
+            case kDisplayItemFillMask:
+                CGContextSaveGState(inContext);
+                CGContextClipToMask(inContext, item->rect, item->image);
+                CGContextFillRect(inContext, item->rect);
+                CGContextRestoreGState(inContext);
+                break;
+        }
+    }
+}
+
+
+// Plays the items back with the transform applied on top of the context's own.
+// The context is left as it was.
+//
+void DisplayListReplayWithTransform(const MyDisplayList *list, CGContextRef inContext, CGAffineTransform transform)
+{
+    CGContextSaveGState(inContext);
+    CGContextConcatCTM(inContext, transform);
+    DisplayListReplay(list, inContext);
+    CGContextRestoreGState(inContext);
+}
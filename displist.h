@@ -0,0 +1,98 @@
+/*
+
+File: displist.h
+
+Abstract: Display lists: drawing recorded once and played back
+into any CGContext.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_DISPLIST_H
+#define MY_DISPLIST_H
+
+// A recorded sequence of drawing operations that can be played back into any
+// CGContext.  Recording does not touch a context, so a list can be built on one
+// thread and replayed on another.
+
+// The kinds of items
+//
+enum {
+    kDisplayItemGlyphs      = 0,        // A run of glyphs shown with CGContextShowGlyphsAtPositions()
+    kDisplayItemFillPath    = 1,        // A path filled with the current fill color
+    kDisplayItemImage       = 2,        // An image drawn into a rect; image masks use the fill color
+    kDisplayItemFillMask    = 3         // A rect filled with the current fill color through a mask
+};
+
+typedef struct {
+    UInt32				kind;
+    CGPoint				origin;				// Where the glyph run's line starts
+    CGFontRef			font;				// Retained
+    float				fontSize;
+    CGGlyph				*glyphs;
+    CGPoint				*positions;			// Relative to origin
+    size_t				count;
+    CGPathRef			path;				// Retained
+    CGImageRef			image;				// Retained; the image or the mask
+    CGRect				rect;				// Where the image or mask goes
+} MyDisplayItem;
+
+typedef struct {
+    MyDisplayItem		*items;
+    ItemCount			count;
+    ItemCount			capacity;
+} MyDisplayList;
+
+
+void DisplayListInit(MyDisplayList *list);
+void DisplayListReset(MyDisplayList *list);
+void DisplayListDispose(MyDisplayList *list);
+OSStatus DisplayListAddGlyphs(MyDisplayList *list, CGFontRef font, float fontSize, const CGGlyph *glyphs, const CGPoint *positions, size_t count, float x, float y);
+OSStatus DisplayListAddFillPath(MyDisplayList *list, CGPathRef path);
+OSStatus DisplayListAddImage(MyDisplayList *list, CGImageRef image, CGRect rect);
+OSStatus DisplayListAddFillMask(MyDisplayList *list, CGImageRef mask, CGRect rect);
+void DisplayListReplay(const MyDisplayList *list, CGContextRef inContext);
+void DisplayListReplayWithTransform(const MyDisplayList *list, CGContextRef inContext, CGAffineTransform transform);
+
+#endif  /* MY_DISPLIST_H */
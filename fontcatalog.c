@@ -0,0 +1,458 @@
+/*
+
+File: fontcatalog.c
+
+Abstract: A catalog of the installed fonts, kept in a file
+between launches.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fontcatalog.h"
+
+// The file starts with a header, then the directories, the entries sorted by name,
+// the entry numbers sorted by family and style, and the strings.  Names and paths
+// are offsets into the strings.  Numbers are in the byte order of the machine
+// that wrote the file; a catalog from another one fails the magic number check.
+//
+#define kFontCatalogMagic       0x53424643      // 'SBFC'
+#define kFontCatalogVersion     1
+
+typedef struct {
+    unsigned int        magic;
+    unsigned int        version;
+    unsigned int        generation;
+    unsigned int        numEntries;
+    unsigned int        numDirectories;
+    unsigned int        stringsSize;
+} FontCatalogHeader;
+
+typedef struct {
+    unsigned int        path;
+    unsigned int        reserved;
+    long long           modified;           // -1 if the directory did not exist
+} FontCatalogDirectory;
+
+typedef struct {
+    unsigned int        fontRef;
+    int                 family;
+    int                 style;
+    unsigned int        name;
+    unsigned int        path;
+    unsigned int        reserved;
+    long long           modified;
+} FontCatalogRecord;
+
+
+// Returns the modification time of a file or directory, or -1 if it does not exist
+//
+static long long GetModificationTime(const char *path)
+{
+    struct stat         info;
+
+    if (stat(path, &info) != 0) return -1;
+    return (long long) info.st_mtime;
+}
+
+
+int FontCatalogOpen(FontCatalog *catalog, const char *fileName)
+{
+    const FontCatalogHeader *header;
+    struct stat         info;
+    size_t              expected;
+    void                *bytes;
+    int                 fd;
+
+    memset(catalog, 0, sizeof(FontCatalog));
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0) return -1;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(FontCatalogHeader)) {
+        close(fd);
+        return -1;
+    }
+    bytes = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (bytes == MAP_FAILED) return -1;
+
+    catalog->bytes = (const unsigned char *) bytes;
+    catalog->size = (size_t) info.st_size;
+
+    // Check the header and that the parts add up to the size of the file
+    header = (const FontCatalogHeader *) bytes;
+    expected = sizeof(FontCatalogHeader) + (size_t) header->numDirectories * sizeof(FontCatalogDirectory)
+             + (size_t) header->numEntries * (sizeof(FontCatalogRecord) + sizeof(unsigned int)) + header->stringsSize;
+    if (header->magic != kFontCatalogMagic || header->version != kFontCatalogVersion
+        || header->numEntries > catalog->size || header->numDirectories > catalog->size
+        || expected != catalog->size || header->stringsSize == 0) {
+        FontCatalogDispose(catalog);
+        return -1;
+    }
+
+    catalog->generation = header->generation;
+    catalog->numEntries = header->numEntries;
+    catalog->numDirectories = header->numDirectories;
+    catalog->directories = catalog->bytes + sizeof(FontCatalogHeader);
+    catalog->entries = (const FontCatalogDirectory *) catalog->directories + catalog->numDirectories;
+    catalog->byFamily = (const unsigned int *) ((const FontCatalogRecord *) catalog->entries + catalog->numEntries);
+    catalog->strings = (const char *) (catalog->byFamily + catalog->numEntries);
+    catalog->stringsSize = header->stringsSize;
+
+    // Every string must end inside the file
+    if (catalog->strings[catalog->stringsSize - 1] != '\0') {
+        FontCatalogDispose(catalog);
+        return -1;
+    }
+    return 0;
+}
+
+
+void FontCatalogDispose(FontCatalog *catalog)
+{
+    if (catalog->bytes != NULL)
+        munmap((void *) catalog->bytes, catalog->size);
+    memset(catalog, 0, sizeof(FontCatalog));
+}
+
+
+static const char *GetCatalogString(const FontCatalog *catalog, unsigned int offset)
+{
+    return (offset < catalog->stringsSize) ? catalog->strings + offset : "";
+}
+
+
+// True if the catalog was written for this font generation and none of the font
+// directories have changed since
+//
+int FontCatalogIsCurrent(const FontCatalog *catalog, unsigned int generation)
+{
+    const FontCatalogDirectory *directories = (const FontCatalogDirectory *) catalog->directories;
+    unsigned int        i;
+
+    if (catalog->bytes == NULL || catalog->generation != generation)
+        return 0;
+    for (i = 0; i < catalog->numDirectories; i++) {
+        if (GetModificationTime(GetCatalogString(catalog, directories[i].path)) != directories[i].modified)
+            return 0;
+    }
+    return 1;
+}
+
+
+void FontCatalogGetEntry(const FontCatalog *catalog, unsigned int index, FontCatalogEntry *outEntry)
+{
+    const FontCatalogRecord *record = (const FontCatalogRecord *) catalog->entries + index;
+
+    outEntry->fontRef = record->fontRef;
+    outEntry->family = record->family;
+    outEntry->style = record->style;
+    outEntry->name = GetCatalogString(catalog, record->name);
+    outEntry->path = GetCatalogString(catalog, record->path);
+    outEntry->modified = record->modified;
+}
+
+
+// Returns the number of the entry with the given full name, or -1
+//
+int FontCatalogFindByName(const FontCatalog *catalog, const char *name)
+{
+    const FontCatalogRecord *records = (const FontCatalogRecord *) catalog->entries;
+    unsigned int        low = 0, high = catalog->numEntries;
+
+    while (low < high) {
+        unsigned int    mid = low + (high - low) / 2;
+        int             order = strcmp(GetCatalogString(catalog, records[mid].name), name);
+
+        if (order == 0) return (int) mid;
+        if (order < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return -1;
+}
+
+
+static int CompareFamilyStyle(int family1, int style1, int family2, int style2)
+{
+    if (family1 != family2) return (family1 < family2) ? -1 : 1;
+    if (style1 != style2) return (style1 < style2) ? -1 : 1;
+    return 0;
+}
+
+
+// Returns the number of the entry for the given family and style, or -1
+//
+int FontCatalogFindByFamily(const FontCatalog *catalog, int family, int style)
+{
+    const FontCatalogRecord *records = (const FontCatalogRecord *) catalog->entries;
+    unsigned int        low = 0, high = catalog->numEntries;
+
+    while (low < high) {
+        unsigned int    mid = low + (high - low) / 2;
+        unsigned int    index = catalog->byFamily[mid];
+        int             order;
+
+        if (index >= catalog->numEntries) return -1;
+        order = CompareFamilyStyle(records[index].family, records[index].style, family, style);
+        if (order == 0) return (int) index;
+        if (order < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return -1;
+}
+
+
+void FontCatalogBuilderInit(FontCatalogBuilder *builder)
+{
+    memset(builder, 0, sizeof(FontCatalogBuilder));
+}
+
+
+void FontCatalogBuilderDispose(FontCatalogBuilder *builder)
+{
+    size_t              i;
+
+    for (i = 0; i < builder->numEntries; i++) {
+        free((char *) builder->entries[i].name);
+        free((char *) builder->entries[i].path);
+    }
+    for (i = 0; i < builder->numDirectories; i++)
+        free(builder->directories[i]);
+    free(builder->entries);
+    free(builder->directories);
+    FontCatalogBuilderInit(builder);
+}
+
+
+static char *CopyString(const char *s)
+{
+    char                *copy = (char *) malloc(strlen(s) + 1);
+
+    if (copy != NULL)
+        strcpy(copy, s);
+    return copy;
+}
+
+
+// Adds a font.  The name and path are copied.  Returns zero on success.
+//
+int FontCatalogBuilderAddFont(FontCatalogBuilder *builder, const FontCatalogEntry *entry)
+{
+    FontCatalogEntry    *copy;
+
+    if (builder->numEntries == builder->entryCapacity) {
+        size_t              newCapacity = (builder->entryCapacity == 0) ? 256 : builder->entryCapacity * 2;
+        FontCatalogEntry    *newEntries = (FontCatalogEntry *) realloc(builder->entries, newCapacity * sizeof(FontCatalogEntry));
+
+        if (newEntries == NULL) return -1;
+        builder->entries = newEntries;
+        builder->entryCapacity = newCapacity;
+    }
+
+    copy = &builder->entries[builder->numEntries];
+    *copy = *entry;
+    copy->name = CopyString(entry->name);
+    copy->path = CopyString(entry->path);
+    if (copy->name == NULL || copy->path == NULL) {
+        free((char *) copy->name);
+        free((char *) copy->path);
+        return -1;
+    }
+    builder->numEntries++;
+    return 0;
+}
+
+
+// Adds a directory whose modification time decides whether the catalog is current.
+// Adding the same directory twice does nothing.  Returns zero on success.
+//
+int FontCatalogBuilderAddDirectory(FontCatalogBuilder *builder, const char *path)
+{
+    size_t              i;
+
+    for (i = 0; i < builder->numDirectories; i++) {
+        if (strcmp(builder->directories[i], path) == 0) return 0;
+    }
+
+    if (builder->numDirectories == builder->directoryCapacity) {
+        size_t          newCapacity = (builder->directoryCapacity == 0) ? 16 : builder->directoryCapacity * 2;
+        char            **newDirectories = (char **) realloc(builder->directories, newCapacity * sizeof(char *));
+
+        if (newDirectories == NULL) return -1;
+        builder->directories = newDirectories;
+        builder->directoryCapacity = newCapacity;
+    }
+
+    builder->directories[builder->numDirectories] = CopyString(path);
+    if (builder->directories[builder->numDirectories] == NULL) return -1;
+    builder->numDirectories++;
+    return 0;
+}
+
+
+static int CompareEntryNames(const void *a, const void *b)
+{
+    return strcmp(((const FontCatalogEntry *) a)->name, ((const FontCatalogEntry *) b)->name);
+}
+
+
+// qsort() has no context argument, so the family order is sorted through this
+//
+static const FontCatalogEntry *gSortEntries;
+
+static int CompareEntryFamilies(const void *a, const void *b)
+{
+    const FontCatalogEntry  *e1 = &gSortEntries[*(const unsigned int *) a];
+    const FontCatalogEntry  *e2 = &gSortEntries[*(const unsigned int *) b];
+
+    return CompareFamilyStyle(e1->family, e1->style, e2->family, e2->style);
+}
+
+
+// Appends a string to the string table, returning its offset
+//
+static unsigned int AddString(char *strings, size_t *size, const char *s)
+{
+    size_t              offset = *size, length = strlen(s) + 1;
+
+    memcpy(strings + offset, s, length);
+    *size += length;
+    return (unsigned int) offset;
+}
+
+
+// Writes the catalog to a file, replacing any catalog already there only once the
+// new one is complete.  The directories' modification times are taken now.
+// Returns zero on success.
+//
+int FontCatalogBuilderWrite(FontCatalogBuilder *builder, const char *fileName, unsigned int generation)
+{
+    FontCatalogHeader   header;
+    FontCatalogDirectory *directories = NULL;
+    FontCatalogRecord   *records = NULL;
+    unsigned int        *byFamily = NULL;
+    char                *strings = NULL, *tempName = NULL;
+    size_t              stringsCapacity = 1, stringsSize = 0, i;
+    FILE                *file = NULL;
+    int                 result = -1;
+
+    if (builder->numEntries > 0)
+        qsort(builder->entries, builder->numEntries, sizeof(FontCatalogEntry), CompareEntryNames);
+
+    for (i = 0; i < builder->numEntries; i++)
+        stringsCapacity += strlen(builder->entries[i].name) + strlen(builder->entries[i].path) + 2;
+    for (i = 0; i < builder->numDirectories; i++)
+        stringsCapacity += strlen(builder->directories[i]) + 1;
+
+    directories = (FontCatalogDirectory *) calloc(builder->numDirectories + 1, sizeof(FontCatalogDirectory));
+    records = (FontCatalogRecord *) calloc(builder->numEntries + 1, sizeof(FontCatalogRecord));
+    byFamily = (unsigned int *) malloc((builder->numEntries + 1) * sizeof(unsigned int));
+    strings = (char *) malloc(stringsCapacity);
+    tempName = (char *) malloc(strlen(fileName) + 8);
+    if (directories == NULL || records == NULL || byFamily == NULL || strings == NULL || tempName == NULL)
+        goto done;
+
+    // The table starts with an empty string, so no string is ever at offset zero
+    strings[stringsSize++] = '\0';
+
+    for (i = 0; i < builder->numDirectories; i++) {
+        directories[i].path = AddString(strings, &stringsSize, builder->directories[i]);
+        directories[i].modified = GetModificationTime(builder->directories[i]);
+    }
+    for (i = 0; i < builder->numEntries; i++) {
+        const FontCatalogEntry *entry = &builder->entries[i];
+
+        records[i].fontRef = entry->fontRef;
+        records[i].family = entry->family;
+        records[i].style = entry->style;
+        records[i].name = AddString(strings, &stringsSize, entry->name);
+        records[i].path = AddString(strings, &stringsSize, entry->path);
+        records[i].modified = entry->modified;
+        byFamily[i] = (unsigned int) i;
+    }
+    gSortEntries = builder->entries;
+    qsort(byFamily, builder->numEntries, sizeof(unsigned int), CompareEntryFamilies);
+
+    header.magic = kFontCatalogMagic;
+    header.version = kFontCatalogVersion;
+    header.generation = generation;
+    header.numEntries = (unsigned int) builder->numEntries;
+    header.numDirectories = (unsigned int) builder->numDirectories;
+    header.stringsSize = (unsigned int) stringsSize;
+
+    sprintf(tempName, "%s.new", fileName);
+    file = fopen(tempName, "wb");
+    if (file == NULL) goto done;
+    if (fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(directories, sizeof(FontCatalogDirectory), builder->numDirectories, file) == builder->numDirectories
+        && fwrite(records, sizeof(FontCatalogRecord), builder->numEntries, file) == builder->numEntries
+        && fwrite(byFamily, sizeof(unsigned int), builder->numEntries, file) == builder->numEntries
+        && fwrite(strings, 1, stringsSize, file) == stringsSize)
+        result = 0;
+    if (fclose(file) != 0)
+        result = -1;
+    if (result == 0 && rename(tempName, fileName) != 0)
+        result = -1;
+    if (result != 0)
+        unlink(tempName);
+
+done:
+    free(directories);
+    free(records);
+    free(byFamily);
+    free(strings);
+    free(tempName);
+    return result;
+}
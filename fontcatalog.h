@@ -0,0 +1,112 @@
+/*
+
+File: fontcatalog.h
+
+Abstract: A catalog of the installed fonts, kept in a file
+between launches.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_FONTCATALOG_H
+#define MY_FONTCATALOG_H
+
+// A catalog of the installed fonts, written to a file so the next launch can find
+// a font without asking the system about every one.  The file is mapped, not read,
+// and is sorted so a font can be found by name, or by family and style, with a
+// binary search.  It records the modification times of the font directories and
+// is out of date once any of them change.  Plain C with no Carbon dependencies.
+
+#include <stddef.h>
+
+typedef struct {
+    unsigned int        fontRef;            // The platform's reference to the font
+    int                 family;
+    int                 style;
+    const char          *name;              // Full name, in UTF-8
+    const char          *path;              // The file the font is in
+    long long           modified;           // The file's modification time
+} FontCatalogEntry;
+
+// A catalog file, mapped
+//
+typedef struct {
+    const unsigned char *bytes;             // NULL if there is no catalog
+    size_t              size;
+    unsigned int        generation;         // The platform's font generation when written
+    unsigned int        numEntries;
+    unsigned int        numDirectories;
+    const void          *directories;
+    const void          *entries;           // Sorted by name
+    const unsigned int  *byFamily;          // Entry numbers, sorted by family and style
+    const char          *strings;
+    unsigned int        stringsSize;
+} FontCatalog;
+
+// A catalog being put together, to be written out
+//
+typedef struct {
+    FontCatalogEntry    *entries;           // Names and paths are copies
+    size_t              numEntries;
+    size_t              entryCapacity;
+    char                **directories;
+    size_t              numDirectories;
+    size_t              directoryCapacity;
+} FontCatalogBuilder;
+
+
+int FontCatalogOpen(FontCatalog *catalog, const char *fileName);
+void FontCatalogDispose(FontCatalog *catalog);
+int FontCatalogIsCurrent(const FontCatalog *catalog, unsigned int generation);
+void FontCatalogGetEntry(const FontCatalog *catalog, unsigned int index, FontCatalogEntry *outEntry);
+int FontCatalogFindByName(const FontCatalog *catalog, const char *name);
+int FontCatalogFindByFamily(const FontCatalog *catalog, int family, int style);
+
+void FontCatalogBuilderInit(FontCatalogBuilder *builder);
+void FontCatalogBuilderDispose(FontCatalogBuilder *builder);
+int FontCatalogBuilderAddFont(FontCatalogBuilder *builder, const FontCatalogEntry *entry);
+int FontCatalogBuilderAddDirectory(FontCatalogBuilder *builder, const char *path);
+int FontCatalogBuilderWrite(FontCatalogBuilder *builder, const char *fileName, unsigned int generation);
+
+#endif  /* MY_FONTCATALOG_H */
@@ -0,0 +1,669 @@
+/*
+
+File: fontfile.c
+
+Abstract: Minimal TrueType font reader for SyntheticBoldDemo project. Provides
+character to glyph mapping, advances and glyph outlines without ATSUI.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fontfile.h"
+
+// Glyph outline flags (see the 'glyf' table in the TrueType reference)
+//
+enum {
+    kOnCurvePoint               = 0x01,
+    kXShortVector               = 0x02,
+    kYShortVector               = 0x04,
+    kRepeatFlag                 = 0x08,
+    kXIsSameOrPositive          = 0x10,
+    kYIsSameOrPositive          = 0x20
+};
+
+// Composite glyph flags
+//
+enum {
+    kArg1And2AreWords           = 0x0001,
+    kArgsAreXYValues            = 0x0002,
+    kWeHaveAScale               = 0x0008,
+    kMoreComponents             = 0x0020,
+    kWeHaveAnXAndYScale         = 0x0040,
+    kWeHaveATwoByTwo            = 0x0080
+};
+
+// Composite glyphs may nest; this guards against malformed fonts that loop
+//
+#define kMaxCompositeDepth      8
+
+// An affine transform in font units, used when expanding composite glyphs
+//
+typedef struct {
+    float   a, b, c, d, e, f;
+} GlyphTransform;
+
+
+// Big-endian readers.  All offsets are checked against the file length by the callers.
+//
+static unsigned int ReadU16(const unsigned char *p)
+{
+    return ((unsigned int) p[0] << 8) | p[1];
+}
+
+
+static int ReadS16(const unsigned char *p)
+{
+    return (short) ReadU16(p);
+}
+
+
+static unsigned long ReadU32(const unsigned char *p)
+{
+    return ((unsigned long) p[0] << 24) | ((unsigned long) p[1] << 16) | ((unsigned long) p[2] << 8) | p[3];
+}
+
+
+// Finds a table in the font directory.  Returns zero if the table does not exist.
+//
+static size_t FindTable(const FontFile *font, size_t directory, const char *tag, size_t *length)
+{
+    unsigned int    numTables, i;
+
+    if (directory + 12 > font->length) return 0;
+    numTables = ReadU16(font->data + directory + 4);
+
+    for (i = 0; i < numTables; i++) {
+        const unsigned char *record = font->data + directory + 12 + 16 * i;
+        size_t              offset, tableLength;
+
+        if ((size_t) (record + 16 - font->data) > font->length) return 0;
+        if (memcmp(record, tag, 4) != 0) continue;
+
+        offset = ReadU32(record + 8);
+        tableLength = ReadU32(record + 12);
+        if (offset + tableLength > font->length) return 0;
+        if (length != NULL) *length = tableLength;
+        return offset;
+    }
+    return 0;
+}
+
+
+// Picks the best Unicode cmap subtable.  Full-repertoire (format 12) tables are
+// preferred over BMP-only (format 4) ones.
+//
+static int ChooseCmapSubtable(FontFile *font, size_t cmap, size_t cmapLength)
+{
+    unsigned int    numTables, i;
+    size_t          bmp = 0, full = 0;
+
+    if (cmapLength < 4) return 0;
+    numTables = ReadU16(font->data + cmap + 2);
+    if (4 + 8 * numTables > cmapLength) return 0;
+
+    for (i = 0; i < numTables; i++) {
+        const unsigned char *record = font->data + cmap + 4 + 8 * i;
+        unsigned int        platform = ReadU16(record);
+        unsigned int        encoding = ReadU16(record + 2);
+        size_t              offset = ReadU32(record + 4);
+        unsigned int        format;
+
+        if (offset + 4 > cmapLength) continue;
+        if ( ! (platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10))) ) continue;
+
+        format = ReadU16(font->data + cmap + offset);
+        if (format == 12 && full == 0) full = cmap + offset;
+        if (format == 4 && bmp == 0) bmp = cmap + offset;
+    }
+
+    if (full != 0) {
+        font->cmap = full;
+        font->cmapFormat = 12;
+    }
+    else if (bmp != 0) {
+        font->cmap = bmp;
+        font->cmapFormat = 4;
+    }
+    else
+        return 0;
+
+    return 1;
+}
+
+
+// Reads a font file into memory.  Returns zero on success.
+//
+int FontFileOpen(FontFile *font, const char *fileName)
+{
+    FILE            *file;
+    long            length;
+    unsigned char   *data;
+    int             result;
+
+    memset(font, 0, sizeof(FontFile));
+
+    file = fopen(fileName, "rb");
+    if (file == NULL) return -1;
+
+    if (fseek(file, 0, SEEK_END) != 0 || (length = ftell(file)) <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return -1;
+    }
+
+    data = (unsigned char *) malloc(length);
+    if (data == NULL || fread(data, 1, length, file) != (size_t) length) {
+        free(data);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    result = FontFileInitWithData(font, data, length);
+    if (result != 0) {
+        free(data);
+        return result;
+    }
+    font->ownsData = 1;
+    return 0;
+}
+
+
+// Sets up a font from data already in memory.  The data is not copied and must
+// stay valid until the font is disposed.  Returns zero on success.
+//
+int FontFileInitWithData(FontFile *font, const void *data, size_t length)
+{
+    size_t          directory = 0, head, maxp, hhea, loca, cmap, tableLength, cmapLength;
+
+    memset(font, 0, sizeof(FontFile));
+    font->data = (unsigned char *) data;
+    font->length = length;
+
+    if (length < 12) return -1;
+
+    // For collections, use the first font
+    if (memcmp(font->data, "ttcf", 4) == 0) {
+        if (length < 16) return -1;
+        directory = ReadU32(font->data + 12);
+    }
+
+    head = FindTable(font, directory, "head", &tableLength);
+    if (head == 0 || tableLength < 54) return -1;
+    font->unitsPerEm = ReadU16(font->data + head + 18);
+    font->indexToLocFormat = ReadS16(font->data + head + 50);
+
+    maxp = FindTable(font, directory, "maxp", &tableLength);
+    if (maxp == 0 || tableLength < 6) return -1;
+    font->numGlyphs = ReadU16(font->data + maxp + 4);
+
+    hhea = FindTable(font, directory, "hhea", &tableLength);
+    if (hhea == 0 || tableLength < 36) return -1;
+    font->ascender = ReadS16(font->data + hhea + 4);
+    font->descender = ReadS16(font->data + hhea + 6);
+    font->lineGap = ReadS16(font->data + hhea + 8);
+    font->numHMetrics = ReadU16(font->data + hhea + 34);
+
+    font->hmtx = FindTable(font, directory, "hmtx", &tableLength);
+    if (font->hmtx == 0 || tableLength < 4 * (size_t) font->numHMetrics || font->numHMetrics == 0) return -1;
+
+    loca = FindTable(font, directory, "loca", &tableLength);
+    if (loca == 0) return -1;
+    if (tableLength < (font->numGlyphs + 1) * (size_t) (font->indexToLocFormat == 0 ? 2 : 4)) return -1;
+    font->loca = loca;
+
+    font->glyf = FindTable(font, directory, "glyf", &font->glyfLength);
+    if (font->glyf == 0) return -1;     // CFF-flavoured fonts are not supported
+
+    cmap = FindTable(font, directory, "cmap", &cmapLength);
+    if (cmap == 0 || ! ChooseCmapSubtable(font, cmap, cmapLength)) return -1;
+
+    font->name = FindTable(font, directory, "name", &font->nameLength);
+
+    if (font->unitsPerEm == 0) return -1;
+    return 0;
+}
+
+
+void FontFileDispose(FontFile *font)
+{
+    if (font->ownsData)
+        free(font->data);
+    memset(font, 0, sizeof(FontFile));
+}
+
+
+// Maps a Unicode code point to a glyph index.  Returns zero (.notdef) for
+// characters the font does not cover.
+//
+unsigned int FontFileGetGlyphIndex(const FontFile *font, unsigned long codepoint)
+{
+    const unsigned char *table = font->data + font->cmap;
+
+    if (font->cmapFormat == 12) {
+        unsigned long   numGroups = ReadU32(table + 12);
+        unsigned long   low = 0, high = numGroups;
+
+        if (font->cmap + 16 + 12 * numGroups > font->length) return 0;
+
+        while (low < high) {
+            unsigned long       mid = (low + high) / 2;
+            const unsigned char *group = table + 16 + 12 * mid;
+            unsigned long       start = ReadU32(group), end = ReadU32(group + 4);
+
+            if (codepoint < start)
+                high = mid;
+            else if (codepoint > end)
+                low = mid + 1;
+            else
+                return (unsigned int) (ReadU32(group + 8) + (codepoint - start));
+        }
+    }
+    else if (font->cmapFormat == 4 && codepoint <= 0xFFFF) {
+        unsigned int    segCountX2 = ReadU16(table + 6);
+        unsigned int    low = 0, high = segCountX2 / 2;
+        const unsigned char *endCodes = table + 14;
+        const unsigned char *startCodes = endCodes + segCountX2 + 2;
+        const unsigned char *idDeltas = startCodes + segCountX2;
+        const unsigned char *idRangeOffsets = idDeltas + segCountX2;
+
+        if (font->cmap + 16 + 4 * (size_t) segCountX2 > font->length) return 0;
+
+        while (low < high) {
+            unsigned int    mid = (low + high) / 2;
+            unsigned int    end = ReadU16(endCodes + 2 * mid);
+
+            if (codepoint > end) {
+                low = mid + 1;
+            }
+            else {
+                unsigned int    start = ReadU16(startCodes + 2 * mid);
+                unsigned int    delta = ReadU16(idDeltas + 2 * mid);
+                unsigned int    rangeOffset = ReadU16(idRangeOffsets + 2 * mid);
+                const unsigned char *glyphAddress;
+                unsigned int    glyph;
+
+                if (codepoint < start) {
+                    high = mid;
+                    continue;
+                }
+                if (rangeOffset == 0)
+                    return (codepoint + delta) & 0xFFFF;
+
+                glyphAddress = idRangeOffsets + 2 * mid + rangeOffset + 2 * (codepoint - start);
+                if ((size_t) (glyphAddress + 2 - font->data) > font->length) return 0;
+                glyph = ReadU16(glyphAddress);
+                return (glyph == 0) ? 0 : ((glyph + delta) & 0xFFFF);
+            }
+        }
+    }
+    return 0;
+}
+
+
+// Gets the advance width of a glyph, in font units
+//
+int FontFileGetAdvance(const FontFile *font, unsigned int glyph)
+{
+    if (glyph >= font->numHMetrics)
+        glyph = font->numHMetrics - 1;
+    return (int) ReadU16(font->data + font->hmtx + 4 * glyph);
+}
+
+
+// Finds the 'glyf' data for a glyph.  Returns zero if the glyph has no outline.
+//
+static size_t GetGlyphOffset(const FontFile *font, unsigned int glyph, size_t *length)
+{
+    size_t      start, end;
+
+    if (glyph >= font->numGlyphs) return 0;
+
+    if (font->indexToLocFormat == 0) {
+        start = 2 * (size_t) ReadU16(font->data + font->loca + 2 * glyph);
+        end = 2 * (size_t) ReadU16(font->data + font->loca + 2 * glyph + 2);
+    }
+    else {
+        start = ReadU32(font->data + font->loca + 4 * glyph);
+        end = ReadU32(font->data + font->loca + 4 * glyph + 4);
+    }
+
+    if (end <= start || end > font->glyfLength || end - start < 10) return 0;
+    *length = end - start;
+    return font->glyf + start;
+}
+
+
+// Maps a point in font units through the transform, then to pixel space (Y down)
+//
+static void TransformPoint(const GlyphTransform *xf, float scale, float fx, float fy, float *x, float *y)
+{
+    *x = scale * (xf->a * fx + xf->c * fy + xf->e);
+    *y = -scale * (xf->b * fx + xf->d * fy + xf->f);
+}
+
+
+// Decodes a simple glyph and adds its contours to the outline
+//
+static int AddSimpleGlyph(const unsigned char *glyph, size_t length, const GlyphTransform *xf, float scale, GlyphOutline *outline)
+{
+    int             numContours = ReadS16(glyph);
+    const unsigned char *p = glyph + 10, *end = glyph + length;
+    unsigned int    numPoints, instructionLength, i, c, start;
+    unsigned char   *flags;
+    float           *xs, *ys;
+    int             value;
+
+    if (numContours == 0) return 0;
+    if (p + 2 * numContours + 2 > end) return -1;
+    numPoints = ReadU16(p + 2 * (numContours - 1)) + 1;
+    instructionLength = ReadU16(p + 2 * numContours);
+    p += 2 * numContours + 2 + instructionLength;
+    if (p > end) return -1;
+
+    flags = (unsigned char *) malloc(numPoints);
+    xs = (float *) malloc(numPoints * sizeof(float));
+    ys = (float *) malloc(numPoints * sizeof(float));
+    if (flags == NULL || xs == NULL || ys == NULL) goto Fail;
+
+    // Flags, with run-length repeats
+    for (i = 0; i < numPoints; ) {
+        unsigned char   flag;
+
+        if (p >= end) goto Fail;
+        flag = *p++;
+        flags[i++] = flag;
+        if (flag & kRepeatFlag) {
+            unsigned int    repeat;
+
+            if (p >= end) goto Fail;
+            repeat = *p++;
+            while (repeat-- > 0 && i < numPoints)
+                flags[i++] = flag;
+        }
+    }
+
+    // X coordinates, delta encoded
+    value = 0;
+    for (i = 0; i < numPoints; i++) {
+        if (flags[i] & kXShortVector) {
+            if (p + 1 > end) goto Fail;
+            value += (flags[i] & kXIsSameOrPositive) ? *p : -(int) *p;
+            p += 1;
+        }
+        else if ( ! (flags[i] & kXIsSameOrPositive) ) {
+            if (p + 2 > end) goto Fail;
+            value += ReadS16(p);
+            p += 2;
+        }
+        xs[i] = (float) value;
+    }
+
+    // Y coordinates, same encoding
+    value = 0;
+    for (i = 0; i < numPoints; i++) {
+        if (flags[i] & kYShortVector) {
+            if (p + 1 > end) goto Fail;
+            value += (flags[i] & kYIsSameOrPositive) ? *p : -(int) *p;
+            p += 1;
+        }
+        else if ( ! (flags[i] & kYIsSameOrPositive) ) {
+            if (p + 2 > end) goto Fail;
+            value += ReadS16(p);
+            p += 2;
+        }
+        ys[i] = (float) value;
+    }
+
+    // Emit the contours.  Consecutive off-curve points have an implied on-curve
+    // point half way between them.
+    start = 0;
+    for (c = 0; c < (unsigned int) numContours; c++) {
+        unsigned int    last = ReadU16(glyph + 10 + 2 * c), count, k, first;
+        float           sx, sy, cx = 0, cy = 0, x, y;
+        int             haveControl = 0;
+
+        if (last >= numPoints || last < start) break;
+        count = last - start + 1;
+
+        // Find an on-curve starting point
+        if (flags[start] & kOnCurvePoint) {
+            TransformPoint(xf, scale, xs[start], ys[start], &sx, &sy);
+            first = 1;
+        }
+        else if (flags[last] & kOnCurvePoint) {
+            TransformPoint(xf, scale, xs[last], ys[last], &sx, &sy);
+            first = 0;
+            count--;
+        }
+        else {
+            TransformPoint(xf, scale, (xs[start] + xs[last]) / 2, (ys[start] + ys[last]) / 2, &sx, &sy);
+            first = 0;
+        }
+        GlyphOutlineMoveTo(outline, sx, sy);
+
+        for (k = first; k < count; k++) {
+            unsigned int    index = start + k;
+
+            TransformPoint(xf, scale, xs[index], ys[index], &x, &y);
+            if (flags[index] & kOnCurvePoint) {
+                if (haveControl)
+                    GlyphOutlineQuadTo(outline, cx, cy, x, y);
+                else
+                    GlyphOutlineLineTo(outline, x, y);
+                haveControl = 0;
+            }
+            else {
+                if (haveControl)
+                    GlyphOutlineQuadTo(outline, cx, cy, (cx + x) / 2, (cy + y) / 2);
+                cx = x;
+                cy = y;
+                haveControl = 1;
+            }
+        }
+
+        if (haveControl)
+            GlyphOutlineQuadTo(outline, cx, cy, sx, sy);
+        GlyphOutlineClose(outline);
+        start = last + 1;
+    }
+
+    free(flags);
+    free(xs);
+    free(ys);
+    return 0;
+
+Fail:
+    free(flags);
+    free(xs);
+    free(ys);
+    return -1;
+}
+
+
+static int AddGlyph(const FontFile *font, unsigned int glyph, const GlyphTransform *xf, float scale, GlyphOutline *outline, int depth);
+
+
+// Adds each component of a composite glyph to the outline
+//
+static int AddCompositeGlyph(const FontFile *font, const unsigned char *glyph, size_t length, const GlyphTransform *xf, float scale, GlyphOutline *outline, int depth)
+{
+    const unsigned char *p = glyph + 10, *end = glyph + length;
+    unsigned int        flags;
+
+    do {
+        GlyphTransform  local = { 1, 0, 0, 1, 0, 0 }, combined;
+        unsigned int    component;
+
+        if (p + 4 > end) return -1;
+        flags = ReadU16(p);
+        component = ReadU16(p + 2);
+        p += 4;
+
+        if (flags & kArg1And2AreWords) {
+            if (p + 4 > end) return -1;
+            if (flags & kArgsAreXYValues) {
+                local.e = (float) ReadS16(p);
+                local.f = (float) ReadS16(p + 2);
+            }
+            p += 4;
+        }
+        else {
+            if (p + 2 > end) return -1;
+            if (flags & kArgsAreXYValues) {
+                local.e = (float) (signed char) p[0];
+                local.f = (float) (signed char) p[1];
+            }
+            p += 2;
+        }
+
+        // Scales are 2.14 fixed point
+        if (flags & kWeHaveAScale) {
+            if (p + 2 > end) return -1;
+            local.a = local.d = ReadS16(p) / 16384.0f;
+            p += 2;
+        }
+        else if (flags & kWeHaveAnXAndYScale) {
+            if (p + 4 > end) return -1;
+            local.a = ReadS16(p) / 16384.0f;
+            local.d = ReadS16(p + 2) / 16384.0f;
+            p += 4;
+        }
+        else if (flags & kWeHaveATwoByTwo) {
+            if (p + 8 > end) return -1;
+            local.a = ReadS16(p) / 16384.0f;
+            local.b = ReadS16(p + 2) / 16384.0f;
+            local.c = ReadS16(p + 4) / 16384.0f;
+            local.d = ReadS16(p + 6) / 16384.0f;
+            p += 8;
+        }
+
+        // Apply the component transform first, then the parent's
+        combined.a = xf->a * local.a + xf->c * local.b;
+        combined.b = xf->b * local.a + xf->d * local.b;
+        combined.c = xf->a * local.c + xf->c * local.d;
+        combined.d = xf->b * local.c + xf->d * local.d;
+        combined.e = xf->a * local.e + xf->c * local.f + xf->e;
+        combined.f = xf->b * local.e + xf->d * local.f + xf->f;
+
+        if (AddGlyph(font, component, &combined, scale, outline, depth + 1) != 0)
+            return -1;
+    } while (flags & kMoreComponents);
+
+    return 0;
+}
+
+
+static int AddGlyph(const FontFile *font, unsigned int glyph, const GlyphTransform *xf, float scale, GlyphOutline *outline, int depth)
+{
+    size_t              offset, length = 0;
+    const unsigned char *data;
+
+    if (depth > kMaxCompositeDepth) return -1;
+
+    offset = GetGlyphOffset(font, glyph, &length);
+    if (offset == 0) return 0;      // Glyphs such as the space have no outline
+    data = font->data + offset;
+
+    if (ReadS16(data) >= 0)
+        return AddSimpleGlyph(data, length, xf, scale, outline);
+    else
+        return AddCompositeGlyph(font, data, length, xf, scale, outline, depth);
+}
+
+
+// Appends the outline of a glyph, scaled by 'scale' pixels per font
+// unit, with the glyph origin at (0, 0) and Y pointing down.  Returns zero on success.
+//
+int FontFileGetGlyphOutline(const FontFile *font, unsigned int glyph, float scale, GlyphOutline *outline)
+{
+    GlyphTransform  identity = { 1, 0, 0, 1, 0, 0 };
+
+    return AddGlyph(font, glyph, &identity, scale, outline, 0);
+}
+
+
+// Gets the PostScript name of the font (name ID 6), which is what the app knows a
+// font by when it looks up its stroke factor.  The Macintosh Roman record is used
+// if there is one, otherwise the Windows Unicode one; PostScript names are ASCII
+// either way.  Returns zero on success.
+//
+int FontFileGetPostScriptName(const FontFile *font, char *name, size_t size)
+{
+    const unsigned char *table = font->data + font->name;
+    const unsigned char *record = NULL;
+    unsigned int        count, i;
+    size_t              offset, length, step, out = 0;
+
+    if (font->name == 0 || font->nameLength < 6 || size == 0) return -1;
+    count = ReadU16(table + 2);
+    if (6 + 12 * (size_t) count > font->nameLength) return -1;
+
+    for (i = 0; i < count; i++) {
+        const unsigned char *candidate = table + 6 + 12 * i;
+        unsigned int        platform = ReadU16(candidate), encoding = ReadU16(candidate + 2);
+
+        if (ReadU16(candidate + 6) != 6) continue;
+        if (platform == 1 && encoding == 0) {
+            record = candidate;
+            break;
+        }
+        if (platform == 3 && encoding == 1 && record == NULL)
+            record = candidate;
+    }
+    if (record == NULL) return -1;
+
+    // Windows names are UTF-16; only the low byte of each unit is kept
+    length = ReadU16(record + 8);
+    offset = ReadU16(table + 4) + (size_t) ReadU16(record + 10);
+    step = (ReadU16(record) == 3) ? 2 : 1;
+    if (offset + length > font->nameLength) return -1;
+    for (i = (unsigned int) step - 1; i < length && out + 1 < size; i += (unsigned int) step)
+        name[out++] = (char) table[offset + i];
+    name[out] = 0;
+    return (out > 0) ? 0 : -1;
+}
@@ -0,0 +1,93 @@
+/*
+
+File: fontfile.h
+
+Abstract: Header for the portable TrueType font reader in SyntheticBoldDemo
+project.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_FONTFILE_H
+#define MY_FONTFILE_H
+
+// Minimal TrueType ('glyf' outline) font reader.  This is what the headless
+// renderer uses in place of ATSUI to map characters to glyphs, look up advances
+// and extract outlines.  Like the raster module it has no Carbon dependencies.
+
+#include <stddef.h>
+
+#include "outline.h"
+
+typedef struct {
+    unsigned char       *data;              // The whole font file
+    size_t              length;
+    int                 ownsData;           // Non-zero if data must be freed on dispose
+    unsigned int        numGlyphs;
+    unsigned int        unitsPerEm;
+    int                 indexToLocFormat;   // 0 = short offsets, 1 = long offsets
+    int                 ascender;           // From 'hhea', in font units
+    int                 descender;
+    int                 lineGap;
+    size_t              loca;               // Table offsets into data
+    size_t              glyf;
+    size_t              glyfLength;
+    size_t              hmtx;
+    unsigned int        numHMetrics;
+    size_t              cmap;               // Offset of the chosen cmap subtable
+    unsigned int        cmapFormat;         // 4 or 12
+    size_t              name;               // Zero if the font has no 'name' table
+    size_t              nameLength;
+} FontFile;
+
+int FontFileOpen(FontFile *font, const char *fileName);
+int FontFileInitWithData(FontFile *font, const void *data, size_t length);
+void FontFileDispose(FontFile *font);
+
+unsigned int FontFileGetGlyphIndex(const FontFile *font, unsigned long codepoint);
+int FontFileGetAdvance(const FontFile *font, unsigned int glyph);
+int FontFileGetGlyphOutline(const FontFile *font, unsigned int glyph, float scale, GlyphOutline *outline);
+int FontFileGetPostScriptName(const FontFile *font, char *name, size_t size);
+
+#endif  /* MY_FONTFILE_H */
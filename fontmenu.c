@@ -47,125 +47,368 @@ POSSIBILITY OF SUCH DAMAGE.
 Copyright  2004-2007 Apple Inc., All Rights Reserved
 */ 
 
+#include <pthread.h>
+#include <sys/stat.h>
+
 #include "globals.h"
 #include "fontmenu.h"
+#include "fontcatalog.h"
+#include "trace.h"
 
 
 // Globals
 //
 static MenuID                   gFontMenuID;
+static MenuRef                  gFontMenuRef;
 static MenuRef                  gFontMenuCurrentMenuRef;
 static MenuItemIndex            gFontMenuCurrentMenuItem;
-static MenuItemIndex            *gFontMenuHierarchicalItems;
 static ItemCount                gNumHierarchicalItems;
 
+// What is known about each item of the font menu and its submenus, gathered once by
+// BuildFontMenuParentItemArray() so the menu does not have to be asked again
+//
+typedef struct {
+    FMFontFamily            family;
+    FMFontStyle             style;
+    ATSFontRef              font;               // Filled in by BuildFontMenuIndex
+    Boolean                 isFont;             // False for items with a submenu
+} MyFontMenuItem;
+
+// The font menu and its submenus, indexed by MenuID - gFontMenuID.  The submenus'
+// IDs count up from gFontMenuID + 1, so finding a submenu's parent is a lookup.
+//
+typedef struct {
+    MenuRef                 menu;               // NULL if no submenu has this ID
+    MenuItemIndex           parentItem;         // The font menu item the submenu hangs from, or zero
+    ItemCount               numItems;
+    MyFontMenuItem          *items;             // Item i is items[i - 1]
+} MyFontMenuInfo;
+
+static MyFontMenuInfo           *gFontMenus = NULL;
+static ItemCount                gNumFontMenus = 0;
+
+// Where each font is in the font menu.  This is an open hash table keyed by the
+// font's ATSFontRef, built once by BuildFontMenuIndex() so a font can be found
+// without walking the menu and making a CTFont for every item.
+//
+typedef struct {
+    ATSFontRef              font;
+    MenuRef                 menu;               // NULL marks an empty slot
+    MenuItemIndex           item;
+    MenuItemIndex           parentItem;         // The font menu item the submenu hangs from, or zero
+} MyFontMenuEntry;
+
+static MyFontMenuEntry          *gFontMenuIndex = NULL;
+static UInt32                   gFontMenuIndexCapacity = 0;
+static UInt32                   gFontMenuIndexCount = 0;
+
+// Working out the font of every menu item is slow with many fonts installed, so it
+// is done on a background thread.  The thread fills in a copy of the items' family
+// and style and posts kEventFontMenuReady; the main thread then builds the index.
+// Until it has, FindAndSelectFont() only remembers the font it was asked for.
+//
+enum {
+    kEventClassFontMenu     = 'FMnu',
+    kEventFontMenuReady     = 1
+};
+
+typedef struct {
+    ItemCount               menuIndex;          // Into gFontMenus
+    MenuItemIndex           item;
+    FMFontFamily            family;
+    FMFontStyle             style;
+    ATSFontRef              font;               // Filled in by the thread
+} MyFontMenuJob;
+
+static MyFontMenuJob            *gFontMenuJobs = NULL;
+static ItemCount                gNumFontMenuJobs = 0;
+static Boolean                  gFontMenuReady = false;
+static FMFont                   gPendingFont = kInvalidFont;
+
+// The font catalog written by the last launch.  While it is current, fonts are found
+// by name and menu items are matched to fonts without asking ATS about each one.
+//
+static FontCatalog              gFontCatalog;
+static Boolean                  gFontCatalogOpened = false;
+static Boolean                  gFontCatalogCurrent = false;
+static char                     gFontCatalogPath[PATH_MAX];
+
+// The directories fonts are normally installed in.  A font added to any of them
+// makes the catalog out of date.
+//
+static const char               *gFontDirectories[] =
+    { "/System/Library/Fonts", "/Library/Fonts", "/Network/Library/Fonts" };
+
+
+// Maps the catalog from the user's caches folder and checks that it still describes
+// the installed fonts
+//
+static void OpenFontCatalog(void)
+{
+    FSRef                   cachesFolder;
+    CFStringRef             bundleID;
+    char                    name[256] = "SyntheticBoldDemo";
+
+    if (gFontCatalogOpened) return;
+    gFontCatalogOpened = true;
+
+    if ( FSFindFolder(kUserDomain, kCachesFolderType, kCreateFolder, &cachesFolder) != noErr
+        || FSRefMakePath(&cachesFolder, (UInt8 *) gFontCatalogPath, sizeof(gFontCatalogPath)) != noErr ) {
+        gFontCatalogPath[0] = 0;
+        return;
+    }
+    bundleID = CFBundleGetIdentifier(CFBundleGetMainBundle());
+    if (bundleID != NULL)
+        CFStringGetCString(bundleID, name, sizeof(name), kCFStringEncodingUTF8);
+    strlcat(gFontCatalogPath, "/", sizeof(gFontCatalogPath));
+    strlcat(gFontCatalogPath, name, sizeof(gFontCatalogPath));
+    strlcat(gFontCatalogPath, ".fontcatalog", sizeof(gFontCatalogPath));
+
+    if ( FontCatalogOpen(&gFontCatalog, gFontCatalogPath) == 0 )
+        gFontCatalogCurrent = FontCatalogIsCurrent(&gFontCatalog, ATSGetGeneration());
+}
+
+
+// Adds a font to the catalog being built, along with the directory it is in
+//
+static void AddFontToCatalog(FontCatalogBuilder *builder, ATSFontRef font)
+{
+    FontCatalogEntry        entry;
+    FMFontFamily            family;
+    FMFontStyle             style;
+    CFStringRef             fullName = NULL;
+    FSRef                   fileRef;
+    char                    name[256], path[PATH_MAX], *slash;
+    struct stat             info;
+
+    if ( ATSFontGetName(font, kATSOptionFlagsDefault, &fullName) != noErr || fullName == NULL )
+        return;
+    if ( ! CFStringGetCString(fullName, name, sizeof(name), kCFStringEncodingUTF8) )
+        name[0] = 0;
+    CFRelease(fullName);
+    if ( ATSFontGetFileReference(font, &fileRef) != noErr || FSRefMakePath(&fileRef, (UInt8 *) path, sizeof(path)) != noErr )
+        path[0] = 0;
+
+    entry.fontRef = font;
+    entry.family = entry.style = -1;
+    if ( FMGetFontFamilyInstanceFromFont(FMGetFontFromATSFontRef(font), &family, &style) == noErr ) {
+        entry.family = family;
+        entry.style = style;
+    }
+    entry.name = name;
+    entry.path = path;
+    entry.modified = (path[0] != 0 && stat(path, &info) == 0) ? (long long) info.st_mtime : -1;
+    verify_noerr( FontCatalogBuilderAddFont(builder, &entry) );
+
+    slash = strrchr(path, '/');
+    if (slash != NULL && slash != path) {
+        *slash = 0;
+        verify_noerr( FontCatalogBuilderAddDirectory(builder, path) );
+    }
+}
+
+
+// Writes a new catalog if the installed fonts have changed since the last one was
+// written, for the next launch.  This is the only place that goes through every font.
+// It runs on the background thread, so the catalog already mapped is left alone.
+//
+static void UpdateFontCatalog(void)
+{
+    FontCatalogBuilder      builder;
+    ATSFontIterator         iterator;
+    ATSFontRef              font;
+    ATSGeneration           generation = ATSGetGeneration();
+    char                    userFonts[PATH_MAX];
+    const char              *home = getenv("HOME");
+    int                     i;
+
+    OpenFontCatalog();
+    if (gFontCatalogCurrent || gFontCatalogPath[0] == 0) return;
+
+    FontCatalogBuilderInit(&builder);
+    for (i = 0; i < (int) (sizeof(gFontDirectories) / sizeof(gFontDirectories[0])); i++)
+        verify_noerr( FontCatalogBuilderAddDirectory(&builder, gFontDirectories[i]) );
+    if (home != NULL) {
+        snprintf(userFonts, sizeof(userFonts), "%s/Library/Fonts", home);
+        verify_noerr( FontCatalogBuilderAddDirectory(&builder, userFonts) );
+    }
+
+    if ( ATSFontIteratorCreate(kATSFontContextLocal, NULL, NULL, kATSOptionFlagsDefault, &iterator) == noErr ) {
+        while ( ATSFontIteratorNext(iterator, &font) == noErr )
+            AddFontToCatalog(&builder, font);
+        verify_noerr( ATSFontIteratorRelease(&iterator) );
+
+        verify_noerr( FontCatalogBuilderWrite(&builder, gFontCatalogPath, generation) );
+    }
+    FontCatalogBuilderDispose(&builder);
+}
+
+
+// True if a catalog entry's font reference still names the font it was written for.
+// Font references and family numbers only last for one session, so the catalog's
+// are checked against ATS before they are used.
+//
+static Boolean IsCatalogEntryCurrent(const FontCatalogEntry *entry)
+{
+    CFStringRef             wanted, fullName = NULL;
+    Boolean                 matches = false;
+
+    wanted = CFStringCreateWithCString(NULL, entry->name, kCFStringEncodingUTF8);
+    if ( wanted != NULL && ATSFontGetName(entry->fontRef, kATSOptionFlagsDefault, &fullName) == noErr && fullName != NULL ) {
+        matches = (CFStringCompare(fullName, wanted, 0) == kCFCompareEqualTo);
+        CFRelease(fullName);
+    }
+    if (wanted != NULL)
+        CFRelease(wanted);
+    return matches;
+}
+
+
+// Finds a font by its full name, through the catalog if it is current.  The font
+// found there is checked against ATS, so a stale reference is never returned.
+// Returns kInvalidFont if there is no such font.
+//
+ATSUFontID FindFontByFullName(const char *name)
+{
+    ATSUFontID              font = kInvalidFont;
+    int                     index;
+
+    OpenFontCatalog();
+    if ( gFontCatalogCurrent && (index = FontCatalogFindByName(&gFontCatalog, name)) >= 0 ) {
+        FontCatalogEntry    entry;
+
+        FontCatalogGetEntry(&gFontCatalog, index, &entry);
+        if ( IsCatalogEntryCurrent(&entry) )
+            return entry.fontRef;
+    }
+
+    verify_noerr( ATSUFindFontFromName(name, strlen(name), kFontFullName, kFontNoPlatform, kFontNoScript, kFontNoLanguage, &font) );
+    return font;
+}
+
 
 // Builds and attaches the font menu in the specified menu
 //
 OSStatus InstallFontMenu(MenuID menuID)
 {
     OSStatus status;
+    TraceScope menuScope, phaseScope;
+
+    TraceBegin(&menuScope, "InstallFontMenu");
 
     // Initialize globals
+    TraceBegin(&phaseScope, "InstallFontMenu: open catalog");
+    OpenFontCatalog();
+    TraceEnd(&phaseScope);
     gFontMenuID = menuID;
-    gFontMenuCurrentMenuRef = GetMenuRef(gFontMenuID);
+    gFontMenuRef = GetMenuRef(gFontMenuID);
+    gFontMenuCurrentMenuRef = gFontMenuRef;
     gFontMenuCurrentMenuItem = (MenuItemIndex)-1; 
 
     // Create the standard font menu
-    status = CreateStandardFontMenu(GetMenuRef(gFontMenuID), 0, (gFontMenuID+1), kHierarchicalFontMenuOption, &gNumHierarchicalItems);
-    if ( status != noErr) return status;
-   
-    // Remember where all the submenus are
-    BuildFontMenuParentItemArray();
-    
+    TraceBegin(&phaseScope, "InstallFontMenu: create standard font menu");
+    status = CreateStandardFontMenu(gFontMenuRef, 0, (gFontMenuID+1), kHierarchicalFontMenuOption, &gNumHierarchicalItems);
+    TraceEnd(&phaseScope);
+    if ( status == noErr ) {
+        // Remember where all the submenus and fonts are
+        TraceBegin(&phaseScope, "InstallFontMenu: index menus");
+        BuildFontMenuParentItemArray();
+        BuildFontMenuIndex();
+        TraceEnd(&phaseScope);
+    }
+
+    TraceEnd(&menuScope);
     return status;
 }
 
 
-// Creates a global array containing information about the submenus in the hierarchical font menu.
-// This information is then used by GetFontMenuParentItem.
+// Returns what is known about a menu of the font menu, or NULL if it is not one
 //
-void BuildFontMenuParentItemArray(void)
+static MyFontMenuInfo *GetFontMenuInfo(MenuRef inMenu)
 {
-    ItemCount               numItems;
-    int                     i, currentIndex;
-    MenuRef                 theSubMenu;
-
-    // Build an array of item indexes which have hierarchical menus -- used in GetFontMenuParentItem (see below)
-    gFontMenuHierarchicalItems = (MenuItemIndex *) malloc(sizeof(MenuItemIndex) * gNumHierarchicalItems);
-
-    currentIndex = 0;
-    numItems = CountMenuItems(GetMenuRef(gFontMenuID));
+    MenuID                  index = GetMenuID(inMenu) - gFontMenuID;
 
-    for (i=1; i <= numItems; i++) {
+    if ( index < 0 || (ItemCount) index >= gNumFontMenus || gFontMenus[index].menu != inMenu )
+        return NULL;
+    return &gFontMenus[index];
+}
 
-        verify_noerr( GetMenuItemHierarchicalMenu(GetMenuRef(gFontMenuID), i, &theSubMenu) );
 
-        if ( theSubMenu != NULL ) {
-            gFontMenuHierarchicalItems[currentIndex++] = i;
-        }
-    }
+// Returns what is known about an item of the font menu, or NULL if it is not one
+//
+static MyFontMenuItem *GetFontMenuItem(MenuRef inMenu, MenuItemIndex inItem)
+{
+    MyFontMenuInfo          *info = GetFontMenuInfo(inMenu);
 
-    check( currentIndex == gNumHierarchicalItems );     // Make sure we found the right number
+    if ( info == NULL || inItem < 1 || inItem > info->numItems || ! info->items[inItem - 1].isFont )
+        return NULL;
+    return &info->items[inItem - 1];
 }
 
 
-// Gets the parent item of a font in a submenu.  Returns zero if not found.
+// Records a menu of the font menu and the font family and style of each of its items
 //
-MenuItemIndex GetFontMenuParentItem(MenuRef inMenu)
+static void AddFontMenuInfo(MenuRef inMenu, MenuItemIndex inParentItem)
 {
+    MenuID                  index = GetMenuID(inMenu) - gFontMenuID;
+    MyFontMenuInfo          *info;
     MenuRef                 theSubMenu;
-    int                     i;
-    
-    for(i=0; i < gNumHierarchicalItems; i++) {
-        verify_noerr( GetMenuItemHierarchicalMenu(GetMenuRef(gFontMenuID), gFontMenuHierarchicalItems[i], &theSubMenu) );
-        if ( theSubMenu == inMenu ) {
-            return gFontMenuHierarchicalItems[i];
-        }
+    MenuItemIndex           i;
+
+    if (index < 0) return;
+    if ((ItemCount) index >= gNumFontMenus) {
+        MyFontMenuInfo      *newMenus = (MyFontMenuInfo *) realloc(gFontMenus, (index + 1) * sizeof(MyFontMenuInfo));
+
+        if (newMenus == NULL) return;
+        memset(&newMenus[gNumFontMenus], 0, (index + 1 - gNumFontMenus) * sizeof(MyFontMenuInfo));
+        gFontMenus = newMenus;
+        gNumFontMenus = index + 1;
+    }
+
+    info = &gFontMenus[index];
+    info->numItems = CountMenuItems(inMenu);
+    info->items = (MyFontMenuItem *) calloc(info->numItems + 1, sizeof(MyFontMenuItem));
+    if (info->items == NULL) return;
+    info->menu = inMenu;
+    info->parentItem = inParentItem;
+
+    for (i=1; i <= info->numItems; i++) {
+        MyFontMenuItem      *item = &info->items[i - 1];
+
+        verify_noerr( GetMenuItemHierarchicalMenu(inMenu, i, &theSubMenu) );
+        item->font = kInvalidFont;
+        if ( theSubMenu == NULL )
+            item->isFont = (GetFontFamilyFromMenuSelection(inMenu, i, &item->family, &item->style) == noErr);
     }
-    return 0;
 }
 
 
-// Handles changes to the font menu
+// Returns the font for a font family and style, or kInvalidFont.  Safe to call from
+// any thread.
 //
-FMFont SelectAndGetFont(MenuRef theMenu, MenuItemIndex theItem)
+static ATSFontRef GetFontFromFamily(FMFontFamily theFMFontFamily, FMFontStyle theFMFontStyle)
 {
-    MenuRef                 parentMenuRef;
-    MenuItemIndex           parentMenuItem;
-    FMFontFamily            theFMFontFamily;
-    FMFontStyle             theFMFontStyle;
 	ATSFontRef				theFont = kInvalidFont;
 	CTFontRef				ctFont;
 
-    // Uncheck the previous item (if any)
-    if (gFontMenuCurrentMenuItem != (MenuItemIndex)-1) {
-        CheckMenuItem(gFontMenuCurrentMenuRef, gFontMenuCurrentMenuItem, false);
-        if ( GetMenuID(gFontMenuCurrentMenuRef) > gFontMenuID ) {		// Sub-menus will have MenuIDs starting at gFontMenuID + 1
-            parentMenuRef = GetMenuRef(gFontMenuID);
-            parentMenuItem = GetFontMenuParentItem(gFontMenuCurrentMenuRef);
-            if ( parentMenuItem > 0 ) {
-                SetItemMark(parentMenuRef, parentMenuItem, kMenuNoMark);
-            }
-        }
-    }
-
-    // Check the new item
-    CheckMenuItem(theMenu, theItem, true);
-    if ( GetMenuID(theMenu) > gFontMenuID ) {							// Sub-menus will have MenuIDs starting at gFontMenuID + 1
-        parentMenuRef = GetMenuRef(gFontMenuID);
-        parentMenuItem = GetFontMenuParentItem(theMenu);
-        if ( parentMenuItem > 0 ) {
-            SetItemMark(parentMenuRef, parentMenuItem, kMenuDashMark);
+    // The catalog knows the font of every family and style, if it is current.  Its
+    // font is only used if ATS still gives it the same name, family and style.
+    if (gFontCatalogCurrent) {
+        int                 index = FontCatalogFindByFamily(&gFontCatalog, theFMFontFamily, theFMFontStyle);
+
+        if (index >= 0) {
+            FontCatalogEntry    entry;
+            FMFontFamily        family;
+            FMFontStyle         style;
+
+            FontCatalogGetEntry(&gFontCatalog, index, &entry);
+            if ( IsCatalogEntryCurrent(&entry)
+                && FMGetFontFamilyInstanceFromFont(FMGetFontFromATSFontRef(entry.fontRef), &family, &style) == noErr
+                && family == theFMFontFamily && style == theFMFontStyle )
+                return entry.fontRef;
         }
     }
-    
-    // Store the current item in the globals for future reference
-    gFontMenuCurrentMenuRef = theMenu;
-    gFontMenuCurrentMenuItem = theItem;
 
-    // Return the proper font
-    verify_noerr( GetFontFamilyFromMenuSelection(gFontMenuCurrentMenuRef, gFontMenuCurrentMenuItem, &theFMFontFamily, &theFMFontStyle) );
 	ctFont = CTFontCreateWithQuickdrawInstance("\p", theFMFontFamily, theFMFontStyle, 0.0);
 	if (ctFont != NULL) {
 		theFont = CTFontGetPlatformFont(ctFont, NULL);
@@ -175,88 +418,290 @@ FMFont SelectAndGetFont(MenuRef theMenu, MenuItemIndex theItem)
 }
 
 
-// Walks the font menu, finds and selects the specified font
-// Returns false if the font could not be found
+// Returns the font of a font menu item, or kInvalidFont
 //
-Boolean FindAndSelectFont(FMFont iFont)
+static ATSFontRef GetFontMenuItemFont(MenuRef inMenu, MenuItemIndex inItem)
 {
+    MyFontMenuItem          *item = GetFontMenuItem(inMenu, inItem);
     FMFontFamily            theFMFontFamily;
     FMFontStyle             theFMFontStyle;
-	ATSFontRef				currentFont = kInvalidFont;
-	CTFontRef				ctFont;
-    ItemCount               numItems, numSubItems;
-    MenuRef                 theSubMenu = NULL;
-    MenuItemIndex			parentMenuItem, i, j;
-    Boolean					found = false;
 
+    if (item == NULL) {
+        verify_noerr( GetFontFamilyFromMenuSelection(inMenu, inItem, &theFMFontFamily, &theFMFontStyle) );
+        return GetFontFromFamily(theFMFontFamily, theFMFontStyle);
+    }
 
-    // Loop over all the parent menu items (outer loop)
-    numItems = CountMenuItems(GetMenuRef(gFontMenuID));
-    for (i=1; i <= numItems; i++) {
+    if (item->font == kInvalidFont)
+        item->font = GetFontFromFamily(item->family, item->style);
+    return item->font;
+}
 
-        // Check to see if this item is hierarchical
-        verify_noerr( GetMenuItemHierarchicalMenu(GetMenuRef(gFontMenuID), i, &theSubMenu) );
-        if ( theSubMenu != NULL ) {
 
-            // Loop over all the submenu items (inner loop)
-            numSubItems = CountMenuItems(theSubMenu);
-            for (j=1; j <= numSubItems; j++) {
-                verify_noerr( GetFontFamilyFromMenuSelection(theSubMenu, j, &theFMFontFamily, &theFMFontStyle) );
-				ctFont = CTFontCreateWithQuickdrawInstance("\p", theFMFontFamily, theFMFontStyle, 0.0);
-				if (ctFont != NULL) {
-					currentFont = CTFontGetPlatformFont(ctFont, NULL);
-					CFRelease(ctFont);
-				}
-                
-                if (currentFont == iFont) {
-                    found = true;
-                    break;
-                }
-            } // End of inner loop
-        }
-        else {
-            verify_noerr( GetFontFamilyFromMenuSelection(GetMenuRef(gFontMenuID), i, &theFMFontFamily, &theFMFontStyle) );
-			ctFont = CTFontCreateWithQuickdrawInstance("\p", theFMFontFamily, theFMFontStyle, 0.0);
-			if (ctFont != NULL) {
-				currentFont = CTFontGetPlatformFont(ctFont, NULL);
-				CFRelease(ctFont);
-			}
-            
-            if (currentFont == iFont) {
-                found = true;
-            }
+// Finds the slot for a font in the font menu index
+//
+static MyFontMenuEntry *FindFontMenuSlot(MyFontMenuEntry *table, UInt32 capacity, ATSFontRef font)
+{
+    UInt32                  i = ((font ^ (font >> 16)) * 40503U) & (capacity - 1);
+
+    while (table[i].menu != NULL && table[i].font != font)
+        i = (i + 1) & (capacity - 1);
+    return &table[i];
+}
+
+
+// Adds a menu item to the font menu index, growing it when it gets half full.  If
+// a font appears twice the first item found is kept.
+//
+static void AddFontMenuEntry(ATSFontRef font, MenuRef menu, MenuItemIndex item, MenuItemIndex parentItem)
+{
+    MyFontMenuEntry         *slot;
+
+    if (font == kInvalidFont) return;
+
+    if ((gFontMenuIndexCount + 1) * 2 > gFontMenuIndexCapacity) {
+        UInt32              newCapacity = (gFontMenuIndexCapacity == 0) ? 512 : gFontMenuIndexCapacity * 2;
+        MyFontMenuEntry     *newTable = (MyFontMenuEntry *) calloc(newCapacity, sizeof(MyFontMenuEntry));
+        UInt32              i;
+
+        if (newTable == NULL) return;
+        for (i = 0; i < gFontMenuIndexCapacity; i++) {
+            if (gFontMenuIndex[i].menu != NULL)
+                *FindFontMenuSlot(newTable, newCapacity, gFontMenuIndex[i].font) = gFontMenuIndex[i];
         }
+        free(gFontMenuIndex);
+        gFontMenuIndex = newTable;
+        gFontMenuIndexCapacity = newCapacity;
+    }
+
+    slot = FindFontMenuSlot(gFontMenuIndex, gFontMenuIndexCapacity, font);
+    if (slot->menu != NULL) return;
+    slot->font = font;
+    slot->menu = menu;
+    slot->item = item;
+    slot->parentItem = parentItem;
+    gFontMenuIndexCount++;
+}
+
+
+// Works out the font of every job, then tells the main thread.  The catalog is
+// brought up to date here too, since that also goes through every font.
+//
+static void *ResolveFontMenuFonts(void *arg)
+{
+    ItemCount               i;
+    EventRef                event;
+    TraceScope              scope;
+
+    TraceSetThreadName("Font menu");
+    TraceBegin(&scope, "ResolveFontMenuFonts: resolve fonts");
+    for (i = 0; i < gNumFontMenuJobs; i++)
+        gFontMenuJobs[i].font = GetFontFromFamily(gFontMenuJobs[i].family, gFontMenuJobs[i].style);
+    TraceEnd(&scope);
+
+    TraceBegin(&scope, "ResolveFontMenuFonts: update catalog");
+    UpdateFontCatalog();
+    TraceEnd(&scope);
+
+    if ( CreateEvent(NULL, kEventClassFontMenu, kEventFontMenuReady, 0, kEventAttributeNone, &event) == noErr ) {
+        verify_noerr( PostEventToQueue(GetMainEventQueue(), event, kEventPriorityStandard) );
+        ReleaseEvent(event);
+    }
+    return NULL;
+}
+
+
+// Records where every font in the font menu is, from the fonts the background
+// thread worked out, and selects the font asked for while it was running
+//
+static void FinishFontMenuIndex(void)
+{
+    ItemCount               i;
+
+    for (i = 0; i < gNumFontMenuJobs; i++) {
+        MyFontMenuJob       *job = &gFontMenuJobs[i];
+        MyFontMenuInfo      *info = &gFontMenus[job->menuIndex];
+        MyFontMenuItem      *item = &info->items[job->item - 1];
+
+        if (item->font == kInvalidFont)
+            item->font = job->font;
+        AddFontMenuEntry(item->font, info->menu, job->item, info->parentItem);
+    }
+    free(gFontMenuJobs);
+    gFontMenuJobs = NULL;
+    gNumFontMenuJobs = 0;
+
+    gFontMenuReady = true;
+    if (gPendingFont != kInvalidFont)
+        verify( FindAndSelectFont(gPendingFont) );
+    gPendingFont = kInvalidFont;
+}
 
-        if (found) break;
-    } // End of outer loop
-    
-    
-    // If the font was found, check its menu item (uncheck the previous one, if there is one)
-    //
-    if (found) {
-        // Uncheck the previous item (if any)
-        if (gFontMenuCurrentMenuItem != (MenuItemIndex)-1) {
-            CheckMenuItem(gFontMenuCurrentMenuRef, gFontMenuCurrentMenuItem, false);
-            if ( GetMenuID(gFontMenuCurrentMenuRef) > gFontMenuID ) {		// Sub-menus will have MenuIDs starting at gFontMenuID + 1
-                parentMenuItem = GetFontMenuParentItem(gFontMenuCurrentMenuRef);
-                if ( parentMenuItem > 0 ) {
-                    SetItemMark(GetMenuRef(gFontMenuID), parentMenuItem, kMenuNoMark);
-                }
+
+// Handles kEventFontMenuReady, posted by the background thread when it is done
+//
+static pascal OSStatus DoFontMenuReady(EventHandlerCallRef nextHandler, EventRef theEvent, void *userData)
+{
+    FinishFontMenuIndex();
+    return noErr;
+}
+
+
+// Starts building the index of where every font in the font menu is, for
+// FindAndSelectFont.  The menus and their items come from BuildFontMenuParentItemArray.
+//
+void BuildFontMenuIndex(void)
+{
+    EventTypeSpec           readyEvent = { kEventClassFontMenu, kEventFontMenuReady };
+    ItemCount               m, numJobs = 0;
+    MenuItemIndex           i;
+    pthread_t               thread;
+
+    // Copy out the family and style of every item, so the thread does not touch the menus
+    for (m = 0; m < gNumFontMenus; m++)
+        numJobs += gFontMenus[m].numItems;
+    gFontMenuJobs = (MyFontMenuJob *) malloc((numJobs + 1) * sizeof(MyFontMenuJob));
+    if (gFontMenuJobs == NULL) {
+        gFontMenuReady = true;
+        return;
+    }
+
+    for (m = 0; m < gNumFontMenus; m++) {
+        MyFontMenuInfo      *info = &gFontMenus[m];
+
+        for (i=1; info->menu != NULL && i <= info->numItems; i++) {
+            if ( info->items[i - 1].isFont ) {
+                MyFontMenuJob   *job = &gFontMenuJobs[gNumFontMenuJobs++];
+
+                job->menuIndex = m;
+                job->item = i;
+                job->family = info->items[i - 1].family;
+                job->style = info->items[i - 1].style;
+                job->font = kInvalidFont;
             }
         }
-    
-        // Check the new item
-        if (theSubMenu != NULL) {
-            gFontMenuCurrentMenuRef = theSubMenu;
-            gFontMenuCurrentMenuItem = j;
-            SetItemMark(GetMenuRef(gFontMenuID), i, kMenuDashMark);
+    }
+
+    verify_noerr( InstallApplicationEventHandler(NewEventHandlerUPP(DoFontMenuReady), 1, &readyEvent, NULL, NULL) );
+    if ( pthread_create(&thread, NULL, ResolveFontMenuFonts, NULL) == 0 )
+        pthread_detach(thread);
+    else {
+        // No thread; do the work now
+        ResolveFontMenuFonts(NULL);
+        FinishFontMenuIndex();
+    }
+}
+
+
+// Records the font menu and each of its submenus along with the item it hangs from,
+// and the font family and style of every item.  This information is then used by
+// GetFontMenuParentItem and BuildFontMenuIndex.
+//
+void BuildFontMenuParentItemArray(void)
+{
+    ItemCount               numItems;
+    int                     i, currentIndex;
+    MenuRef                 theSubMenu;
+
+    AddFontMenuInfo(gFontMenuRef, 0);
+
+    currentIndex = 0;
+    numItems = CountMenuItems(gFontMenuRef);
+
+    for (i=1; i <= numItems; i++) {
+
+        verify_noerr( GetMenuItemHierarchicalMenu(gFontMenuRef, i, &theSubMenu) );
+
+        if ( theSubMenu != NULL ) {
+            AddFontMenuInfo(theSubMenu, i);
+            currentIndex++;
         }
-        else {
-            gFontMenuCurrentMenuRef = GetMenuRef(gFontMenuID);
-            gFontMenuCurrentMenuItem = i;
+    }
+
+    check( currentIndex == gNumHierarchicalItems );     // Make sure we found the right number
+}
+
+
+// Gets the parent item of a font in a submenu.  Returns zero if not found.
+//
+MenuItemIndex GetFontMenuParentItem(MenuRef inMenu)
+{
+    MyFontMenuInfo          *info = GetFontMenuInfo(inMenu);
+
+    return (info != NULL) ? info->parentItem : 0;
+}
+
+
+// Unchecks the current item, and takes the dash off its submenu's parent item
+//
+static void UncheckCurrentFontMenuItem(void)
+{
+    MenuItemIndex           parentMenuItem;
+
+    if (gFontMenuCurrentMenuItem == (MenuItemIndex)-1) return;
+
+    CheckMenuItem(gFontMenuCurrentMenuRef, gFontMenuCurrentMenuItem, false);
+    parentMenuItem = GetFontMenuParentItem(gFontMenuCurrentMenuRef);
+    if ( parentMenuItem > 0 ) {
+        SetItemMark(gFontMenuRef, parentMenuItem, kMenuNoMark);
+    }
+}
+
+
+// Checks an item and makes it the current one.  An item in a submenu puts a dash
+// on the submenu's parent item.
+//
+static void CheckFontMenuItem(MenuRef inMenu, MenuItemIndex inItem, MenuItemIndex inParentItem)
+{
+    CheckMenuItem(inMenu, inItem, true);
+    if ( inParentItem > 0 ) {
+        SetItemMark(gFontMenuRef, inParentItem, kMenuDashMark);
+    }
+
+    // Store the current item in the globals for future reference
+    gFontMenuCurrentMenuRef = inMenu;
+    gFontMenuCurrentMenuItem = inItem;
+}
+
+
+// Handles changes to the font menu
+//
+FMFont SelectAndGetFont(MenuRef theMenu, MenuItemIndex theItem)
+{
+    // A font chosen from the menu replaces one still waiting for the index
+    gPendingFont = kInvalidFont;
+    UncheckCurrentFontMenuItem();
+    CheckFontMenuItem(theMenu, theItem, GetFontMenuParentItem(theMenu));
+
+    // Return the proper font
+    return GetFontMenuItemFont(theMenu, theItem);
+}
+
+
+// Finds and selects the specified font, using the index made by BuildFontMenuIndex
+// Returns false if the font could not be found.  If the index is still being built
+// the font is selected once it is.
+//
+Boolean FindAndSelectFont(FMFont iFont)
+{
+    MyFontMenuEntry         *entry;
+    TraceScope              scope;
+    Boolean                 found = false;
+
+    if ( ! gFontMenuReady ) {
+        gPendingFont = iFont;
+        return true;
+    }
+
+    TraceBegin(&scope, "FindAndSelectFont");
+    if (gFontMenuIndex != NULL) {
+        entry = FindFontMenuSlot(gFontMenuIndex, gFontMenuIndexCapacity, iFont);
+        if (entry->menu != NULL) {
+            UncheckCurrentFontMenuItem();
+            CheckFontMenuItem(entry->menu, entry->item, entry->parentItem);
+            found = true;
         }
-        CheckMenuItem(gFontMenuCurrentMenuRef, gFontMenuCurrentMenuItem, true);
     }
+    TraceEnd(&scope);
 
     return found;
 }
@@ -57,8 +57,10 @@ OSStatus InstallFontMenu(MenuID menuID);
 FMFont SelectAndGetFont(MenuRef theMenu, MenuItemIndex theItem);
 MenuItemIndex GetFontMenuParentItem(MenuRef inMenu);
 Boolean FindAndSelectFont(FMFont iFont);
+ATSUFontID FindFontByFullName(const char *name);
 
 // Internal functions, do not call these
 void BuildFontMenuParentItemArray(void);
+void BuildFontMenuIndex(void);
 
 #endif  /* MY_FONTMENU_H */
@@ -0,0 +1,293 @@
+/*
+
+File: fontruns.c
+
+Abstract: Splits text into runs by which font covers it.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fontruns.h"
+
+
+int FontCoverageInit(FontCoverage *coverage)
+{
+    coverage->numCodePoints = 0;
+    coverage->pages = (unsigned char **) calloc(kFontCoveragePages, sizeof(unsigned char *));
+    return (coverage->pages != NULL) ? 0 : -1;
+}
+
+
+void FontCoverageDispose(FontCoverage *coverage)
+{
+    size_t              i;
+
+    if (coverage->pages != NULL) {
+        for (i = 0; i < kFontCoveragePages; i++)
+            free(coverage->pages[i]);
+        free(coverage->pages);
+    }
+    coverage->pages = NULL;
+    coverage->numCodePoints = 0;
+}
+
+
+// Marks the code points from first to last, inclusive, as covered.  Returns zero
+// on success.
+//
+int FontCoverageAdd(FontCoverage *coverage, unsigned long first, unsigned long last)
+{
+    unsigned long       c;
+
+    if (last >= kFontCoveragePages * 256UL)
+        last = kFontCoveragePages * 256UL - 1;
+
+    for (c = first; c <= last; c++) {
+        unsigned char   **page = &coverage->pages[c >> 8];
+        unsigned char   bit = (unsigned char) (1 << (c & 7));
+
+        if (*page == NULL) {
+            *page = (unsigned char *) calloc(32, 1);
+            if (*page == NULL) return -1;
+        }
+        if (((*page)[(c & 0xFF) >> 3] & bit) == 0) {
+            (*page)[(c & 0xFF) >> 3] |= bit;
+            coverage->numCodePoints++;
+        }
+    }
+    return 0;
+}
+
+
+static unsigned int ReadU16(const unsigned char *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+
+static unsigned long ReadU32(const unsigned char *p)
+{
+    return ((unsigned long) p[0] << 24) | ((unsigned long) p[1] << 16) | ((unsigned long) p[2] << 8) | p[3];
+}
+
+
+// Adds the code points of a format 4 (BMP) subtable that map to a glyph
+//
+static int AddFormat4(FontCoverage *coverage, const unsigned char *table, size_t length)
+{
+    unsigned int        segCountX2, seg;
+
+    if (length < 14) return -1;
+    segCountX2 = ReadU16(table + 6);
+    if (16 + 4 * (size_t) segCountX2 > length) return -1;
+
+    for (seg = 0; seg < segCountX2; seg += 2) {
+        unsigned int    end = ReadU16(table + 14 + seg);
+        unsigned int    start = ReadU16(table + 16 + segCountX2 + seg);
+        unsigned int    delta = ReadU16(table + 16 + 2 * segCountX2 + seg);
+        size_t          rangeOffsetPos = 16 + 3 * (size_t) segCountX2 + seg;
+        unsigned int    rangeOffset = ReadU16(table + rangeOffsetPos);
+        unsigned int    c;
+
+        if (end == 0xFFFF) end = 0xFFFE;        // The last segment only maps U+FFFF to nothing
+        if (start > end) continue;
+
+        // With no range offset every code in the segment maps to a glyph but one
+        if (rangeOffset == 0) {
+            unsigned int    missing = (0x10000 - delta) & 0xFFFF;
+
+            if (missing >= start && missing <= end) {
+                if (missing > start && FontCoverageAdd(coverage, start, missing - 1) != 0) return -1;
+                if (missing < end && FontCoverageAdd(coverage, missing + 1, end) != 0) return -1;
+            }
+            else if (FontCoverageAdd(coverage, start, end) != 0)
+                return -1;
+            continue;
+        }
+
+        for (c = start; c <= end; c++) {
+            size_t          glyphPos = rangeOffsetPos + rangeOffset + 2 * (size_t) (c - start);
+            unsigned int    glyph;
+
+            if (glyphPos + 2 > length) break;
+            glyph = ReadU16(table + glyphPos);
+            if (glyph != 0 && ((glyph + delta) & 0xFFFF) != 0 && FontCoverageAdd(coverage, c, c) != 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+
+// Adds the code points of a format 12 (full repertoire) subtable
+//
+static int AddFormat12(FontCoverage *coverage, const unsigned char *table, size_t length)
+{
+    unsigned long       numGroups, i;
+
+    if (length < 16) return -1;
+    numGroups = ReadU32(table + 12);
+    if (numGroups > (length - 16) / 12) return -1;
+
+    for (i = 0; i < numGroups; i++) {
+        const unsigned char *group = table + 16 + 12 * i;
+        unsigned long       start = ReadU32(group), end = ReadU32(group + 4), startGlyph = ReadU32(group + 8);
+
+        if (startGlyph == 0) start++;           // Mapped to .notdef
+        if (start <= end && FontCoverageAdd(coverage, start, end) != 0) return -1;
+    }
+    return 0;
+}
+
+
+// Makes the coverage of a font from its whole 'cmap' table.  A full-repertoire
+// (format 12) Unicode subtable is used if there is one, otherwise a BMP (format 4)
+// one.  Returns zero on success; a font without a Unicode subtable covers nothing.
+//
+int FontCoverageInitFromCmap(FontCoverage *coverage, const unsigned char *cmap, size_t length)
+{
+    size_t              full = 0, bmp = 0, fullLength = 0, bmpLength = 0;
+    unsigned int        numTables, i;
+
+    if (FontCoverageInit(coverage) != 0) return -1;
+    if (length < 4) return 0;
+
+    numTables = ReadU16(cmap + 2);
+    if (4 + 8 * (size_t) numTables > length) return 0;
+
+    for (i = 0; i < numTables; i++) {
+        const unsigned char *record = cmap + 4 + 8 * i;
+        unsigned int        platform = ReadU16(record), encoding = ReadU16(record + 2);
+        unsigned long       offset = ReadU32(record + 4);
+        unsigned int        format;
+
+        if ( ! (platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10))) ) continue;
+        if (offset + 8 > length) continue;
+
+        format = ReadU16(cmap + offset);
+        if (format == 12 && full == 0) {
+            full = offset;
+            fullLength = length - offset;
+        }
+        if (format == 4 && bmp == 0) {
+            bmp = offset;
+            bmpLength = length - offset;
+        }
+    }
+
+    if (full != 0)
+        return AddFormat12(coverage, cmap + full, fullLength);
+    if (bmp != 0)
+        return AddFormat4(coverage, cmap + bmp, bmpLength);
+    return 0;
+}
+
+
+// Characters that belong with the one before them, whatever font that is in:
+// combining marks, joiners and variation selectors
+//
+static int IsClusterExtender(unsigned long c)
+{
+    return (c >= 0x0300 && c <= 0x036F) || (c >= 0x1AB0 && c <= 0x1AFF) || (c >= 0x1DC0 && c <= 0x1DFF)
+        || (c >= 0x20D0 && c <= 0x20FF) || (c >= 0xFE20 && c <= 0xFE2F) || (c >= 0xFE00 && c <= 0xFE0F)
+        || (c >= 0xE0100 && c <= 0xE01EF) || c == 0x200C || c == 0x200D;
+}
+
+
+// Splits the text from start up to end into runs of the first font in 'fonts' that
+// covers each character, so font 0 is used wherever it can be.  A character that
+// font 0 does not cover stays in the current fallback run if that run's font covers
+// it, so text in another script is not broken up needlessly.  Characters in
+// 'unmatched' (which may be NULL) are known to be in no font, and go in font 0
+// rather than in a run of -1.  'runs' must have room for end - start runs.
+// Returns the number of runs.
+//
+size_t FontRunsSplit(const unsigned short *text, size_t start, size_t end, const FontCoverage *const *fonts, int numFonts,
+                     const FontCoverage *unmatched, FontRun *runs)
+{
+    size_t              numRuns = 0, i, next;
+
+    for (i = start; i < end; i = next) {
+        unsigned long   c = text[i];
+        int             font = -1, f;
+
+        // Surrogate pairs are one character
+        next = i + 1;
+        if (c >= 0xD800 && c <= 0xDBFF && next < end && text[next] >= 0xDC00 && text[next] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (text[next] - 0xDC00);
+            next++;
+        }
+
+        if (numRuns > 0) {
+            FontRun     *run = &runs[numRuns - 1];
+
+            if (IsClusterExtender(c) || c < 0x20
+                || (run->font == 0 && FontCoverageContains(fonts[0], c))
+                || (run->font > 0 && FontCoverageContains(fonts[run->font], c) && ! FontCoverageContains(fonts[0], c))) {
+                run->length = next - run->start;
+                continue;
+            }
+        }
+
+        for (f = 0; f < numFonts && font < 0; f++) {
+            if (FontCoverageContains(fonts[f], c))
+                font = f;
+        }
+        if (font < 0 && unmatched != NULL && FontCoverageContains(unmatched, c))
+            font = 0;
+
+        if (numRuns > 0 && runs[numRuns - 1].font == font)
+            runs[numRuns - 1].length = next - runs[numRuns - 1].start;
+        else {
+            runs[numRuns].start = i;
+            runs[numRuns].length = next - i;
+            runs[numRuns].font = font;
+            numRuns++;
+        }
+    }
+    return numRuns;
+}
@@ -0,0 +1,97 @@
+/*
+
+File: fontruns.h
+
+Abstract: Splits text into runs by which font covers it.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_FONTRUNS_H
+#define MY_FONTRUNS_H
+
+// Splits text into runs by which font has glyphs for it.  Each font's coverage is a
+// bitmap of the code points its 'cmap' maps to a glyph, made once per font, so
+// finding a font for a character is a bit test rather than a question to the
+// layout engine.  Plain C with no Carbon dependencies.
+
+#include <stddef.h>
+
+#define kFontCoveragePages      0x1100      // 256 code points a page, up to U+10FFFF
+
+typedef struct {
+    unsigned char       **pages;            // kFontCoveragePages entries; NULL for empty pages
+    size_t              numCodePoints;
+} FontCoverage;
+
+// A run of text set in one font.  'font' is an index into the fonts passed to
+// FontRunsSplit(), or -1 if none of them has glyphs for the text.
+//
+typedef struct {
+    size_t              start;
+    size_t              length;
+    int                 font;
+} FontRun;
+
+
+int FontCoverageInit(FontCoverage *coverage);
+void FontCoverageDispose(FontCoverage *coverage);
+int FontCoverageAdd(FontCoverage *coverage, unsigned long first, unsigned long last);
+int FontCoverageInitFromCmap(FontCoverage *coverage, const unsigned char *cmap, size_t length);
+
+// True if the code point is covered
+//
+static inline int FontCoverageContains(const FontCoverage *coverage, unsigned long codepoint)
+{
+    const unsigned char *page;
+
+    if (codepoint >= kFontCoveragePages * 256UL || coverage->pages == NULL) return 0;
+    page = coverage->pages[codepoint >> 8];
+    return page != NULL && (page[(codepoint & 0xFF) >> 3] & (1 << (codepoint & 7))) != 0;
+}
+
+size_t FontRunsSplit(const unsigned short *text, size_t start, size_t end, const FontCoverage *const *fonts, int numFonts,
+                     const FontCoverage *unmatched, FontRun *runs);
+
+#endif  /* MY_FONTRUNS_H */
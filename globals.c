@@ -51,9 +51,9 @@ Copyright 
 #include "globals.h"
 
 
-float									gStrokeThicknessFactor = 0.024;
+float									gStrokeThicknessFactor = kDefaultStrokeThicknessFactor;
+UInt32									gEmboldenMethod = kEmboldenByOutline;
 
-Boolean									gCurrentlyPrinting = false;
 Boolean                                 gNewCG = false;
 UInt32                                  gCurrentFontSizeCommandID = 'Z048';
 WindowRef                               gWindow;
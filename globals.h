@@ -61,6 +61,11 @@ enum {
     kFontMenuID         = 128
 };
 
+// The Save Trace command, added to the File menu when phase timing is on
+enum {
+    kSaveTraceCommand   = 'Trce'
+};
+
 // Constants for menu check marks
 // (UniChar constants)
 enum {
@@ -69,15 +74,25 @@ enum {
     kMenuNoMark                         = 0x0000        // Null character -- shows up as no mark in a menu
 };
 
+// How the antialiased bold box is emboldened
+enum {
+    kEmboldenByOutline                  = 0,            // Fill emboldened glyph outlines
+    kEmboldenByDilation                 = 1             // Dilate the coverage mask of the regular box
+};
+
+// The stroke factor the slider starts at.  A font in the stroke factor table is
+// emboldened by its own factor, scaled by how far the slider is from this one.
+#define kDefaultStrokeThicknessFactor   0.024
+
 
 //
 //  - = - Global variables - = -
 //
 
 extern float									gStrokeThicknessFactor;
+extern UInt32									gEmboldenMethod;
 
 extern Boolean                                  gNewCG;
-extern Boolean									gCurrentlyPrinting;
 extern UInt32                                   gCurrentFontSizeCommandID;
 extern WindowRef                                gWindow;
 extern HIViewRef								gView;
@@ -0,0 +1,282 @@
+/*
+
+File: glyphcache.c
+
+Abstract: Cache of rendered glyph coverage masks with LRU eviction under a
+byte budget for SyntheticBoldDemo project. Has no Carbon dependencies.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "glyphcache.h"
+
+
+// - = - Hashing - = -
+
+static size_t HashKey(const GlyphCacheKey *key)
+{
+    unsigned long   h = 2166136261UL;
+    unsigned int    size, factor;
+
+    // Floats are hashed by their bit patterns; keys are built the same way every time
+    memcpy(&size, &key->pixelSize, sizeof(size));
+    memcpy(&factor, &key->strokeFactor, sizeof(factor));
+
+    h = (h ^ key->fontID) * 16777619UL;
+    h = (h ^ key->glyphID) * 16777619UL;
+    h = (h ^ size) * 16777619UL;
+    h = (h ^ factor) * 16777619UL;
+    h = (h ^ ((unsigned long) key->antialias | (key->bold << 1) | (key->subpixelX << 2) | (key->subpixelY << 10))) * 16777619UL;
+    return (size_t) (h ^ (h >> 15));
+}
+
+
+static int KeysEqual(const GlyphCacheKey *a, const GlyphCacheKey *b)
+{
+    return a->fontID == b->fontID && a->glyphID == b->glyphID
+        && a->pixelSize == b->pixelSize && a->strokeFactor == b->strokeFactor
+        && a->antialias == b->antialias && a->bold == b->bold
+        && a->subpixelX == b->subpixelX && a->subpixelY == b->subpixelY;
+}
+
+
+// - = - LRU list - = -
+
+static void Unlink(GlyphCache *cache, GlyphCacheEntry *entry)
+{
+    if (entry->lruPrev != NULL) entry->lruPrev->lruNext = entry->lruNext;
+    else cache->lruHead = entry->lruNext;
+    if (entry->lruNext != NULL) entry->lruNext->lruPrev = entry->lruPrev;
+    else cache->lruTail = entry->lruPrev;
+    entry->lruPrev = entry->lruNext = NULL;
+}
+
+
+static void PushFront(GlyphCache *cache, GlyphCacheEntry *entry)
+{
+    entry->lruPrev = NULL;
+    entry->lruNext = cache->lruHead;
+    if (cache->lruHead != NULL) cache->lruHead->lruPrev = entry;
+    cache->lruHead = entry;
+    if (cache->lruTail == NULL) cache->lruTail = entry;
+}
+
+
+// Removes an entry from the hash table and the list and frees it
+//
+static void RemoveEntry(GlyphCache *cache, GlyphCacheEntry *entry)
+{
+    GlyphCacheEntry     **link = &cache->buckets[HashKey(&entry->key) & (cache->numBuckets - 1)];
+
+    while (*link != entry)
+        link = &(*link)->hashNext;
+    *link = entry->hashNext;
+    Unlink(cache, entry);
+
+    if (cache->releaseProc != NULL)
+        cache->releaseProc(&entry->bitmap);
+    else
+        free(entry->bitmap.pixels);
+
+    cache->stats.count--;
+    cache->stats.bytes -= entry->bytes;
+    free(entry);
+}
+
+
+// Evicts least recently used entries until the cache fits in its budget
+//
+static void Trim(GlyphCache *cache)
+{
+    while (cache->stats.bytes > cache->budget && cache->lruTail != NULL) {
+        RemoveEntry(cache, cache->lruTail);
+        cache->stats.evictions++;
+    }
+}
+
+
+// Doubles the number of buckets when the average chain gets longer than one
+//
+static void Grow(GlyphCache *cache)
+{
+    size_t              newCount = cache->numBuckets * 2, i;
+    GlyphCacheEntry     **newBuckets = (GlyphCacheEntry **) calloc(newCount, sizeof(GlyphCacheEntry *));
+
+    if (newBuckets == NULL) return;
+    for (i = 0; i < cache->numBuckets; i++) {
+        GlyphCacheEntry     *entry = cache->buckets[i], *next;
+
+        for (; entry != NULL; entry = next) {
+            size_t          b = HashKey(&entry->key) & (newCount - 1);
+            next = entry->hashNext;
+            entry->hashNext = newBuckets[b];
+            newBuckets[b] = entry;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = newBuckets;
+    cache->numBuckets = newCount;
+}
+
+
+// - = - Public interface - = -
+
+// Sets up an empty cache.  Returns zero on success.
+//
+int GlyphCacheInit(GlyphCache *cache, size_t budget, GlyphCacheReleaseProc releaseProc)
+{
+    memset(cache, 0, sizeof(GlyphCache));
+    cache->numBuckets = 256;
+    cache->buckets = (GlyphCacheEntry **) calloc(cache->numBuckets, sizeof(GlyphCacheEntry *));
+    if (cache->buckets == NULL) return -1;
+    cache->budget = budget;
+    cache->releaseProc = releaseProc;
+    return 0;
+}
+
+
+void GlyphCacheDispose(GlyphCache *cache)
+{
+    if (cache->buckets == NULL) return;
+    GlyphCacheFlush(cache);
+    free(cache->buckets);
+    memset(cache, 0, sizeof(GlyphCache));
+}
+
+
+// Removes every entry.  The counters are kept.
+//
+void GlyphCacheFlush(GlyphCache *cache)
+{
+    while (cache->lruHead != NULL)
+        RemoveEntry(cache, cache->lruHead);
+}
+
+
+void GlyphCacheSetBudget(GlyphCache *cache, size_t budget)
+{
+    cache->budget = budget;
+    Trim(cache);
+}
+
+
+// Splits a position into a whole pixel and a subpixel step, for building keys.
+// Returns the whole pixel; the glyph should be rendered at
+// *outSubpixel / kGlyphCacheSubpixelSteps past it.
+//
+int GlyphCacheQuantize(float position, unsigned char *outSubpixel)
+{
+    float           steps = floorf(position * kGlyphCacheSubpixelSteps + 0.5f);
+    int             whole = (int) floorf(steps / kGlyphCacheSubpixelSteps);
+
+    *outSubpixel = (unsigned char) (steps - (float) whole * kGlyphCacheSubpixelSteps);
+    return whole;
+}
+
+
+// Returns the bitmap for a key, or NULL if it has to be rendered.  Either way the
+// result is counted as a hit or a miss.
+//
+const GlyphBitmap *GlyphCacheLookup(GlyphCache *cache, const GlyphCacheKey *key)
+{
+    GlyphCacheEntry     *entry = cache->buckets[HashKey(key) & (cache->numBuckets - 1)];
+
+    for (; entry != NULL; entry = entry->hashNext) {
+        if (KeysEqual(&entry->key, key)) {
+            if (entry != cache->lruHead) {
+                Unlink(cache, entry);
+                PushFront(cache, entry);
+            }
+            cache->stats.hits++;
+            return &entry->bitmap;
+        }
+    }
+    cache->stats.misses++;
+    return NULL;
+}
+
+
+// Adds a rendered glyph.  The key must not already be in the cache.  Returns the
+// cached bitmap, whose pixels and user data the cache now owns, or NULL if it could
+// not be kept; a bitmap that is bigger than the whole budget is never kept.  A
+// bitmap that was not kept still belongs to the caller, who should draw it and
+// then release it, so that what is drawn never depends on the budget.
+//
+const GlyphBitmap *GlyphCacheInsert(GlyphCache *cache, const GlyphCacheKey *key, const GlyphBitmap *bitmap)
+{
+    GlyphCacheEntry     *entry;
+    size_t              b;
+
+    if ((size_t) bitmap->rowBytes * bitmap->height > cache->budget)
+        return NULL;
+    entry = (GlyphCacheEntry *) malloc(sizeof(GlyphCacheEntry));
+    if (entry == NULL)
+        return NULL;
+
+    entry->key = *key;
+    entry->bitmap = *bitmap;
+    entry->bytes = (size_t) bitmap->rowBytes * bitmap->height;
+
+    if ((cache->stats.count + 1) > cache->numBuckets)
+        Grow(cache);
+    b = HashKey(key) & (cache->numBuckets - 1);
+    entry->hashNext = cache->buckets[b];
+    cache->buckets[b] = entry;
+    PushFront(cache, entry);
+    cache->stats.count++;
+    cache->stats.bytes += entry->bytes;
+
+    Trim(cache);
+    return &entry->bitmap;
+}
+
+
+void GlyphCacheGetStats(const GlyphCache *cache, GlyphCacheStats *outStats)
+{
+    *outStats = cache->stats;
+}
@@ -0,0 +1,137 @@
+/*
+
+File: glyphcache.h
+
+Abstract: Cache of rendered glyph coverage masks with LRU eviction for
+SyntheticBoldDemo project. Has no Carbon dependencies.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_GLYPHCACHE_H
+#define MY_GLYPHCACHE_H
+
+// A cache of rendered glyph coverage masks, so that redrawing unchanged text is
+// mostly a matter of copying bitmaps.  Entries are evicted least recently used
+// first once the pixels exceed a byte budget.  Plain C with no Carbon
+// dependencies, like raster.h; the Carbon code hangs its CGImage off userData.
+
+#include <stddef.h>
+
+// Glyph positions are rounded to this many steps per pixel before rendering
+//
+#define kGlyphCacheSubpixelSteps        4
+
+#define kGlyphCacheDefaultBudget        (4 * 1024 * 1024)
+
+// Everything that changes the pixels of a rendered glyph
+//
+typedef struct {
+    unsigned long       fontID;
+    unsigned int        glyphID;
+    float               pixelSize;
+    float               strokeFactor;       // Zero for the regular variant
+    unsigned char       antialias;
+    unsigned char       bold;
+    unsigned char       subpixelX;          // 0 to kGlyphCacheSubpixelSteps - 1
+    unsigned char       subpixelY;
+} GlyphCacheKey;
+
+// A rendered glyph.  'left' and 'top' give the position of the top left pixel
+// relative to the glyph origin, in the caller's coordinate system.
+//
+typedef struct {
+    unsigned char       *pixels;
+    int                 width;
+    int                 height;
+    int                 rowBytes;
+    int                 left;
+    int                 top;
+    void                *userData;          // For the caller; released by the release proc
+} GlyphBitmap;
+
+// Called when an entry is evicted.  It owns the bitmap's pixels from then on; if no
+// proc is set the pixels are simply freed.
+//
+typedef void (*GlyphCacheReleaseProc)(GlyphBitmap *bitmap);
+
+typedef struct GlyphCacheEntry {
+    GlyphCacheKey               key;
+    GlyphBitmap                 bitmap;
+    size_t                      bytes;
+    struct GlyphCacheEntry      *hashNext;
+    struct GlyphCacheEntry      *lruPrev;       // Towards the most recently used entry
+    struct GlyphCacheEntry      *lruNext;
+} GlyphCacheEntry;
+
+typedef struct {
+    unsigned long       hits;
+    unsigned long       misses;
+    unsigned long       evictions;
+    size_t              count;
+    size_t              bytes;
+} GlyphCacheStats;
+
+typedef struct {
+    GlyphCacheEntry     **buckets;
+    size_t              numBuckets;
+    GlyphCacheEntry     *lruHead;           // Most recently used
+    GlyphCacheEntry     *lruTail;           // Next to go
+    size_t              budget;
+    GlyphCacheReleaseProc releaseProc;
+    GlyphCacheStats     stats;
+} GlyphCache;
+
+
+int GlyphCacheInit(GlyphCache *cache, size_t budget, GlyphCacheReleaseProc releaseProc);
+void GlyphCacheDispose(GlyphCache *cache);
+void GlyphCacheFlush(GlyphCache *cache);
+void GlyphCacheSetBudget(GlyphCache *cache, size_t budget);
+
+int GlyphCacheQuantize(float position, unsigned char *outSubpixel);
+const GlyphBitmap *GlyphCacheLookup(GlyphCache *cache, const GlyphCacheKey *key);
+const GlyphBitmap *GlyphCacheInsert(GlyphCache *cache, const GlyphCacheKey *key, const GlyphBitmap *bitmap);
+void GlyphCacheGetStats(const GlyphCache *cache, GlyphCacheStats *outStats);
+
+#endif  /* MY_GLYPHCACHE_H */
@@ -0,0 +1,452 @@
+/*
+
+File: headless.c
+
+Abstract: Headless version of the SyntheticBoldDemo drawing code. Renders the
+same regular and synthetic bold comparison as DrawATSUIStuff() into an
+in-memory coverage buffer, so it can run on machines with no display.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "headless.h"
+#include "dilate.h"
+
+
+// Same test as IsAntiAliased() in atsui.c, using the threshold from the params
+//
+int HeadlessIsAntiAliased(const HeadlessParams *params)
+{
+    if (params->antiAliasingThreshold >= 0)
+        return (params->pointSize > params->antiAliasingThreshold); // The threshold is the maximum not-antialiasing size
+    else
+        return 1;
+}
+
+
+// Converts UTF-8, such as a command line argument, to UTF-16.  'out' needs room for
+// twice as many units as there are bytes.  Returns the number of units written.
+//
+size_t HeadlessDecodeUTF8(const char *s, unsigned short *out)
+{
+    const unsigned char *p = (const unsigned char *) s;
+    size_t              n = 0;
+
+    while (*p) {
+        unsigned long   c;
+        int             extra;
+
+        if (*p < 0x80)                  { c = *p;        extra = 0; }
+        else if ((*p & 0xE0) == 0xC0)   { c = *p & 0x1F; extra = 1; }
+        else if ((*p & 0xF0) == 0xE0)   { c = *p & 0x0F; extra = 2; }
+        else if ((*p & 0xF8) == 0xF0)   { c = *p & 0x07; extra = 3; }
+        else                            { c = 0xFFFD;    extra = 0; }
+        p++;
+
+        while (extra-- > 0 && (*p & 0xC0) == 0x80)
+            c = (c << 6) | (*p++ & 0x3F);
+
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            out[n++] = (unsigned short) (0xD800 + (c >> 10));
+            out[n++] = (unsigned short) (0xDC00 + (c & 0x3FF));
+        }
+        else
+            out[n++] = (unsigned short) c;
+    }
+    return n;
+}
+
+
+// Decodes the UTF-16 character at *index and advances past it
+//
+static unsigned long NextCodepoint(const unsigned short *text, size_t length, size_t *index)
+{
+    unsigned long   c = text[(*index)++];
+
+    if (c >= 0xD800 && c <= 0xDBFF && *index < length) {
+        unsigned long   low = text[*index];
+        if (low >= 0xDC00 && low <= 0xDFFF) {
+            (*index)++;
+            c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+        }
+    }
+    return c;
+}
+
+
+void HeadlessLayoutInit(HeadlessLayout *layout)
+{
+    memset(layout, 0, sizeof(HeadlessLayout));
+}
+
+
+// Forces the next HeadlessShapeText() call to shape the text again
+//
+void HeadlessLayoutInvalidate(HeadlessLayout *layout)
+{
+    layout->valid = 0;
+}
+
+
+void HeadlessLayoutDispose(HeadlessLayout *layout)
+{
+    free(layout->records);
+    HeadlessLayoutInit(layout);
+}
+
+
+// Turns the text into a flat array of glyphs and positions.  Nothing is done if
+// the layout already holds the result for the same text, font and size.
+// Returns zero on success.
+//
+int HeadlessShapeText(HeadlessLayout *layout, const HeadlessParams *params)
+{
+    float           scale, x = 0;
+    size_t          i = 0;
+
+    if (layout->valid && layout->font == params->font && layout->text == params->text
+        && layout->length == params->length && layout->pointSize == params->pointSize)
+        return 0;
+
+    // There is at most one glyph per UTF-16 unit
+    if (layout->capacity < params->length) {
+        HeadlessGlyphRecord *newRecords = (HeadlessGlyphRecord *) realloc(layout->records, params->length * sizeof(HeadlessGlyphRecord));
+
+        if (newRecords == NULL) return -1;
+        layout->records = newRecords;
+        layout->capacity = params->length;
+    }
+
+    scale = params->pointSize / params->font->unitsPerEm;
+    layout->numRecords = 0;
+    while (i < params->length) {
+        unsigned int    glyph = FontFileGetGlyphIndex(params->font, NextCodepoint(params->text, params->length, &i));
+
+        layout->records[layout->numRecords].glyphID = glyph;
+        layout->records[layout->numRecords].x = x;
+        layout->numRecords++;
+        x += FontFileGetAdvance(params->font, glyph) * scale;
+    }
+
+    layout->width = x;
+    layout->font = params->font;
+    layout->text = params->text;
+    layout->length = params->length;
+    layout->pointSize = params->pointSize;
+    layout->valid = 1;
+    return 0;
+}
+
+
+// Renders one glyph into a new bitmap just big enough for it, with the glyph origin
+// 'subX' and 'subY' pixels past the bitmap's (left, top) pixel.  Returns zero on
+// success; a glyph with no ink gives an empty bitmap.
+//
+static int RenderGlyphBitmap(const GlyphOutline *outline, RasterPath *glyphPath, float subX, float subY,
+                             int antialias, GlyphBitmap *outBitmap)
+{
+    float           minX, minY, maxX, maxY;
+    RasterBuffer    glyphBuffer;
+
+    memset(outBitmap, 0, sizeof(GlyphBitmap));
+    RasterPathReset(glyphPath);
+    GlyphOutlineFlatten(outline, subX, subY, glyphPath);
+    if ( ! RasterPathGetBounds(glyphPath, &minX, &minY, &maxX, &maxY) ) return 0;
+
+    outBitmap->left = (int) floorf(minX) - 1;
+    outBitmap->top = (int) floorf(minY) - 1;
+    if (RasterBufferCreate(&glyphBuffer, (int) ceilf(maxX) + 1 - outBitmap->left, (int) ceilf(maxY) + 1 - outBitmap->top) != 0)
+        return -1;
+    RasterFillPath(&glyphBuffer, glyphPath, (float) -outBitmap->left, (float) -outBitmap->top, antialias);
+
+    // Keep the pixels, drop the rest of the buffer
+    outBitmap->pixels = glyphBuffer.pixels;
+    outBitmap->width = glyphBuffer.width;
+    outBitmap->height = glyphBuffer.height;
+    outBitmap->rowBytes = glyphBuffer.rowBytes;
+    glyphBuffer.pixels = NULL;
+    RasterBufferDispose(&glyphBuffer);
+    return 0;
+}
+
+
+// Draws one glyph through the glyph cache, rendering it first if needed
+//
+static void DrawCachedGlyph(RasterBuffer *buffer, const HeadlessParams *params, unsigned int glyphID,
+                            GlyphOutline *outline, RasterPath *glyphPath,
+                            float x, float y, int antialias, int emboldened)
+{
+    GlyphCacheKey       key;
+    GlyphBitmap         rendered;
+    const GlyphBitmap   *bitmap;
+    int                 wholeX, wholeY, uncached = 0;
+
+    memset(&key, 0, sizeof(key));
+    wholeX = GlyphCacheQuantize(x, &key.subpixelX);
+    wholeY = GlyphCacheQuantize(y, &key.subpixelY);
+    key.fontID = (unsigned long) (size_t) params->font;
+    key.glyphID = glyphID;
+    key.pixelSize = params->pointSize;
+    key.strokeFactor = emboldened ? params->strokeThicknessFactor : 0;
+    key.antialias = (unsigned char) antialias;
+    key.bold = (unsigned char) emboldened;
+
+    bitmap = GlyphCacheLookup(params->glyphCache, &key);
+    if (bitmap == NULL) {
+        GlyphOutlineReset(outline);
+        if (FontFileGetGlyphOutline(params->font, glyphID, params->pointSize / params->font->unitsPerEm, outline) != 0) return;
+        if (emboldened)
+            GlyphOutlineEmbolden(outline, params->strokeThicknessFactor * params->pointSize / 2);
+
+        if (RenderGlyphBitmap(outline, glyphPath, (float) key.subpixelX / kGlyphCacheSubpixelSteps,
+                              (float) key.subpixelY / kGlyphCacheSubpixelSteps, antialias, &rendered) != 0)
+            return;
+        bitmap = GlyphCacheInsert(params->glyphCache, &key, &rendered);
+
+        // A glyph too big for the cache is drawn all the same, then freed
+        if (bitmap == NULL) {
+            bitmap = &rendered;
+            uncached = 1;
+        }
+    }
+
+    if (bitmap->pixels != NULL)
+        RasterCompositeMask(buffer, bitmap->pixels, bitmap->rowBytes, bitmap->width, bitmap->height,
+                            wholeX + bitmap->left, wholeY + bitmap->top);
+    if (uncached)
+        free(rendered.pixels);
+}
+
+
+// Draws the shaped glyphs with the line origin at (x, baseline) in one of the
+// kHeadlessLine styles.  Emboldened glyphs have their outlines offset (the
+// replacement for stroking with kCGTextFillStroke); stroked glyphs are filled and
+// then stroked, the way kCGTextFillStroke draws them; boldface glyphs are struck
+// twice one pixel apart, the way kATSUQDBoldfaceTag looks on a non-antialiased screen.
+//
+static void DrawLine(RasterBuffer *buffer, const HeadlessParams *params, const HeadlessLayout *layout,
+                     GlyphOutline *outline, RasterPath *glyphPath,
+                     float x, float baseline, int antialias, int style)
+{
+    float           scale = params->pointSize / params->font->unitsPerEm;
+    float           lineWidth = params->strokeThicknessFactor * params->pointSize;
+    size_t          i;
+
+    for (i = 0; i < layout->numRecords; i++) {
+        const HeadlessGlyphRecord   *record = &layout->records[i];
+
+        if (params->glyphCache != NULL && style != kHeadlessLineStroked) {
+            DrawCachedGlyph(buffer, params, record->glyphID, outline, glyphPath, x + record->x, baseline,
+                            antialias, style == kHeadlessLineEmboldened);
+            if (style == kHeadlessLineBoldface)
+                DrawCachedGlyph(buffer, params, record->glyphID, outline, glyphPath, x + record->x + 1, baseline,
+                                antialias, 0);
+            continue;
+        }
+
+        GlyphOutlineReset(outline);
+        if (FontFileGetGlyphOutline(params->font, record->glyphID, scale, outline) != 0) continue;
+
+        if (style == kHeadlessLineEmboldened)
+            GlyphOutlineEmbolden(outline, lineWidth / 2);
+
+        RasterPathReset(glyphPath);
+        GlyphOutlineFlatten(outline, 0, 0, glyphPath);
+        RasterFillPath(buffer, glyphPath, x + record->x, baseline, antialias);
+        if (style == kHeadlessLineBoldface)
+            RasterFillPath(buffer, glyphPath, x + record->x + 1, baseline, antialias);
+        else if (style == kHeadlessLineStroked)
+            RasterStrokePath(buffer, glyphPath, x + record->x, baseline, lineWidth, antialias);
+    }
+}
+
+
+// Draws one line of shaped text on its own, for timing the stages of
+// HeadlessDrawComparison() separately.  Returns zero on success.
+//
+int HeadlessDrawLine(RasterBuffer *buffer, const HeadlessParams *params, const HeadlessLayout *layout,
+                     float x, float baseline, int style)
+{
+    GlyphOutline    outline;
+    RasterPath      glyphPath;
+
+    if (params->font == NULL || params->font->unitsPerEm == 0) return -1;
+
+    GlyphOutlineInit(&outline);
+    RasterPathInit(&glyphPath);
+    DrawLine(buffer, params, layout, &outline, &glyphPath, x, baseline, HeadlessIsAntiAliased(params) || params->printing, style);
+    GlyphOutlineDispose(&outline);
+    RasterPathDispose(&glyphPath);
+    return 0;
+}
+
+
+// Draws both boxes in kHeadlessEmboldenDilate mode.  The regular line is rendered
+// once into a mask just tall enough for it; the bold line is that mask dilated,
+// placed at the second baseline.  The font is not touched for the bold box.
+//
+static int DrawDilatedComparison(RasterBuffer *buffer, const HeadlessParams *params, const HeadlessLayout *layout,
+                                 GlyphOutline *outline, RasterPath *glyphPath,
+                                 float x, float baseline1, float baseline2)
+{
+    float           scale = params->pointSize / params->font->unitsPerEm;
+    float           radius = DilateRadiusForStroke(params->strokeThicknessFactor, params->pointSize);
+    float           ascent = params->font->ascender * scale, descent = -params->font->descender * scale;
+    int             margin = (int) ceilf(radius) + 1;
+    int             maskTop = (int) floorf(baseline1 - ascent) - margin;
+    RasterBuffer    mask, boldMask;
+    int             result;
+
+    result = RasterBufferCreate(&mask, buffer->width, (int) ceilf(ascent + descent) + 2 * margin + 1);
+    if (result != 0) return result;
+    result = RasterBufferCreate(&boldMask, mask.width, mask.height);
+    if (result != 0) {
+        RasterBufferDispose(&mask);
+        return result;
+    }
+
+    DrawLine(&mask, params, layout, outline, glyphPath, x, baseline1 - maskTop, 1, kHeadlessLineRegular);
+    RasterCompositeBuffer(buffer, &mask, 0, maskTop);
+
+    result = DilateMask(mask.pixels, mask.rowBytes, boldMask.pixels, boldMask.rowBytes, mask.width, mask.height, radius);
+    if (result == 0)
+        RasterCompositeBuffer(buffer, &boldMask, 0, maskTop + (int) floorf(baseline2 - baseline1 + 0.5f));
+
+    RasterBufferDispose(&boldMask);
+    RasterBufferDispose(&mask);
+    return result;
+}
+
+
+// Draws the regular and synthetic bold boxes into the buffer.  The geometry is
+// identical to DrawATSUIStuff(); only the Y axis is flipped because the buffer's
+// origin is at the top left.  The shaping results are kept in 'layout' for the
+// next call; pass NULL to shape from scratch.  Returns zero on success.
+//
+int HeadlessDrawComparison(RasterBuffer *buffer, const HeadlessParams *params, HeadlessLayout *layout)
+{
+    float           windowHeight = buffer->height, windowWidth = buffer->width;
+    float           box1Y, box1Height, box2Y, box2Height;
+    float           x;
+    int             antialias, needToUseCGStrokeMethod, result;
+    HeadlessLayout  temporaryLayout;
+    GlyphOutline    outline;
+    RasterPath      glyphPath;
+
+    if (params->font == NULL || params->font->unitsPerEm == 0) return -1;
+
+    // Set up the boxes, in Quartz coordinates, exactly as DrawATSUIStuff() does
+    box1Y = (windowHeight / 4.0f) * 2.0f;
+    box1Height = windowHeight - (windowHeight / 4.0f);
+    box2Y = windowHeight / 4.0f;
+    box2Height = windowHeight - ((windowHeight / 4.0f) * 2.0f);
+
+    RasterStrokeRect(buffer, 0, windowHeight - (box1Y + box1Height), windowWidth, box1Height, 1.0f);
+    RasterStrokeRect(buffer, 0, windowHeight - (box2Y + box2Height), windowWidth, box2Height, 1.0f);
+
+    // Shape the text once; both boxes are drawn from the same glyphs
+    if (layout == NULL) {
+        HeadlessLayoutInit(&temporaryLayout);
+        layout = &temporaryLayout;
+    }
+    result = HeadlessShapeText(layout, params);
+    if (result != 0) goto Done;
+
+    // The text is centered within the width of the box
+    x = (windowWidth - layout->width) / 2.0f;
+
+    needToUseCGStrokeMethod = params->printing || HeadlessIsAntiAliased(params);
+    antialias = needToUseCGStrokeMethod;
+
+    GlyphOutlineInit(&outline);
+    RasterPathInit(&glyphPath);
+
+    if (needToUseCGStrokeMethod && params->emboldenMethod == kHeadlessEmboldenDilate) {
+        // Both boxes at once, the bold one made from the regular one's coverage
+        result = DrawDilatedComparison(buffer, params, layout, &outline, &glyphPath, x,
+                                       windowHeight - (box1Y + box1Height) / 2.0f, windowHeight - (box2Y + box2Height) / 2.0f);
+    }
+    else {
+        // Draw the text once without the extra bold
+        DrawLine(buffer, params, layout, &outline, &glyphPath, x, windowHeight - (box1Y + box1Height) / 2.0f, antialias, kHeadlessLineRegular);
+
+        // Draw the text again with the extra bold for comparison
+        DrawLine(buffer, params, layout, &outline, &glyphPath, x, windowHeight - (box2Y + box2Height) / 2.0f, antialias,
+                 needToUseCGStrokeMethod ? kHeadlessLineEmboldened : kHeadlessLineBoldface);
+    }
+
+    GlyphOutlineDispose(&outline);
+    RasterPathDispose(&glyphPath);
+
+Done:
+    if (layout == &temporaryLayout)
+        HeadlessLayoutDispose(&temporaryLayout);
+    return result;
+}
+
+
+// A clock for timing renders, in nanoseconds from an arbitrary starting point
+//
+unsigned long long HeadlessGetNanoseconds(void)
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec     now;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) == 0)
+        return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+    {
+        struct timeval  tv;
+
+        gettimeofday(&tv, NULL);
+        return (unsigned long long) tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+    }
+}
@@ -0,0 +1,136 @@
+/*
+
+File: headless.h
+
+Abstract: Header for the headless comparison renderer in SyntheticBoldDemo
+project.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_HEADLESS_H
+#define MY_HEADLESS_H
+
+// Portable version of DrawATSUIStuff().  It takes the same inputs as the
+// ATSUI drawing code and produces the same two-box comparison, but renders
+// into a RasterBuffer instead of a CGContext so it can run without a display.
+//
+// The portable files have no Carbon dependencies.  On Linux they build with:
+//
+//     cc -O2 -o sbrender sbrender.c headless.c fontfile.c outline.c raster.c dilate.c glyphcache.c -lm
+
+#include <stddef.h>
+
+#include "raster.h"
+#include "fontfile.h"
+#include "glyphcache.h"
+
+// How the bold box is emboldened when the text is antialiased
+//
+enum {
+    kHeadlessEmboldenOutline    = 0,            // Offset each glyph outline, like atsui.c
+    kHeadlessEmboldenDilate     = 1             // Dilate the regular box's coverage mask
+};
+
+// How one line of text is drawn by HeadlessDrawLine()
+//
+enum {
+    kHeadlessLineRegular        = 0,
+    kHeadlessLineEmboldened     = 1,            // Outlines offset by half the stroke width
+    kHeadlessLineStroked        = 2,            // Filled and stroked, like kCGTextFillStroke
+    kHeadlessLineBoldface       = 3             // Struck twice, like kATSUQDBoldfaceTag
+};
+
+// Everything DrawATSUIStuff() reads from globals, passed explicitly
+//
+typedef struct {
+    const FontFile          *font;
+    const unsigned short    *text;                      // UTF-16, like the UniChar text in atsui.c
+    size_t                  length;
+    float                   pointSize;
+    float                   strokeThicknessFactor;      // Same meaning as gStrokeThicknessFactor
+    int                     antiAliasingThreshold;      // AppleAntiAliasingThreshold, or -1 if not set
+    int                     printing;                   // Non-zero to draw as for print: antialiased, from outlines
+    int                     emboldenMethod;             // One of the kHeadlessEmbolden constants
+    GlyphCache              *glyphCache;                // Rendered glyphs to reuse, or NULL
+} HeadlessParams;
+
+// One shaped glyph; the portable counterpart of MyGlyphRecord in atsui.h
+//
+typedef struct {
+    unsigned int            glyphID;
+    float                   x;                          // Origin relative to the origin of the line
+} HeadlessGlyphRecord;
+
+// Shaping results.  They are reused until the text, font or size change, or until
+// HeadlessLayoutInvalidate() is called after editing the text in place.
+//
+typedef struct {
+    HeadlessGlyphRecord     *records;
+    size_t                  numRecords;
+    size_t                  capacity;
+    float                   width;                      // Advance width of the whole line, in pixels
+    int                     valid;
+    const FontFile          *font;                      // What the records were made from
+    const unsigned short    *text;
+    size_t                  length;
+    float                   pointSize;
+} HeadlessLayout;
+
+int HeadlessIsAntiAliased(const HeadlessParams *params);
+
+void HeadlessLayoutInit(HeadlessLayout *layout);
+void HeadlessLayoutInvalidate(HeadlessLayout *layout);
+void HeadlessLayoutDispose(HeadlessLayout *layout);
+int HeadlessShapeText(HeadlessLayout *layout, const HeadlessParams *params);
+
+int HeadlessDrawComparison(RasterBuffer *buffer, const HeadlessParams *params, HeadlessLayout *layout);
+int HeadlessDrawLine(RasterBuffer *buffer, const HeadlessParams *params, const HeadlessLayout *layout,
+                     float x, float baseline, int style);
+
+// Utilities for the command line tools
+size_t HeadlessDecodeUTF8(const char *s, unsigned short *out);
+unsigned long long HeadlessGetNanoseconds(void);
+
+#endif  /* MY_HEADLESS_H */
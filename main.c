@@ -54,6 +54,9 @@ Copyright 
 #include "print.h"
 #include "fontmenu.h"
 #include "atsui.h"
+#include "policy.h"
+#include "redraw.h"
+#include "trace.h"
 #include "main.h"
 
 
@@ -72,19 +75,45 @@ int main(int argc, char* argv[])
     ATSUFontID					font;
     OSStatus					err = noErr;
 
+    // "defaults write <bundle id> TracePhases -bool YES" times the phases of drawing,
+    // printing and event handling from launch on, for File > Save Trace to write out
+    if ( CFPreferencesGetAppBooleanValue(CFSTR("TracePhases"), kCFPreferencesCurrentApplication, NULL) )
+	{
+        TraceSetEnabled(true);
+        TraceSetThreadName("Main");
+    }
+
     // Set up the menubar and main window
     err = SetupMenuAndWindows();
     require_noerr( err, CantDoSetup );
+
+    // "defaults write <bundle id> DilateSyntheticBold -bool YES" switches to raster-space emboldening
+    if ( CFPreferencesGetAppBooleanValue(CFSTR("DilateSyntheticBold"), kCFPreferencesCurrentApplication, NULL) )
+        gEmboldenMethod = kEmboldenByDilation;
     
     // Create the ATSUI data and draw it for the first time
     //
-    verify_noerr( ATSUFindFontFromName(startingFontName, strlen(startingFontName), kFontFullName, kFontNoPlatform, kFontNoScript, kFontNoLanguage, &font) );
-    verify( FindAndSelectFont(font) );
+    font = FindFontByFullName(startingFontName);
     SetATSUIStuffFont(font);
     SetATSUIStuffFontSize(Long2Fix(startingFontSize));
+    SetUpRenderPolicy();
     SetUpATSUIStuff();
+
+    // A text file named on the command line replaces the sample string.  Launched from
+    // the Finder, the only argument is the process serial number.
+    if ( argc > 1 && strncmp(argv[1], "-psn", 4) != 0 )
+        verify_noerr( LoadATSUIStuffTextFile(argv[1]) );
+    SetUpRedrawScheduler();
 	HIViewSetNeedsDisplay( gView, true );
 
+    // Draw the first frame before the font menu is built, which takes a while with
+    // many fonts installed.  The fonts of its items are worked out in the background;
+    // the starting font is checked in the menu once they are.
+    HIViewRender( gView );
+    err = InstallFontMenu(kFontMenuID);
+    require_noerr( err, CantDoSetup );
+    verify( FindAndSelectFont(font) );
+
     // Call the event loop
     RunApplicationEventLoop();
 
@@ -123,10 +152,6 @@ OSStatus SetupMenuAndWindows(void)
     err = SetMenuBarFromNib(nibRef, CFSTR("MenuBar"));
     require_noerr( err, CantSetMenuBar );
 
-    // Install the font menu
-    err = InstallFontMenu(kFontMenuID);
-    require_noerr( err, CantCreateFontMenu );
-
     // Then create a window. "MainWindow" is the name of the window object. This name is set in 
     // InterfaceBuilder when the nib is created.
     err = CreateWindowFromNib(nibRef, CFSTR("MainWindow"), &gWindow);
@@ -140,6 +165,15 @@ OSStatus SetupMenuAndWindows(void)
     // We don't need the nib reference anymore.
     DisposeNibReference(nibRef);
 
+    // The phase timings can be saved from the File menu, below Print
+    if ( TraceIsEnabled() )
+	{
+        MenuRef					fileMenu;
+
+        if ( GetIndMenuWithCommandID(NULL, kHICommandPrint, 1, &fileMenu, NULL) == noErr )
+            verify_noerr( AppendMenuItemTextWithCFString(fileMenu, CFSTR("Save Trace"), 0, kSaveTraceCommand, NULL) );
+    }
+
     // The windows were created hidden, so show them.
     ShowWindow(gWindow);
     ShowWindow(dialog);
@@ -171,12 +205,53 @@ OSStatus SetupMenuAndWindows(void)
     verify_noerr( InitializePrinting() );
 
 CantCreateWindow:
-CantCreateFontMenu:
 CantSetMenuBar:
 CantGetNibRef:
         return err;
 }
 
+// Writes the phase timings recorded so far to SyntheticBoldDemo.trace.json in the
+// user's logs folder, where Console can find it.  Open it in chrome://tracing.
+//
+static void SaveTrace(void)
+{
+    FSRef						logsFolder;
+    char						path[1024];
+
+    if ( FSFindFolder(kUserDomain, kLogsFolderType, kCreateFolder, &logsFolder) != noErr
+        || FSRefMakePath(&logsFolder, (UInt8 *) path, sizeof(path)) != noErr )
+        return;
+    strlcat(path, "/SyntheticBoldDemo.trace.json", sizeof(path));
+
+    if ( TraceWriteChromeJSON(path) == 0 )
+        fprintf(stderr, "trace written to %s\n", path);
+    else
+        fprintf(stderr, "cannot write trace to %s\n", path);
+}
+
+
+// Sets the characters selected in the text field in the font or size inAttributes
+// has, named by inWhich.  The field's text is shown first, so the selection is in
+// the text the view shows.  Returns false if nothing is selected.
+//
+static Boolean SetSelectionStyle(const StyleAttributes *inAttributes, UInt32 inWhich)
+{
+    ControlEditTextSelectionRec	selection;
+    CFStringRef					editString;
+
+    if ( GetControlData(gStringInputControl, 0, kControlEditTextSelectionTag, sizeof(selection), &selection, NULL) != noErr
+        || selection.selEnd <= selection.selStart )
+        return false;
+    if ( GetControlData(gStringInputControl, 0, kControlEditTextCFStringTag, sizeof(CFStringRef), (void *)&editString, NULL) != noErr )
+        return false;
+
+    UpdateATSUIStuffString(editString);
+    CFRelease(editString);
+    SetATSUIStuffStyle(selection.selStart, selection.selEnd - selection.selStart, inAttributes, inWhich);
+    return true;
+}
+
+
 // Handles command and menu events
 //
 pascal OSStatus DoCommandEvent(EventHandlerCallRef nextHandler, EventRef theEvent, void *userData)
@@ -186,9 +261,13 @@ pascal OSStatus DoCommandEvent(EventHandlerCallRef nextHandler, EventRef theEven
     MenuRef						theMenu;
     MenuItemIndex				theItem;
     FMFont						font;
+    StyleAttributes				attributes;
     OSStatus					status = eventNotHandledErr;
     Boolean						needsRedrawing = false;
+    UInt32						changedBoxes = 0;
+    TraceScope					scope;
 
+    TraceBegin(&scope, "DoCommandEvent");
     
     // Get the HICommand from the event structure, then get the menu reference and item out of that
     verify_noerr( GetEventParameter(theEvent, kEventParamDirectObject, typeHICommand, NULL, sizeof(HICommand), NULL, &theCommand) );
@@ -198,12 +277,17 @@ pascal OSStatus DoCommandEvent(EventHandlerCallRef nextHandler, EventRef theEven
 
     if ( GetMenuID(theMenu) >= kFontMenuID )
 	{
-		// Handle font menu
+		// Handle font menu.  With characters selected in the text field, only they
+		// are set in the font.
         font = SelectAndGetFont(theMenu, theItem);
-        SetATSUIStuffFont(font);
-        UpdateATSUIStyle();
+        attributes.font = font;
+        if ( ! SetSelectionStyle(&attributes, kATSUIStuffStyleFont) )
+		{
+            SetATSUIStuffFont(font);
+            UpdateATSUIStyle();
+        }
 
-        needsRedrawing = true;
+        changedBoxes = kATSUIStuffBothBoxes;
         status = noErr;
     }
     else if ( (theCommandID >> 24) == 'Z' )
@@ -217,15 +301,19 @@ pascal OSStatus DoCommandEvent(EventHandlerCallRef nextHandler, EventRef theEven
         memcpy(string, &numericalBits, sizeof(UInt32));
         string[0] = '0';
         string[4] = 0x00;
-        SetATSUIStuffFontSize(Long2Fix(atoi(string)));
-        UpdateATSUIStyle();
+        attributes.size = Long2Fix(atoi(string));
+        if ( ! SetSelectionStyle(&attributes, kATSUIStuffStyleSize) )
+		{
+            SetATSUIStuffFontSize(attributes.size);
+            UpdateATSUIStyle();
+        }
 
         // Update the menu
         verify_noerr( SetMenuCommandMark(NULL, gCurrentFontSizeCommandID, kMenuNoMark) );
         verify_noerr( SetMenuCommandMark(NULL, theCommandID, kMenuCheckMark) );
         gCurrentFontSizeCommandID = theCommandID;
 
-        needsRedrawing = true;
+        changedBoxes = kATSUIStuffBothBoxes;
         status = noErr;
     }
     else switch (theCommandID)
@@ -249,11 +337,20 @@ pascal OSStatus DoCommandEvent(EventHandlerCallRef nextHandler, EventRef theEven
             status = noErr;
             needsRedrawing = true;
             break;
+        case kSaveTraceCommand:
+            SaveTrace();
+            status = noErr;
+            break;
     }
 
-    // Redraw if necessary
+    // Redraw if necessary.  A new font or size changes the text in both boxes but
+    // not the boxes themselves.  The redraw happens on the next display frame.
     if (needsRedrawing)
-		HIViewSetNeedsDisplay( gView, true );
+        ScheduleRedraw(kRedrawWholeView);
+    else if (changedBoxes != 0)
+        ScheduleRedraw(changedBoxes);
+
+    TraceEnd(&scope);
     return status;
 }
 
@@ -266,6 +363,11 @@ pascal OSStatus DoControlHitEvent(EventHandlerCallRef nextHandler, EventRef theE
     char						buffer[256];
     CFStringRef					valueString;
     CFStringRef					editString;
+    UInt32						changedBoxes;
+    OSStatus					status = eventNotHandledErr;
+    TraceScope					scope;
+
+    TraceBegin(&scope, "DoControlHitEvent");
     
     // Figure out which control this came from
     verify_noerr( GetEventParameter(theEvent, kEventParamDirectObject, typeControlRef, NULL, sizeof(ControlRef), NULL, &thisControl) );
@@ -282,10 +384,14 @@ pascal OSStatus DoControlHitEvent(EventHandlerCallRef nextHandler, EventRef theE
         CFRelease(valueString);
  		HIViewSetNeedsDisplay( gValueStringControl, true );
    
-        // Update the display
-		HIViewSetNeedsDisplay( gView, true );
+        // Update the display.  The stroke factor only changes the bold box, and only
+        // when it is emboldened.  While the slider is dragged this is merged with the
+        // other hits until the next frame.
+        changedBoxes = GetATSUIStuffStrokeFactorBoxes();
+        if (changedBoxes != 0)
+            ScheduleRedraw(changedBoxes);
         
-        return noErr;
+        status = noErr;
     }
     else if ( thisControl == gUpdateButtonControl )
 	{
@@ -295,11 +401,12 @@ pascal OSStatus DoControlHitEvent(EventHandlerCallRef nextHandler, EventRef theE
         CFRelease(editString);
 
         // Update the display
-		HIViewSetNeedsDisplay( gView, true );
+        ScheduleRedraw(kATSUIStuffBothBoxes);
 
-        return noErr;
+        status = noErr;
     }
 
     // other
-    return eventNotHandledErr;
+    TraceEnd(&scope);
+    return status;
 }
@@ -0,0 +1,357 @@
+/*
+
+File: outline.c
+
+Abstract: Glyph outlines with curves, and the outline-offset engine that
+computes synthetic bold contours for SyntheticBoldDemo project.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "outline.h"
+
+// Limits how far a vertex can move at a sharp corner, as a multiple of the
+// emboldening distance.  Without it a spike would grow without bound.
+//
+#define kEmboldenMiterLimit     4.0f
+
+
+void GlyphOutlineInit(GlyphOutline *outline)
+{
+    memset(outline, 0, sizeof(GlyphOutline));
+}
+
+
+// Removes all contours but keeps the storage for reuse
+//
+void GlyphOutlineReset(GlyphOutline *outline)
+{
+    outline->numPoints = 0;
+    outline->numContours = 0;
+    outline->contourOpen = 0;
+}
+
+
+void GlyphOutlineDispose(GlyphOutline *outline)
+{
+    free(outline->points);
+    free(outline->tags);
+    free(outline->contourEnds);
+    GlyphOutlineInit(outline);
+}
+
+
+static int ReservePoints(GlyphOutline *outline, int count)
+{
+    if (outline->pointCapacity < count) {
+        int             newCapacity = (outline->pointCapacity == 0) ? 64 : outline->pointCapacity;
+        RasterPoint     *newPoints;
+        unsigned char   *newTags;
+
+        while (newCapacity < count)
+            newCapacity *= 2;
+
+        newPoints = (RasterPoint *) realloc(outline->points, newCapacity * sizeof(RasterPoint));
+        if (newPoints == NULL) return 0;
+        outline->points = newPoints;
+
+        newTags = (unsigned char *) realloc(outline->tags, newCapacity);
+        if (newTags == NULL) return 0;
+        outline->tags = newTags;
+
+        outline->pointCapacity = newCapacity;
+    }
+    return 1;
+}
+
+
+static int ReserveContours(GlyphOutline *outline, int count)
+{
+    if (outline->contourCapacity < count) {
+        int     newCapacity = (outline->contourCapacity == 0) ? 8 : outline->contourCapacity;
+        int     *newEnds;
+
+        while (newCapacity < count)
+            newCapacity *= 2;
+
+        newEnds = (int *) realloc(outline->contourEnds, newCapacity * sizeof(int));
+        if (newEnds == NULL) return 0;
+        outline->contourEnds = newEnds;
+        outline->contourCapacity = newCapacity;
+    }
+    return 1;
+}
+
+
+// Copies an outline, reusing the destination's storage.  Returns zero on success.
+//
+int GlyphOutlineCopy(GlyphOutline *dest, const GlyphOutline *source)
+{
+    if ( ! ReservePoints(dest, source->numPoints) || ! ReserveContours(dest, source->numContours) )
+        return -1;
+
+    memcpy(dest->points, source->points, source->numPoints * sizeof(RasterPoint));
+    memcpy(dest->tags, source->tags, source->numPoints);
+    memcpy(dest->contourEnds, source->contourEnds, source->numContours * sizeof(int));
+    dest->numPoints = source->numPoints;
+    dest->numContours = source->numContours;
+    dest->contourOpen = 0;
+    return 0;
+}
+
+
+static void AddPoint(GlyphOutline *outline, float x, float y, unsigned char tag)
+{
+    if ( ! ReservePoints(outline, outline->numPoints + 1) ) return;
+
+    outline->points[outline->numPoints].x = x;
+    outline->points[outline->numPoints].y = y;
+    outline->tags[outline->numPoints] = tag;
+    outline->numPoints++;
+}
+
+
+static int CurrentContourStart(const GlyphOutline *outline)
+{
+    return (outline->numContours == 0) ? 0 : outline->contourEnds[outline->numContours - 1];
+}
+
+
+void GlyphOutlineMoveTo(GlyphOutline *outline, float x, float y)
+{
+    if (outline->contourOpen)
+        GlyphOutlineClose(outline);
+
+    AddPoint(outline, x, y, kGlyphOutlineOnCurve);
+    outline->contourOpen = 1;
+}
+
+
+void GlyphOutlineLineTo(GlyphOutline *outline, float x, float y)
+{
+    if ( ! outline->contourOpen ) return;
+    AddPoint(outline, x, y, kGlyphOutlineOnCurve);
+}
+
+
+void GlyphOutlineQuadTo(GlyphOutline *outline, float cx, float cy, float x, float y)
+{
+    if ( ! outline->contourOpen ) return;
+    AddPoint(outline, cx, cy, kGlyphOutlineQuadControl);
+    AddPoint(outline, x, y, kGlyphOutlineOnCurve);
+}
+
+
+void GlyphOutlineCubicTo(GlyphOutline *outline, float c1x, float c1y, float c2x, float c2y, float x, float y)
+{
+    if ( ! outline->contourOpen ) return;
+    AddPoint(outline, c1x, c1y, kGlyphOutlineCubicControl);
+    AddPoint(outline, c2x, c2y, kGlyphOutlineCubicControl);
+    AddPoint(outline, x, y, kGlyphOutlineOnCurve);
+}
+
+
+// Ends the current contour.  If the last point lands back on the first one it is
+// dropped, so any control points before it describe the closing curve.
+//
+void GlyphOutlineClose(GlyphOutline *outline)
+{
+    int         start = CurrentContourStart(outline);
+    int         last = outline->numPoints - 1;
+
+    if ( ! outline->contourOpen ) return;
+    outline->contourOpen = 0;
+
+    if (last > start && outline->tags[last] == kGlyphOutlineOnCurve
+        && outline->points[last].x == outline->points[start].x
+        && outline->points[last].y == outline->points[start].y)
+        outline->numPoints--;
+
+    if (outline->numPoints - start < 2 || ! ReserveContours(outline, outline->numContours + 1)) {
+        outline->numPoints = start;
+        return;
+    }
+    outline->contourEnds[outline->numContours++] = outline->numPoints;
+}
+
+
+// Twice the signed area of the polygon formed by a contour's points
+//
+static float ContourArea(const GlyphOutline *outline, int start, int end)
+{
+    float       area = 0;
+    int         i;
+
+    for (i = start; i < end; i++) {
+        const RasterPoint   *a = &outline->points[i];
+        const RasterPoint   *b = &outline->points[(i + 1 < end) ? i + 1 : start];
+        area += a->x * b->y - b->x * a->y;
+    }
+    return area;
+}
+
+
+// Unit vector from a to b.  Returns zero if the points coincide.
+//
+static int UnitVector(RasterPoint a, RasterPoint b, float *ux, float *uy)
+{
+    float       dx = b.x - a.x, dy = b.y - a.y;
+    float       length = sqrtf(dx * dx + dy * dy);
+
+    if (length < 1e-6f) return 0;
+    *ux = dx / length;
+    *uy = dy / length;
+    return 1;
+}
+
+
+// Grows the filled area of an outline by 'distance' on every side (or shrinks it
+// if negative).  Every point, including curve control points, is moved along the
+// bisector of the normals of its neighbouring segments.  Because the control
+// points move with the curve, curves stay curves and the result can be filled in
+// a single pass.  This gives the same weight as stroking the outline with a line
+// width of twice the distance, without the second rasterization.
+//
+void GlyphOutlineEmbolden(GlyphOutline *outline, float distance)
+{
+    RasterPoint     *shifted;
+    float           largestArea = 0, orientation;
+    int             c, i, start;
+
+    if (distance == 0 || outline->numPoints == 0) return;
+
+    // Font contours are oriented so that the filled area is always on the same side
+    // of the path.  The largest contour must be an outer one, so it tells us which.
+    start = 0;
+    for (c = 0; c < outline->numContours; c++) {
+        float   area = ContourArea(outline, start, outline->contourEnds[c]);
+        if (fabsf(area) > fabsf(largestArea))
+            largestArea = area;
+        start = outline->contourEnds[c];
+    }
+    if (largestArea == 0) return;
+    orientation = (largestArea > 0) ? 1.0f : -1.0f;
+
+    shifted = (RasterPoint *) malloc(outline->numPoints * sizeof(RasterPoint));
+    if (shifted == NULL) return;
+
+    start = 0;
+    for (c = 0; c < outline->numContours; c++) {
+        int     end = outline->contourEnds[c], count = end - start;
+
+        for (i = start; i < end; i++) {
+            RasterPoint     p = outline->points[i];
+            float           inX = 0, inY = 0, outX = 0, outY = 0;
+            float           n1x, n1y, n2x, n2y, q;
+            int             k, haveIn = 0, haveOut = 0;
+
+            // Find the nearest neighbours that do not coincide with this point
+            for (k = 1; k < count && ! haveIn; k++)
+                haveIn = UnitVector(outline->points[start + (i - start - k + count) % count], p, &inX, &inY);
+            for (k = 1; k < count && ! haveOut; k++)
+                haveOut = UnitVector(p, outline->points[start + (i - start + k) % count], &outX, &outY);
+
+            shifted[i] = p;
+            if ( ! haveIn || ! haveOut ) continue;
+
+            // Normals pointing away from the filled area
+            n1x = orientation * inY;
+            n1y = -orientation * inX;
+            n2x = orientation * outY;
+            n2y = -orientation * outX;
+
+            // Miter offset: the bisector scaled so both segments move by 'distance'
+            q = 1.0f + n1x * n2x + n1y * n2y;
+            if (q < 2.0f / (kEmboldenMiterLimit * kEmboldenMiterLimit))
+                q = 2.0f / (kEmboldenMiterLimit * kEmboldenMiterLimit);
+
+            shifted[i].x = p.x + distance * (n1x + n2x) / q;
+            shifted[i].y = p.y + distance * (n1y + n2y) / q;
+        }
+        start = end;
+    }
+
+    memcpy(outline->points, shifted, outline->numPoints * sizeof(RasterPoint));
+    free(shifted);
+}
+
+
+// Appends the outline to a path, offset by (dx, dy), flattening the curves
+//
+void GlyphOutlineFlatten(const GlyphOutline *outline, float dx, float dy, RasterPath *path)
+{
+    int         c, i, start = 0;
+
+    for (c = 0; c < outline->numContours; c++) {
+        int                 end = outline->contourEnds[c];
+        const RasterPoint   *p = outline->points;
+        const RasterPoint   *first = &p[start];
+
+        RasterPathMoveTo(path, first->x + dx, first->y + dy);
+
+        for (i = start + 1; i < end; ) {
+            if (outline->tags[i] == kGlyphOutlineQuadControl) {
+                const RasterPoint   *to = (i + 1 < end) ? &p[i + 1] : first;
+                RasterPathQuadTo(path, p[i].x + dx, p[i].y + dy, to->x + dx, to->y + dy);
+                i += 2;
+            }
+            else if (outline->tags[i] == kGlyphOutlineCubicControl && i + 1 < end) {
+                const RasterPoint   *to = (i + 2 < end) ? &p[i + 2] : first;
+                RasterPathCubicTo(path, p[i].x + dx, p[i].y + dy, p[i + 1].x + dx, p[i + 1].y + dy, to->x + dx, to->y + dy);
+                i += 3;
+            }
+            else {
+                RasterPathLineTo(path, p[i].x + dx, p[i].y + dy);
+                i++;
+            }
+        }
+
+        RasterPathClose(path);
+        start = end;
+    }
+}
@@ -0,0 +1,96 @@
+/*
+
+File: outline.h
+
+Abstract: Header for the glyph outline and synthetic emboldening code in
+SyntheticBoldDemo project.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_OUTLINE_H
+#define MY_OUTLINE_H
+
+// Glyph outlines that keep their curves, and the synthetic emboldening engine
+// that works on them.  Plain C with no Carbon dependencies, like raster.h.
+
+#include "raster.h"
+
+// Point tags.  Every contour starts with an on-curve point.  Control points
+// refer to the next on-curve point, or to the first point of the contour if
+// they come at the end of it.
+//
+enum {
+    kGlyphOutlineOnCurve            = 0,
+    kGlyphOutlineQuadControl        = 1,
+    kGlyphOutlineCubicControl       = 2
+};
+
+typedef struct {
+    RasterPoint         *points;
+    unsigned char       *tags;              // One of the tags above for each point
+    int                 numPoints;
+    int                 pointCapacity;
+    int                 *contourEnds;       // Index one past the last point of each contour
+    int                 numContours;
+    int                 contourCapacity;
+    int                 contourOpen;        // Non-zero while a contour is being built
+} GlyphOutline;
+
+
+void GlyphOutlineInit(GlyphOutline *outline);
+void GlyphOutlineReset(GlyphOutline *outline);
+void GlyphOutlineDispose(GlyphOutline *outline);
+int GlyphOutlineCopy(GlyphOutline *dest, const GlyphOutline *source);
+
+void GlyphOutlineMoveTo(GlyphOutline *outline, float x, float y);
+void GlyphOutlineLineTo(GlyphOutline *outline, float x, float y);
+void GlyphOutlineQuadTo(GlyphOutline *outline, float cx, float cy, float x, float y);
+void GlyphOutlineCubicTo(GlyphOutline *outline, float c1x, float c1y, float c2x, float c2y, float x, float y);
+void GlyphOutlineClose(GlyphOutline *outline);
+
+void GlyphOutlineEmbolden(GlyphOutline *outline, float distance);
+void GlyphOutlineFlatten(const GlyphOutline *outline, float dx, float dy, RasterPath *path);
+
+#endif  /* MY_OUTLINE_H */
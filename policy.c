@@ -0,0 +1,163 @@
+/*
+
+File: policy.c
+
+Abstract: Snapshots the antialiasing preferences and caches per-size render
+decisions for SyntheticBoldDemo project
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include "globals.h"
+#include "policy.h"
+#include "redraw.h"
+
+// The sizes in the Size menu.  Their policies are worked out ahead of time.
+//
+static const int			kMenuSizes[] = { 8, 9, 10, 11, 12, 13, 14, 16, 18, 24, 36, 48, 64, 72, 80, 84, 90, 96, 100, 110, 120, 140, 160, 180, 200 };
+#define kNumMenuSizes		(sizeof(kMenuSizes) / sizeof(kMenuSizes[0]))
+#define kMaxTableSize		200
+
+// Posted by the Appearance preferences when the font smoothing settings change
+//
+#define kAntiAliasingChangedNotification	CFSTR("AppleAquaAntiAliasingChanged")
+
+// Globals for just this source module
+//
+static CFIndex				gAntiAliasingThreshold = -1;	// AppleAntiAliasingThreshold, or -1 if not set
+static MyRenderPolicy		gPolicyTable[kMaxTableSize + 1];
+static Boolean				gPolicyTableValid[kMaxTableSize + 1];
+static Boolean				gObservingChanges = false;
+
+
+// Works out the policy for a size from the snapshot of the preferences
+//
+static void ComputeRenderPolicy(float iSize, MyRenderPolicy *outPolicy)
+{
+    // 'gAntiAliasingThreshold' is the maximum not-antialiasing size
+    outPolicy->antiAliased = (gAntiAliasingThreshold < 0) || (iSize > gAntiAliasingThreshold);
+
+    // Without antialiasing a fractional stroke is lost in the pixel grid, so the
+    // kATSUQDBoldfaceTag look is used instead
+    outPolicy->useStrokeMethod = outPolicy->antiAliased;
+}
+
+
+// Fills in the table for the sizes in the Size menu
+//
+static void BuildPolicyTable(void)
+{
+    UInt32					i;
+
+    memset(gPolicyTableValid, 0, sizeof(gPolicyTableValid));
+    for (i = 0; i < kNumMenuSizes; i++) {
+        ComputeRenderPolicy(kMenuSizes[i], &gPolicyTable[kMenuSizes[i]]);
+        gPolicyTableValid[kMenuSizes[i]] = true;
+    }
+}
+
+
+// Called when the font smoothing settings change
+//
+static void MyAntiAliasingChanged(CFNotificationCenterRef center, void *observer, CFStringRef name, const void *object, CFDictionaryRef userInfo)
+{
+    RefreshRenderPolicy();
+    ScheduleRedraw(kRedrawWholeView);
+}
+
+
+// Reads the preferences again and rebuilds the table
+//
+void RefreshRenderPolicy(void)
+{
+    Boolean					keyExistsAndHasValidFormat;
+    CFIndex					value;
+
+    CFPreferencesAppSynchronize(kCFPreferencesCurrentApplication);
+    value = CFPreferencesGetAppIntegerValue(CFSTR("AppleAntiAliasingThreshold"), kCFPreferencesCurrentApplication, &keyExistsAndHasValidFormat);
+    gAntiAliasingThreshold = keyExistsAndHasValidFormat ? value : -1;
+
+    BuildPolicyTable();
+}
+
+
+// Takes the first snapshot of the preferences and starts listening for changes
+//
+void SetUpRenderPolicy(void)
+{
+    RefreshRenderPolicy();
+
+    if ( ! gObservingChanges )
+	{
+        CFNotificationCenterAddObserver(CFNotificationCenterGetDistributedCenter(), &gPolicyTable, MyAntiAliasingChanged,
+                                        kAntiAliasingChangedNotification, NULL, CFNotificationSuspensionBehaviorDeliverImmediately);
+        gObservingChanges = true;
+    }
+}
+
+
+// Returns how text at the given size should be drawn on screen.  This never touches
+// the preferences; sizes from the Size menu are a table lookup.
+//
+// Note that iSize is of type Fixed!
+//
+void GetRenderPolicy(Fixed iSize, MyRenderPolicy *outPolicy)
+{
+    SInt32					whole = Fix2Long(iSize);
+
+    if (Long2Fix(whole) == iSize && whole >= 0 && whole <= kMaxTableSize && gPolicyTableValid[whole])
+        *outPolicy = gPolicyTable[whole];
+    else
+        ComputeRenderPolicy(Fix2X(iSize), outPolicy);
+}
+
+
+void DisposeRenderPolicy(void)
+{
+    if ( gObservingChanges )
+	{
+        CFNotificationCenterRemoveObserver(CFNotificationCenterGetDistributedCenter(), &gPolicyTable, kAntiAliasingChangedNotification, NULL);
+        gObservingChanges = false;
+    }
+}
@@ -52,6 +52,8 @@ Copyright 
 #include "globals.h"
 #include "atsui.h"
 #include "print.h"
+#include "taskpool.h"
+#include "trace.h"
 
 // Globals (for this source file only)
 //
@@ -60,6 +62,41 @@ static  PMPageFormat            gPageFormat = kPMNoPageFormat;
 static  PMPrintSettings         gPrintSettings = kPMNoPrintSettings;
 static  PMPrintSession          gPrintSession;
 
+// How the text falls on the page.  Filled in by DetermineNumberOfPagesInDoc();
+// the line breaks themselves are kept by BreakATSUIStuffIntoLines().
+//
+typedef struct {
+    float                       pageWidth;
+    float                       pageHeight;
+    ItemCount                   numLines;
+    ItemCount                   linesPerPage;
+    UInt32                      numPages;
+} MyPagination;
+
+static  MyPagination            gPagination = { 0, 0, 0, 1, 1 };
+
+// A page recorded on a worker thread ahead of the print loop, which only has to
+// play it back.  'recorded' is protected by gPagesLock.
+//
+typedef struct {
+    MyDisplayList               list;
+    CGRect                      bounds;
+    ItemCount                   firstLine;
+    MyLineGlyphs                lines;              // Until the page is recorded
+    Boolean                     recorded;
+} MyRecordedPage;
+
+//  What RecordPage is passed as its worker when the print loop records a page
+//  itself, on the main thread.
+#define kNotOnPoolWorker        -1
+
+//  Pages are laid out at most this many pages ahead of the one being printed, so
+//  the glyphs of a long text file are never all in memory at once.
+#define kPagesAhead             16
+
+static  pthread_mutex_t         gPagesLock = PTHREAD_MUTEX_INITIALIZER;
+static  pthread_cond_t          gPageRecorded = PTHREAD_COND_INITIALIZER;
+
 /*------------------------------------------------------------------------------
 
     Function:   InitializePrinting
@@ -225,6 +262,95 @@ OSStatus DoPrintDialog(void)
 }   //  DoPrintDialog
 
 
+/*------------------------------------------------------------------------------
+    Function:   RecordPage
+    
+    Parameters:
+        arg     -   the MyRecordedPage to record
+        worker  -   index of the worker thread, or kNotOnPoolWorker
+    
+    Description:
+        Task run on the print task pool.  Lays out the page's lines into its
+        display list, frees their glyphs and wakes up the print loop if it is
+        waiting for it.
+        
+------------------------------------------------------------------------------*/
+static void RecordPage(void *arg, int worker)
+{
+    MyRecordedPage  *page = (MyRecordedPage *) arg;
+    TraceScope      scope;
+
+    //  Only the pool's threads are print workers; the print loop's stays "Main".
+    if (worker != kNotOnPoolWorker) {
+        TraceSetThreadName("Print worker");
+    }
+    TraceBegin(&scope, "RecordPage");
+    RecordATSUIStuffLines(&page->list, page->bounds, &page->lines);
+    DisposeATSUIStuffLines(&page->lines);
+    TraceEnd(&scope);
+
+    pthread_mutex_lock(&gPagesLock);
+    page->recorded = true;
+    pthread_cond_broadcast(&gPageRecorded);
+    pthread_mutex_unlock(&gPagesLock);
+}   //  RecordPage
+
+
+
+/*------------------------------------------------------------------------------
+    Function:   WaitForPage
+    
+    Parameters:
+        page    -   a page submitted to the print task pool
+    
+    Description:
+        Blocks until the page's display list has been recorded.  Pages are
+        submitted in order, so this rarely waits for more than one page.
+        
+------------------------------------------------------------------------------*/
+static void WaitForPage(MyRecordedPage *page)
+{
+    pthread_mutex_lock(&gPagesLock);
+    while ( ! page->recorded ) {
+        pthread_cond_wait(&gPageRecorded, &gPagesLock);
+    }
+    pthread_mutex_unlock(&gPagesLock);
+}   //  WaitForPage
+
+
+
+/*------------------------------------------------------------------------------
+    Function:   StartPage
+    
+    Parameters:
+        page    -   a page to be printed
+        pool    -   the print task pool, or NULL if there are no threads
+    
+    Description:
+        Gets the glyphs of the page's lines ready and their emboldened outlines
+        made, on this thread, then has the page recorded on the pool.  Without
+        a pool the page is left for the print loop to record.
+        
+------------------------------------------------------------------------------*/
+static OSStatus StartPage(MyRecordedPage *page, TaskPool *pool)
+{
+    OSStatus        status;
+    TraceScope      scope;
+
+    TraceBegin(&scope, "DoPrintLoop: prepare page");
+    status = PrepareATSUIStuffLines(page->firstLine, gPagination.linesPerPage, &page->lines);
+    TraceEnd(&scope);
+
+    if (status == noErr && pool != NULL) {
+        if (TaskPoolSubmit(pool, RecordPage, page) != 0) {
+            RecordPage(page, kNotOnPoolWorker);
+        }
+    }
+    return status;
+}   //  StartPage
+
+
+
 /*------------------------------------------------------------------------------
     Function:
         DoPrintLoop
@@ -235,8 +361,11 @@ OSStatus DoPrintDialog(void)
         printSettings   -   a PrintSettings object addr
     
     Description:
-        DoPrintLoop calculates which pages to print and executes the print
-        loop, calling DrawPage for each page.
+        DoPrintLoop calculates which pages to print, has the pages recorded
+        into display lists on a pool of worker threads, and executes the print
+        loop, playing each page's display list back in order as it becomes
+        ready.  The layout work is done while earlier pages are spooling, up to
+        kPagesAhead pages ahead.
                 
 ------------------------------------------------------------------------------*/
 void DoPrintLoop(void)
@@ -250,7 +379,13 @@ void DoPrintLoop(void)
 					lastPage;
     CFStringRef		jobName = CFSTR("ATSUITestApp");
 	CGContextRef	printingContext = NULL;
-	PMRect			pageRect;
+	MyRecordedPage	*pages = NULL;
+	UInt32			numPages = 0, numStarted = 0, i;
+	TaskPool		pool;
+	Boolean			haveThreads = false;
+	TraceScope		loopScope, phaseScope;
+
+    TraceBegin(&loopScope, "DoPrintLoop");
 
     //  Since this sample code doesn't have a window, give the spool file a name.
     status = PMPrintSettingsSetJobName(gPrintSettings, jobName);
@@ -266,7 +401,9 @@ void DoPrintLoop(void)
     //  Check that the selected page range does not exceed the actual number of
     //  pages in the document.
     if (status == noErr) {
+        TraceBegin(&phaseScope, "DoPrintLoop: paginate");
         status = DetermineNumberOfPagesInDoc(gPageFormat, &realNumberOfPagesinDoc);
+        TraceEnd(&phaseScope);
         if (realNumberOfPagesinDoc < lastPage) {
             lastPage = realNumberOfPagesinDoc;
         }
@@ -284,6 +421,25 @@ void DoPrintLoop(void)
         status = PMSetLastPage(gPrintSettings, lastPage, false);
     }
 
+    //  Set up the pages.  The line breaks were worked out above by
+    //  DetermineNumberOfPagesInDoc; the pages are started in the print loop.
+    //  If no threads can be started, each page is recorded in the print loop instead.
+    if (status == noErr && firstPage <= lastPage) {
+        numPages = lastPage - firstPage + 1;
+        pages = (MyRecordedPage *) calloc(numPages, sizeof(MyRecordedPage));
+        if (pages == NULL) {
+            status = memFullErr;
+        }
+    }
+    if (pages != NULL) {
+        haveThreads = (TaskPoolCreate(&pool, TaskPoolDefaultThreadCount()) == 0);
+        for (i = 0; i < numPages; i++) {
+            DisplayListInit(&pages[i].list);
+            pages[i].bounds = CGRectMake(0, 0, gPagination.pageWidth, gPagination.pageHeight);
+            pages[i].firstLine = (firstPage + i - 1) * gPagination.linesPerPage;
+        }
+    }
+
     //  Note, we don't have to worry about the number of copies.  The printing
     //  manager handles this.  So we just iterate through the document from the
     //  first page to be printed, to the last.
@@ -297,6 +453,19 @@ void DoPrintLoop(void)
                 //  Note, we don't have to deal with the classic Printing Manager's
                 //  128-page boundary limit.
             
+                //  Start the pages up to kPagesAhead past this one, or just this one
+                //  if it is recorded here.
+                while (numStarted < numPages && numStarted <= pageNumber - firstPage + (haveThreads ? kPagesAhead : 0)) {
+                    status = StartPage(&pages[numStarted++], haveThreads ? &pool : NULL);
+                    if (status != noErr) {
+                        PMSessionSetError(gPrintSession, status);
+                        break;
+                    }
+                }
+                if (status != noErr) {
+                    break;
+                }
+            
                 //  Set up a page for printing.  Under the classic Printing Manager, applications
                 //  could provide a page rect different from the one in the print record to achieve
                 //  scaling. This is no longer recommended and on Mac OS X, the PageRect argument
@@ -310,20 +479,31 @@ void DoPrintLoop(void)
                 //  for drawing the page.
                 status = PMSessionGetCGGraphicsContext(gPrintSession, &printingContext);
                 if (status == noErr) {
-					CGRect		cgPageBounds;
+					MyRecordedPage	*page = &pages[pageNumber - firstPage];
 					
-                    //  Set the printing port before drawing the page.
-					status = PMGetUnadjustedPageRect(gPageFormat, &pageRect);
-					cgPageBounds = CGRectMake(0, 0, pageRect.right - pageRect.left, pageRect.bottom - pageRect.top);
-					
-                    //  Draw the page.
-                    gCurrentlyPrinting = true;
-                    DrawATSUIStuff(printingContext, cgPageBounds);
-	                gCurrentlyPrinting = false;
+                    //  Wait for the page's display list, then draw it.  The context's
+                    //  origin is at the corner of the imageable area, which is the rect
+                    //  the text was paginated against.
+                    if (haveThreads) {
+                        TraceBegin(&phaseScope, "DoPrintLoop: wait for page");
+                        WaitForPage(page);
+                        TraceEnd(&phaseScope);
+                    }
+                    else {
+                        RecordPage(page, kNotOnPoolWorker);
+                    }
+                    TraceBegin(&phaseScope, "DoPrintLoop: replay page");
+                    DisplayListReplay(&page->list, printingContext);
+                    TraceEnd(&phaseScope);
+                    
+                    //  The page will not be needed again.
+                    DisplayListDispose(&page->list);
                 }
             
                 //  Close the page.
+                TraceBegin(&phaseScope, "DoPrintLoop: end page");
                 status = PMSessionEndPage(gPrintSession);
+                TraceEnd(&phaseScope);
                 if (status != noErr) {
                     break;
                 }
@@ -336,6 +516,17 @@ void DoPrintLoop(void)
             (void)PMSessionEndDocument(gPrintSession);
         }
     }
+
+    //  If the loop stopped early, pages may still be being recorded.
+    if (haveThreads) {
+        TaskPoolWait(&pool);
+        TaskPoolDispose(&pool);
+    }
+    for (i = 0; i < numPages; i++) {
+        DisplayListDispose(&pages[i].list);
+        DisposeATSUIStuffLines(&pages[i].lines);
+    }
+    free(pages);
         
     //  Only report a printing error once we have completed the print loop. This
     //  ensures that every PMBeginXXX call is followed by a matching PMEndXXX
@@ -345,7 +536,8 @@ void DoPrintLoop(void)
     if (printError != noErr && printError != kPMCancel) {
         PostPrintingErrors(printError);
     }
-        
+
+    TraceEnd(&loopScope);
 }   //  DoPrintLoop
 
 
@@ -418,21 +610,39 @@ OSStatus    LoadAndUnflattenPageFormat(PMPageFormat* pageFormat)
             
     Description:
         Calculates the number of pages needed to print the entire document.
+        The text is broken into lines at the width of the page, and as many
+        lines as fit are put on each page.  The line breaks are only worked
+        out again when the text, the style or the page width have changed.
         
 ------------------------------------------------------------------------------*/
 OSStatus    DetermineNumberOfPagesInDoc(PMPageFormat pageFormat, UInt32* numPages)
 {
     OSStatus    status;
     PMRect      pageRect;
+    float       lineHeight;
 
     //  PMGetAdjustedPageRect returns the page size taking into account rotation,
     //  resolution and scaling settings.
     status = PMGetAdjustedPageRect(pageFormat, &pageRect);
 
-    //  In this sample code we simply return a hard coded number.  In your application,
-    //  you will need to figure out how many page rects are needed to image the
-    //  current document.
-    *numPages = 1;
+    if (status == noErr) {
+        gPagination.pageWidth = pageRect.right - pageRect.left;
+        gPagination.pageHeight = pageRect.bottom - pageRect.top;
+        status = BreakATSUIStuffIntoLines(gPagination.pageWidth, &gPagination.numLines, &lineHeight);
+    }
+
+    if (status == noErr) {
+        //  Always put at least one line on a page, even if it does not fit.
+        gPagination.linesPerPage = (lineHeight > 0) ? (ItemCount) (gPagination.pageHeight / lineHeight) : 1;
+        if (gPagination.linesPerPage < 1) {
+            gPagination.linesPerPage = 1;
+        }
+        gPagination.numPages = (gPagination.numLines + gPagination.linesPerPage - 1) / gPagination.linesPerPage;
+        if (gPagination.numPages < 1) {
+            gPagination.numPages = 1;
+        }
+    }
+    *numPages = gPagination.numPages;
 
     return status;
     
@@ -0,0 +1,617 @@
+/*
+
+File: raster.c
+
+Abstract: Portable path flattening, filling and stroking into 8-bit coverage
+buffers for SyntheticBoldDemo project. Has no Carbon dependencies.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "raster.h"
+
+// Maximum distance, in pixels, between a curve and the line segments used to approximate it
+//
+#define kRasterFlatness         0.2f
+
+
+// - = - Paths - = -
+
+// Initializes an empty path
+//
+void RasterPathInit(RasterPath *path)
+{
+    memset(path, 0, sizeof(RasterPath));
+}
+
+
+// Removes all contours from a path but keeps its storage for reuse
+//
+void RasterPathReset(RasterPath *path)
+{
+    path->numPoints = 0;
+    path->numContours = 0;
+    path->contourOpen = 0;
+    path->current.x = path->current.y = 0;
+}
+
+
+// Frees the storage owned by a path
+//
+void RasterPathDispose(RasterPath *path)
+{
+    free(path->points);
+    free(path->contourEnds);
+    RasterPathInit(path);
+}
+
+
+// Appends a vertex to the contour that is being built
+//
+static void AddPoint(RasterPath *path, float x, float y)
+{
+    if (path->numPoints == path->pointCapacity) {
+        int             newCapacity = (path->pointCapacity == 0) ? 64 : path->pointCapacity * 2;
+        RasterPoint     *newPoints = (RasterPoint *) realloc(path->points, newCapacity * sizeof(RasterPoint));
+
+        if (newPoints == NULL) return;
+        path->points = newPoints;
+        path->pointCapacity = newCapacity;
+    }
+    path->points[path->numPoints].x = x;
+    path->points[path->numPoints].y = y;
+    path->numPoints++;
+}
+
+
+// Returns the index of the first vertex of the contour that is being built
+//
+static int CurrentContourStart(const RasterPath *path)
+{
+    return (path->numContours == 0) ? 0 : path->contourEnds[path->numContours - 1];
+}
+
+
+void RasterPathMoveTo(RasterPath *path, float x, float y)
+{
+    if (path->contourOpen)
+        RasterPathClose(path);
+
+    AddPoint(path, x, y);
+    path->contourOpen = 1;
+    path->current.x = x;
+    path->current.y = y;
+}
+
+
+void RasterPathLineTo(RasterPath *path, float x, float y)
+{
+    if ( ! path->contourOpen )
+        RasterPathMoveTo(path, path->current.x, path->current.y);
+
+    // Filter out degenerate segments
+    if (x != path->current.x || y != path->current.y)
+        AddPoint(path, x, y);
+
+    path->current.x = x;
+    path->current.y = y;
+}
+
+
+// Quadratic curves are flattened into evenly spaced line segments.  The number of
+// segments is chosen so that the error stays under kRasterFlatness.
+//
+void RasterPathQuadTo(RasterPath *path, float cx, float cy, float x, float y)
+{
+    float       x0 = path->current.x, y0 = path->current.y;
+    float       ddx = x0 - 2 * cx + x, ddy = y0 - 2 * cy + y;
+    float       dd = sqrtf(ddx * ddx + ddy * ddy);
+    int         n = (int) ceilf(sqrtf(dd / (8 * kRasterFlatness)));
+    int         i;
+
+    if (n > 1) {
+        for (i = 1; i < n; i++) {
+            float   t = (float) i / n, mt = 1 - t;
+            RasterPathLineTo(path, mt * mt * x0 + 2 * mt * t * cx + t * t * x,
+                                   mt * mt * y0 + 2 * mt * t * cy + t * t * y);
+        }
+    }
+    RasterPathLineTo(path, x, y);
+}
+
+
+// Same as above, for cubic curves
+//
+void RasterPathCubicTo(RasterPath *path, float c1x, float c1y, float c2x, float c2y, float x, float y)
+{
+    float       x0 = path->current.x, y0 = path->current.y;
+    float       ax = x0 - 2 * c1x + c2x, ay = y0 - 2 * c1y + c2y;
+    float       bx = c1x - 2 * c2x + x, by = c1y - 2 * c2y + y;
+    float       dd = sqrtf(fmaxf(ax * ax + ay * ay, bx * bx + by * by));
+    int         n = (int) ceilf(sqrtf(3 * dd / (4 * kRasterFlatness)));
+    int         i;
+
+    if (n > 1) {
+        for (i = 1; i < n; i++) {
+            float   t = (float) i / n, mt = 1 - t;
+            float   a = mt * mt * mt, b = 3 * mt * mt * t, c = 3 * mt * t * t, d = t * t * t;
+            RasterPathLineTo(path, a * x0 + b * c1x + c * c2x + d * x,
+                                   a * y0 + b * c1y + c * c2y + d * y);
+        }
+    }
+    RasterPathLineTo(path, x, y);
+}
+
+
+// Ends the current contour.  Contours are always treated as closed, and ones that
+// do not enclose any area are dropped.
+//
+void RasterPathClose(RasterPath *path)
+{
+    int         start = CurrentContourStart(path);
+    RasterPoint *first;
+
+    if ( ! path->contourOpen ) return;
+    path->contourOpen = 0;
+
+    first = &path->points[start];
+    path->current = *first;
+
+    // The closing segment is implicit
+    if (path->numPoints - start > 1) {
+        RasterPoint *last = &path->points[path->numPoints - 1];
+        if (last->x == first->x && last->y == first->y)
+            path->numPoints--;
+    }
+
+    if (path->numPoints - start < 3) {
+        path->numPoints = start;
+        return;
+    }
+
+    if (path->numContours == path->contourCapacity) {
+        int     newCapacity = (path->contourCapacity == 0) ? 8 : path->contourCapacity * 2;
+        int     *newEnds = (int *) realloc(path->contourEnds, newCapacity * sizeof(int));
+
+        if (newEnds == NULL) {
+            path->numPoints = start;
+            return;
+        }
+        path->contourEnds = newEnds;
+        path->contourCapacity = newCapacity;
+    }
+    path->contourEnds[path->numContours++] = path->numPoints;
+}
+
+
+// Gets the bounding box of all closed contours.  Returns zero if the path is empty.
+//
+int RasterPathGetBounds(const RasterPath *path, float *minX, float *minY, float *maxX, float *maxY)
+{
+    int         i, end = CurrentContourStart(path);
+
+    if (end == 0) return 0;
+
+    *minX = *maxX = path->points[0].x;
+    *minY = *maxY = path->points[0].y;
+    for (i = 1; i < end; i++) {
+        if (path->points[i].x < *minX) *minX = path->points[i].x;
+        if (path->points[i].x > *maxX) *maxX = path->points[i].x;
+        if (path->points[i].y < *minY) *minY = path->points[i].y;
+        if (path->points[i].y > *maxY) *maxY = path->points[i].y;
+    }
+    return 1;
+}
+
+
+// - = - Coverage buffers - = -
+
+// Allocates a cleared buffer.  Returns zero on success.
+//
+int RasterBufferCreate(RasterBuffer *buffer, int width, int height)
+{
+    memset(buffer, 0, sizeof(RasterBuffer));
+    if (width <= 0 || height <= 0) return -1;
+
+    buffer->pixels = (unsigned char *) calloc((size_t) width * height, 1);
+    if (buffer->pixels == NULL) return -1;
+
+    buffer->width = width;
+    buffer->height = height;
+    buffer->rowBytes = width;
+    return 0;
+}
+
+
+void RasterBufferClear(RasterBuffer *buffer)
+{
+    memset(buffer->pixels, 0, (size_t) buffer->rowBytes * buffer->height);
+}
+
+
+void RasterBufferDispose(RasterBuffer *buffer)
+{
+    free(buffer->pixels);
+    free(buffer->scratch);
+    memset(buffer, 0, sizeof(RasterBuffer));
+}
+
+
+// Writes the buffer as a binary PGM file.  Coverage is inverted so the image
+// shows black text on a white background, like the window does.
+//
+int RasterBufferWritePGM(const RasterBuffer *buffer, const char *fileName)
+{
+    FILE            *file;
+    unsigned char   *row;
+    int             x, y, result = 0;
+
+    file = fopen(fileName, "wb");
+    if (file == NULL) return -1;
+
+    row = (unsigned char *) malloc(buffer->width);
+    if (row == NULL) {
+        fclose(file);
+        return -1;
+    }
+
+    fprintf(file, "P5\n%d %d\n255\n", buffer->width, buffer->height);
+    for (y = 0; y < buffer->height; y++) {
+        const unsigned char *src = buffer->pixels + (size_t) y * buffer->rowBytes;
+        for (x = 0; x < buffer->width; x++)
+            row[x] = 255 - src[x];
+        if (fwrite(row, 1, buffer->width, file) != (size_t) buffer->width)
+            result = -1;
+    }
+
+    free(row);
+    if (fclose(file) != 0) result = -1;
+    return result;
+}
+
+
+// Converts a coverage value in the range 0..1 to a pixel value
+//
+static unsigned char CoverageToPixel(float coverage, int antialias)
+{
+    if (coverage >= 1.0f) return 255;
+    if ( ! antialias ) return (coverage >= 0.5f) ? 255 : 0;
+    return (unsigned char) (coverage * 255.0f + 0.5f);
+}
+
+
+// - = - Filling - = -
+
+// Makes sure the buffer's scratch space can hold the given number of floats
+//
+static int EnsureScratch(RasterBuffer *buffer, size_t count)
+{
+    if (buffer->scratchCapacity < count) {
+        float   *newScratch = (float *) realloc(buffer->scratch, count * sizeof(float));
+
+        if (newScratch == NULL) return 0;
+        buffer->scratch = newScratch;
+        buffer->scratchCapacity = count;
+    }
+    return 1;
+}
+
+
+// Adds the signed area contribution of one edge to the accumulation buffer.
+// Each row holds the derivative of the coverage, which is integrated from left to
+// right once all edges have been added.  X is clamped to [0, width] per row, so
+// parts of a shape to the left of the buffer still contribute their winding.
+//
+static void AccumulateEdge(float *acc, int stride, int width, int height, RasterPoint p0, RasterPoint p1)
+{
+    float       dir, dxdy, x;
+    int         y, yStart, yEnd;
+
+    if (p0.y == p1.y) return;
+
+    if (p0.y < p1.y) {
+        dir = 1.0f;
+    }
+    else {
+        RasterPoint t = p0;
+        p0 = p1;
+        p1 = t;
+        dir = -1.0f;
+    }
+
+    dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+    x = p0.x;
+    yStart = (int) floorf(p0.y);
+    if (yStart < 0) {
+        x -= p0.y * dxdy;
+        yStart = 0;
+    }
+    yEnd = (int) ceilf(p1.y);
+    if (yEnd > height) yEnd = height;
+
+    for (y = yStart; y < yEnd; y++) {
+        float   *row = acc + (size_t) y * stride;
+        float   dy = fminf((float) (y + 1), p1.y) - fmaxf((float) y, p0.y);
+        float   xNext = x + dxdy * dy;
+        float   d = dy * dir;
+        float   x0 = fminf(x, xNext), x1 = fmaxf(x, xNext);
+        float   x0Floor, x1Ceil;
+        int     x0i, x1i;
+
+        if (x0 < 0) x0 = 0;
+        if (x1 < 0) x1 = 0;
+        if (x0 > width) x0 = (float) width;
+        if (x1 > width) x1 = (float) width;
+
+        x0Floor = floorf(x0);
+        x0i = (int) x0Floor;
+        x1Ceil = ceilf(x1);
+        x1i = (int) x1Ceil;
+
+        if (x1i <= x0i + 1) {
+            // The edge stays within one pixel column on this row
+            float   xmf = 0.5f * (x0 + x1) - x0Floor;
+            row[x0i] += d - d * xmf;
+            row[x0i + 1] += d * xmf;
+        }
+        else {
+            // The edge crosses several columns; spread the area over them
+            float   s = 1.0f / (x1 - x0);
+            float   x0f = x0 - x0Floor;
+            float   a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+            float   x1f = x1 - x1Ceil + 1.0f;
+            float   am = 0.5f * s * x1f * x1f;
+            int     xi;
+
+            row[x0i] += d * a0;
+            if (x1i == x0i + 2) {
+                row[x0i + 1] += d * (1.0f - a0 - am);
+            }
+            else {
+                float   a1 = s * (1.5f - x0f);
+                float   a2;
+
+                row[x0i + 1] += d * (a1 - a0);
+                for (xi = x0i + 2; xi < x1i - 1; xi++)
+                    row[xi] += d * s;
+                a2 = a1 + (x1i - x0i - 3) * s;
+                row[x1i - 1] += d * (1.0f - a2 - am);
+            }
+            row[x1i] += d * am;
+        }
+        x = xNext;
+    }
+}
+
+
+// Fills a path using the nonzero winding rule, offset by (dx, dy).  The coverage is
+// the exact area of each pixel covered by the path.
+//
+void RasterFillPath(RasterBuffer *buffer, const RasterPath *path, float dx, float dy, int antialias)
+{
+    float       minX, minY, maxX, maxY;
+    int         left, top, right, bottom, width, height, stride;
+    int         c, i, x, y, start;
+
+    if ( ! RasterPathGetBounds(path, &minX, &minY, &maxX, &maxY) ) return;
+
+    left = (int) floorf(minX + dx);
+    top = (int) floorf(minY + dy);
+    right = (int) ceilf(maxX + dx) + 1;
+    bottom = (int) ceilf(maxY + dy);
+    if (left < 0) left = 0;
+    if (top < 0) top = 0;
+    if (right > buffer->width) right = buffer->width;
+    if (bottom > buffer->height) bottom = buffer->height;
+    if (left >= right || top >= bottom) return;
+
+    width = right - left;
+    height = bottom - top;
+    stride = width + 2;
+    if ( ! EnsureScratch(buffer, (size_t) stride * height) ) return;
+    memset(buffer->scratch, 0, (size_t) stride * height * sizeof(float));
+
+    // Accumulate all edges, in buffer-relative coordinates
+    start = 0;
+    for (c = 0; c < path->numContours; c++) {
+        int     end = path->contourEnds[c];
+
+        for (i = start; i < end; i++) {
+            const RasterPoint   *a = &path->points[i];
+            const RasterPoint   *b = &path->points[(i + 1 < end) ? i + 1 : start];
+            RasterPoint         p0, p1;
+
+            p0.x = a->x + dx - left;
+            p0.y = a->y + dy - top;
+            p1.x = b->x + dx - left;
+            p1.y = b->y + dy - top;
+            AccumulateEdge(buffer->scratch, stride, width, height, p0, p1);
+        }
+        start = end;
+    }
+
+    // Integrate each row and composite into the buffer
+    for (y = 0; y < height; y++) {
+        const float     *row = buffer->scratch + (size_t) y * stride;
+        unsigned char   *dst = buffer->pixels + (size_t) (top + y) * buffer->rowBytes + left;
+        float           sum = 0;
+
+        for (x = 0; x < width; x++) {
+            unsigned char   value;
+
+            sum += row[x];
+            value = CoverageToPixel(fabsf(sum), antialias);
+            if (value > dst[x])
+                dst[x] = value;
+        }
+    }
+}
+
+
+// - = - Stroking - = -
+
+// Draws one segment of a stroke as a capsule.  The union of the capsules for all
+// segments of a contour gives a stroke with round joins.
+//
+static void StrokeSegment(RasterBuffer *buffer, RasterPoint a, RasterPoint b, float radius, int antialias)
+{
+    float       vx = b.x - a.x, vy = b.y - a.y;
+    float       len2 = vx * vx + vy * vy;
+    int         left, top, right, bottom, x, y;
+
+    left = (int) floorf(fminf(a.x, b.x) - radius - 1);
+    top = (int) floorf(fminf(a.y, b.y) - radius - 1);
+    right = (int) ceilf(fmaxf(a.x, b.x) + radius + 1);
+    bottom = (int) ceilf(fmaxf(a.y, b.y) + radius + 1);
+    if (left < 0) left = 0;
+    if (top < 0) top = 0;
+    if (right > buffer->width) right = buffer->width;
+    if (bottom > buffer->height) bottom = buffer->height;
+
+    for (y = top; y < bottom; y++) {
+        unsigned char   *dst = buffer->pixels + (size_t) y * buffer->rowBytes;
+        float           cy = y + 0.5f;
+
+        for (x = left; x < right; x++) {
+            float           cx = x + 0.5f;
+            float           t = 0, ex, ey, coverage;
+            unsigned char   value;
+
+            if (len2 > 0) {
+                t = ((cx - a.x) * vx + (cy - a.y) * vy) / len2;
+                if (t < 0) t = 0;
+                if (t > 1) t = 1;
+            }
+            ex = a.x + t * vx - cx;
+            ey = a.y + t * vy - cy;
+            coverage = radius + 0.5f - sqrtf(ex * ex + ey * ey);
+            if (coverage <= 0) continue;
+
+            value = CoverageToPixel(coverage, antialias);
+            if (value > dst[x])
+                dst[x] = value;
+        }
+    }
+}
+
+
+// Strokes the outline of a path, offset by (dx, dy), centered on the path like CG does
+//
+void RasterStrokePath(RasterBuffer *buffer, const RasterPath *path, float dx, float dy, float lineWidth, int antialias)
+{
+    int         c, i, start = 0;
+    float       radius = lineWidth / 2;
+
+    if (lineWidth <= 0) return;
+
+    for (c = 0; c < path->numContours; c++) {
+        int     end = path->contourEnds[c];
+
+        for (i = start; i < end; i++) {
+            const RasterPoint   *a = &path->points[i];
+            const RasterPoint   *b = &path->points[(i + 1 < end) ? i + 1 : start];
+            RasterPoint         p0, p1;
+
+            p0.x = a->x + dx;
+            p0.y = a->y + dy;
+            p1.x = b->x + dx;
+            p1.y = b->y + dy;
+            StrokeSegment(buffer, p0, p1, radius, antialias);
+        }
+        start = end;
+    }
+}
+
+
+// Strokes a rectangle, the equivalent of CGContextStrokeRect
+//
+void RasterStrokeRect(RasterBuffer *buffer, float x, float y, float width, float height, float lineWidth)
+{
+    RasterPoint     corners[4];
+    int             i;
+
+    corners[0].x = x;           corners[0].y = y;
+    corners[1].x = x + width;   corners[1].y = y;
+    corners[2].x = x + width;   corners[2].y = y + height;
+    corners[3].x = x;           corners[3].y = y + height;
+
+    for (i = 0; i < 4; i++)
+        StrokeSegment(buffer, corners[i], corners[(i + 1) % 4], lineWidth / 2, 1);
+}
+
+
+// Composites a coverage mask into the buffer with its top left corner at (x, y)
+//
+void RasterCompositeMask(RasterBuffer *buffer, const unsigned char *pixels, int rowBytes, int width, int height, int x, int y)
+{
+    int             row, col;
+
+    for (row = 0; row < height; row++) {
+        const unsigned char     *in;
+        unsigned char           *out;
+
+        if (y + row < 0 || y + row >= buffer->height) continue;
+        in = pixels + row * rowBytes;
+        out = buffer->pixels + (y + row) * buffer->rowBytes;
+
+        for (col = 0; col < width; col++) {
+            if (x + col < 0 || x + col >= buffer->width) continue;
+            if (in[col] > out[x + col])
+                out[x + col] = in[col];
+        }
+    }
+}
+
+
+// Composites another buffer into this one with its top left corner at (x, y)
+//
+void RasterCompositeBuffer(RasterBuffer *buffer, const RasterBuffer *source, int x, int y)
+{
+    RasterCompositeMask(buffer, source->pixels, source->rowBytes, source->width, source->height, x, y);
+}
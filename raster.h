@@ -0,0 +1,119 @@
+/*
+
+File: raster.h
+
+Abstract: Header for the portable software rasterizer used by the headless
+renderer in SyntheticBoldDemo project.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_RASTER_H
+#define MY_RASTER_H
+
+// The raster module is plain C with no Carbon dependencies so that it can be
+// built on any platform. It provides a flattened path representation and a
+// software rasterizer that writes 8-bit coverage values.
+
+#include <stddef.h>
+
+// A point in pixel space.  Y increases downwards, as in the coverage buffer.
+//
+typedef struct {
+    float               x;
+    float               y;
+} RasterPoint;
+
+// A path made of closed polygons. Curves are flattened into line segments as
+// they are added, so everything downstream only ever sees straight edges.
+//
+typedef struct {
+    RasterPoint         *points;            // All vertices of all contours
+    int                 numPoints;
+    int                 pointCapacity;
+    int                 *contourEnds;       // Index one past the last point of each contour
+    int                 numContours;
+    int                 contourCapacity;
+    RasterPoint         current;            // The current pen position
+    int                 contourOpen;        // Non-zero while a contour is being built
+} RasterPath;
+
+// An 8-bit coverage buffer. Row 0 is the top of the image.
+//
+typedef struct {
+    unsigned char       *pixels;
+    int                 width;
+    int                 height;
+    int                 rowBytes;
+    float               *scratch;           // Accumulation space used while filling
+    size_t              scratchCapacity;    // In floats
+} RasterBuffer;
+
+
+// Paths
+void RasterPathInit(RasterPath *path);
+void RasterPathReset(RasterPath *path);
+void RasterPathDispose(RasterPath *path);
+void RasterPathMoveTo(RasterPath *path, float x, float y);
+void RasterPathLineTo(RasterPath *path, float x, float y);
+void RasterPathQuadTo(RasterPath *path, float cx, float cy, float x, float y);
+void RasterPathCubicTo(RasterPath *path, float c1x, float c1y, float c2x, float c2y, float x, float y);
+void RasterPathClose(RasterPath *path);
+int RasterPathGetBounds(const RasterPath *path, float *minX, float *minY, float *maxX, float *maxY);
+
+// Coverage buffers
+int RasterBufferCreate(RasterBuffer *buffer, int width, int height);
+void RasterBufferClear(RasterBuffer *buffer);
+void RasterBufferDispose(RasterBuffer *buffer);
+int RasterBufferWritePGM(const RasterBuffer *buffer, const char *fileName);
+
+// Drawing.  All drawing is composited into the buffer by taking the maximum
+// coverage, so overlapping shapes behave like a union.
+void RasterFillPath(RasterBuffer *buffer, const RasterPath *path, float dx, float dy, int antialias);
+void RasterStrokePath(RasterBuffer *buffer, const RasterPath *path, float dx, float dy, float lineWidth, int antialias);
+void RasterStrokeRect(RasterBuffer *buffer, float x, float y, float width, float height, float lineWidth);
+void RasterCompositeMask(RasterBuffer *buffer, const unsigned char *pixels, int rowBytes, int width, int height, int x, int y);
+void RasterCompositeBuffer(RasterBuffer *buffer, const RasterBuffer *source, int x, int y);
+
+#endif  /* MY_RASTER_H */
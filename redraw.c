@@ -0,0 +1,158 @@
+/*
+
+File: redraw.c
+
+Abstract: Coalesces redraw requests so the view is redrawn at
+most once per display frame.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include "globals.h"
+#include "atsui.h"
+#include "window.h"
+#include "redraw.h"
+
+// The view is invalidated at most once per display frame
+//
+#define kRedrawFrameInterval		(kEventDurationSecond / 60)
+
+// Globals for just this source module
+//
+static EventLoopTimerRef			gRedrawTimer = NULL;
+static UInt32						gPendingBoxes = 0;		// What the next frame has to redraw; 0 if nothing is waiting
+static EventTime					gLastFrameTime = 0;
+static MyRedrawStats				gRedrawStats;
+
+
+// Passes everything asked for since the last frame on to the view in one go.  The
+// view then draws whatever the state is by the time it gets to it.
+//
+static pascal void MyRedrawTimerFired(EventLoopTimerRef inTimer, void *inUserData)
+{
+    UInt32							boxes = gPendingBoxes;
+
+    gPendingBoxes = 0;
+    if (boxes == 0)
+        return;
+
+    if (boxes == kRedrawWholeView)
+        HIViewSetNeedsDisplay( gView, true );
+    else
+        InvalidateATSUIStuffBoxes(boxes);
+
+    gRedrawStats.frames++;
+    gLastFrameTime = GetCurrentEventTime();
+}
+
+
+// Installs the timer that paces the redraws.  It stays idle until a redraw is asked for.
+//
+void SetUpRedrawScheduler(void)
+{
+    verify_noerr( InstallEventLoopTimer(GetMainEventLoop(), kEventDurationForever, kEventDurationForever,
+                                        NewEventLoopTimerUPP(MyRedrawTimerFired), NULL, &gRedrawTimer) );
+}
+
+
+// Asks for the text in some boxes (kATSUIStuffRegularBox, kATSUIStuffBoldBox) or for
+// the whole view (kRedrawWholeView) to be redrawn.  Requests that arrive before the
+// next frame are merged into one, so a fast slider drag costs at most one redraw
+// per frame however many control hits it sends.
+//
+void ScheduleRedraw(UInt32 inBoxes)
+{
+    EventTimerInterval				delay;
+
+    gRedrawStats.requests++;
+    if (gPendingBoxes != 0)
+	{
+        gPendingBoxes |= inBoxes;
+        gRedrawStats.merged++;
+        return;
+    }
+    gPendingBoxes = inBoxes;
+
+    // Without the timer there is nothing to pace the redraws with
+    if (gRedrawTimer == NULL)
+	{
+        MyRedrawTimerFired(NULL, NULL);
+        return;
+    }
+
+    // Wait for the rest of the frame that started with the last redraw
+    delay = gLastFrameTime + kRedrawFrameInterval - GetCurrentEventTime();
+    if (delay < kEventDurationNoWait)
+        delay = kEventDurationNoWait;
+    verify_noerr( SetEventLoopTimerNextFireTime(gRedrawTimer, delay) );
+}
+
+
+// Called by the view's draw handler.  A draw of the whole view, such as one during
+// a live resize, already shows the latest state, so anything still waiting is dropped.
+//
+void NoteViewDrawn(Boolean inWholeView)
+{
+    if (inWholeView && gPendingBoxes != 0)
+	{
+        gPendingBoxes = 0;
+        gRedrawStats.dropped++;
+    }
+    gLastFrameTime = GetCurrentEventTime();
+}
+
+
+void GetRedrawStats(MyRedrawStats *outStats)
+{
+    *outStats = gRedrawStats;
+}
+
+
+void DisposeRedrawScheduler(void)
+{
+    if (gRedrawTimer != NULL)
+        verify_noerr( RemoveEventLoopTimer(gRedrawTimer) );
+    gRedrawTimer = NULL;
+    gPendingBoxes = 0;
+}
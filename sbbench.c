@@ -0,0 +1,400 @@
+/*
+
+File: sbbench.c
+
+Abstract: Command line microbenchmarks for each stage of the portable
+synthetic bold render path in SyntheticBoldDemo project. Has no Carbon
+dependencies.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headless.h"
+
+// Microbenchmarks for the portable render path.  Each stage of the comparison
+// view is timed on its own over a grid of string lengths, point sizes and stroke
+// factors, and reported as CSV on stdout:
+//
+//     layout      HeadlessLayoutInit(), HeadlessShapeText() and HeadlessLayoutDispose()
+//     shaping     HeadlessShapeText() into an existing layout
+//     regular     One line without the extra bold
+//     stroked     Filled and stroked, like kCGTextFillStroke
+//     emboldened  Emboldened outlines, what atsui.c does today
+//     boldface    Struck twice, like kATSUQDBoldfaceTag
+//
+//     sbbench -font a.ttf [-lengths 12,1000] [-sizes 9,48] [-factors 0.024]
+//             [-stages regular,stroked] [-min-time seconds] [-cache]
+//
+// On Linux it builds with:
+//
+//     cc -O2 -o sbbench sbbench.c headless.c fontfile.c outline.c raster.c dilate.c glyphcache.c -lm
+//
+// With glibc, every malloc() made by a stage is counted.  Elsewhere the
+// allocation columns are -1.
+
+#define kMaxListItems           64
+#define kMinIterations          5
+#define kMaxIterations          10000
+#define kBufferWidth            2048        // Long lines are drawn in pieces this wide
+
+enum {
+    kStageLayout = 0,
+    kStageShaping,
+    kStageRegular,
+    kStageStroked,
+    kStageEmboldened,
+    kStageBoldface,
+    kNumStages
+};
+
+static const char *gStageNames[kNumStages] = { "layout", "shaping", "regular", "stroked", "emboldened", "boldface" };
+static const int gStageLineStyles[kNumStages] = { -1, -1, kHeadlessLineRegular, kHeadlessLineStroked, kHeadlessLineEmboldened, kHeadlessLineBoldface };
+
+
+// - = - Allocation counting - = -
+
+#if defined(__GLIBC__)
+
+#define BENCH_COUNTS_ALLOCATIONS    1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static unsigned long        gAllocations = 0;
+static unsigned long long   gAllocatedBytes = 0;
+
+void *malloc(size_t size)
+{
+    gAllocations++;
+    gAllocatedBytes += size;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    gAllocations++;
+    gAllocatedBytes += count * size;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    gAllocations++;
+    gAllocatedBytes += size;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+#else
+
+static unsigned long        gAllocations = 0;
+static unsigned long long   gAllocatedBytes = 0;
+
+#endif
+
+
+// - = - Timing - = -
+
+// Everything one stage needs
+//
+typedef struct {
+    HeadlessParams          params;
+    HeadlessLayout          layout;             // Already shaped, for the drawing stages
+    RasterBuffer            buffer;
+    float                   baseline;
+} BenchSetup;
+
+
+// Draws the whole line in pieces that fit the buffer, so every glyph is rasterized
+// however long the text is
+//
+static void DrawInPieces(BenchSetup *setup, int style)
+{
+    HeadlessLayout      piece = setup->layout;
+    size_t              start = 0;
+
+    while (start < setup->layout.numRecords) {
+        size_t          end = start + 1;
+        float           left = setup->layout.records[start].x;
+
+        while (end < setup->layout.numRecords && setup->layout.records[end].x - left < kBufferWidth - 2 * setup->params.pointSize)
+            end++;
+
+        piece.records = setup->layout.records + start;
+        piece.numRecords = end - start;
+        HeadlessDrawLine(&setup->buffer, &setup->params, &piece, setup->params.pointSize / 2 - left, setup->baseline, style);
+        start = end;
+    }
+}
+
+
+static void RunStage(BenchSetup *setup, int stage)
+{
+    if (stage == kStageLayout) {
+        HeadlessLayout  layout;
+
+        HeadlessLayoutInit(&layout);
+        HeadlessShapeText(&layout, &setup->params);
+        HeadlessLayoutDispose(&layout);
+    }
+    else if (stage == kStageShaping) {
+        HeadlessLayoutInvalidate(&setup->layout);
+        HeadlessShapeText(&setup->layout, &setup->params);
+    }
+    else
+        DrawInPieces(setup, gStageLineStyles[stage]);
+}
+
+
+static int CompareTimes(const void *a, const void *b)
+{
+    unsigned long long  x = *(const unsigned long long *) a, y = *(const unsigned long long *) b;
+    return (x < y) ? -1 : (x > y);
+}
+
+
+// Times one stage until it has run for at least 'minTime' nanoseconds, then prints
+// one line of results
+//
+static void TimeStage(BenchSetup *setup, int stage, size_t numChars, unsigned long long minTime, unsigned long long *times)
+{
+    unsigned long long  total = 0, median;
+    unsigned long       allocations;
+    unsigned long long  bytes;
+    int                 n = 0;
+    size_t              numGlyphs = setup->layout.numRecords;
+
+    // One untimed run to warm the caches
+    RunStage(setup, stage);
+
+    allocations = gAllocations;
+    bytes = gAllocatedBytes;
+    while (n < kMaxIterations && (n < kMinIterations || total < minTime)) {
+        unsigned long long  start = HeadlessGetNanoseconds();
+
+        RunStage(setup, stage);
+        times[n] = HeadlessGetNanoseconds() - start;
+        total += times[n++];
+    }
+    allocations = gAllocations - allocations;
+    bytes = gAllocatedBytes - bytes;
+
+    qsort(times, n, sizeof(unsigned long long), CompareTimes);
+    median = times[n / 2];
+
+    printf("%s,%lu,%lu,%g,%g,%d,%.2f,%.3f,%.3f,%.3f,%.3f",
+           gStageNames[stage], (unsigned long) numChars, (unsigned long) numGlyphs,
+           setup->params.pointSize, setup->params.strokeThicknessFactor, n,
+           (numGlyphs > 0) ? (double) median / numGlyphs : 0.0,
+           median / 1000.0, times[(n * 90) / 100] / 1000.0, times[(n * 99) / 100] / 1000.0, times[n - 1] / 1000.0);
+#ifdef BENCH_COUNTS_ALLOCATIONS
+    printf(",%.1f,%.0f\n", (double) allocations / n, (double) bytes / n);
+#else
+    (void) allocations;
+    (void) bytes;
+    printf(",-1,-1\n");
+#endif
+    fflush(stdout);
+}
+
+
+// - = - Command line - = -
+
+static int ParseList(const char *s, float *items)
+{
+    int             count = 0;
+
+    while (*s != 0 && count < kMaxListItems) {
+        char        *end;
+
+        items[count] = (float) strtod(s, &end);
+        if (end == s) break;
+        count++;
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+
+// Fills 'text' with 'length' UTF-16 units of ordinary prose
+//
+static void MakeText(unsigned short *text, size_t length)
+{
+    static const char   sample[] = "The quick brown fox jumps over the lazy dog. Sphinx of black quartz, judge my vow! ";
+    size_t              i;
+
+    for (i = 0; i < length; i++)
+        text[i] = (unsigned char) sample[i % (sizeof(sample) - 1)];
+}
+
+
+static void PrintUsage(const char *name)
+{
+    fprintf(stderr, "usage: %s -font a.ttf [-lengths 12,1000] [-sizes 9,48] [-factors 0.024]\n"
+                    "       [-stages layout,shaping,regular,stroked,emboldened,boldface] [-min-time seconds] [-cache]\n", name);
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char          *fontName = NULL;
+    float               lengths[kMaxListItems] = { 12, 100, 1000, 10000, 100000, 1000000 };
+    float               sizes[kMaxListItems] = { 9, 12, 24, 48, 96, 288 };
+    float               factors[kMaxListItems] = { 0.024f, 0.1f };
+    int                 numLengths = 6, numSizes = 6, numFactors = 2;
+    int                 enabled[kNumStages] = { 1, 1, 1, 1, 1, 1 };
+    unsigned long long  minTime = 200000000ULL;
+    unsigned long long  *times;
+    int                 useCache = 0, i, l, s, k, stage;
+    FontFile            font;
+    GlyphCache          cache;
+    unsigned short      *text;
+    size_t              maxLength = 0;
+
+    for (i = 1; i < argc; i++) {
+        int     hasValue = (i + 1 < argc);
+
+        if (strcmp(argv[i], "-cache") == 0)
+            useCache = 1;
+        else if (hasValue && strcmp(argv[i], "-font") == 0)
+            fontName = argv[++i];
+        else if (hasValue && strcmp(argv[i], "-lengths") == 0)
+            numLengths = ParseList(argv[++i], lengths);
+        else if (hasValue && strcmp(argv[i], "-sizes") == 0)
+            numSizes = ParseList(argv[++i], sizes);
+        else if (hasValue && strcmp(argv[i], "-factors") == 0)
+            numFactors = ParseList(argv[++i], factors);
+        else if (hasValue && strcmp(argv[i], "-min-time") == 0)
+            minTime = (unsigned long long) (atof(argv[++i]) * 1e9);
+        else if (hasValue && strcmp(argv[i], "-stages") == 0) {
+            const char  *list = argv[++i];
+
+            for (stage = 0; stage < kNumStages; stage++) {
+                const char  *found = strstr(list, gStageNames[stage]);
+                size_t      n = strlen(gStageNames[stage]);
+
+                enabled[stage] = (found != NULL && (found == list || found[-1] == ',') && (found[n] == ',' || found[n] == 0));
+            }
+        }
+        else {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (fontName == NULL || numLengths == 0 || numSizes == 0 || numFactors == 0) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    if (FontFileOpen(&font, fontName) != 0) {
+        fprintf(stderr, "%s: cannot read TrueType font %s\n", argv[0], fontName);
+        return 1;
+    }
+
+    for (l = 0; l < numLengths; l++)
+        if ((size_t) lengths[l] > maxLength) maxLength = (size_t) lengths[l];
+    text = (unsigned short *) malloc((maxLength + 1) * sizeof(unsigned short));
+    times = (unsigned long long *) malloc(kMaxIterations * sizeof(unsigned long long));
+    if (text == NULL || times == NULL || (useCache && GlyphCacheInit(&cache, kGlyphCacheDefaultBudget, NULL) != 0)) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+    MakeText(text, maxLength);
+
+    printf("stage,chars,glyphs,size,factor,iterations,ns_per_glyph,p50_us,p90_us,p99_us,max_us,allocs_per_iter,bytes_per_iter\n");
+
+    for (s = 0; s < numSizes; s++) {
+        for (l = 0; l < numLengths; l++) {
+            BenchSetup      setup;
+
+            memset(&setup, 0, sizeof(setup));
+            setup.params.font = &font;
+            setup.params.text = text;
+            setup.params.length = (size_t) lengths[l];
+            setup.params.pointSize = sizes[s];
+            setup.params.antiAliasingThreshold = -1;
+            setup.params.emboldenMethod = kHeadlessEmboldenOutline;
+            setup.params.glyphCache = useCache ? &cache : NULL;
+            setup.baseline = sizes[s] * 1.5f;
+
+            HeadlessLayoutInit(&setup.layout);
+            if (HeadlessShapeText(&setup.layout, &setup.params) != 0
+                || RasterBufferCreate(&setup.buffer, kBufferWidth, (int) (sizes[s] * 2.5f) + 8) != 0) {
+                fprintf(stderr, "%s: out of memory\n", argv[0]);
+                return 1;
+            }
+
+            for (k = 0; k < numFactors; k++) {
+                setup.params.strokeThicknessFactor = factors[k];
+                for (stage = 0; stage < kNumStages; stage++) {
+                    // Only the stroked and emboldened stages depend on the stroke factor;
+                    // boldface is struck twice a pixel apart whatever the factor
+                    if ( ! enabled[stage] ) continue;
+                    if (k > 0 && stage != kStageStroked && stage != kStageEmboldened) continue;
+                    TimeStage(&setup, stage, setup.params.length, minTime, times);
+                }
+            }
+
+            RasterBufferDispose(&setup.buffer);
+            HeadlessLayoutDispose(&setup.layout);
+        }
+    }
+
+    if (useCache)
+        GlyphCacheDispose(&cache);
+    FontFileDispose(&font);
+    free(times);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,365 @@
+/*
+
+File: sbcalibrate.c
+
+Abstract: Command line tool that measures the stroke factor that matches each
+font's real bold face, and writes the table the app loads.  Has no Carbon
+dependencies.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headless.h"
+#include "taskpool.h"
+#include "strokecal.h"
+
+// Computes the stroke factor table the app loads at startup.  Each font is given
+// with its real bold face.  For every size band the tool measures how wide the
+// vertical stems of the bold face are, then searches for the stroke factor that
+// makes the regular face's stems as wide once it is emboldened the way the app
+// does it.  Each font and band is one job on a pool of threads.
+//
+//     sbcalibrate [-j threads] -o StrokeFactors.sbst -pair Regular.ttf Bold.ttf [-pair ...]
+//
+// The table is keyed by the PostScript name of the regular face.  On Linux the
+// tool builds with:
+//
+//     cc -O2 -o sbcalibrate sbcalibrate.c strokecal.c taskpool.c headless.c fontfile.c outline.c raster.c dilate.c glyphcache.c -lm -lpthread
+
+#define kMaxPairs               256
+
+// Stems are measured on these characters: each is a single vertical stroke in
+// most typefaces, so its inked area divided by its height is the stem width
+//
+static const unsigned long      gStemCharacters[] = { 'l', 'I' };
+#define kNumStemCharacters      (sizeof(gStemCharacters) / sizeof(gStemCharacters[0]))
+
+// The search for a factor stays in this range, and stops after this many halvings
+//
+#define kMaxStrokeFactor        0.2f
+#define kSearchSteps            24
+
+// The coverage buffers have room for a stem glyph at the largest size measured
+//
+#define kBufferSize             256
+#define kBufferMargin           8
+
+// One font at one size band
+//
+typedef struct {
+    const FontFile          *regular;
+    const FontFile          *bold;
+    int                     band;
+    float                   boldStem;           // In pixels
+    float                   factor;
+    int                     result;
+} CalibrationJob;
+
+// Per-thread scratch space
+//
+typedef struct {
+    RasterBuffer            buffer;
+    GlyphOutline            outline;
+    RasterPath              path;
+} CalibrationWorker;
+
+static CalibrationWorker    *gWorkers;
+
+
+// Returns the stem width of a glyph, in pixels, after emboldening its outline by
+// 'distance' on every side.  Returns a negative number if it cannot be measured.
+//
+static float MeasureStem(CalibrationWorker *worker, const FontFile *font, unsigned int glyph, float pointSize, float distance)
+{
+    float               minX, minY, maxX, maxY, area = 0;
+    int                 x, y;
+
+    GlyphOutlineReset(&worker->outline);
+    RasterPathReset(&worker->path);
+    if (FontFileGetGlyphOutline(font, glyph, pointSize / font->unitsPerEm, &worker->outline) != 0)
+        return -1;
+    if (distance > 0)
+        GlyphOutlineEmbolden(&worker->outline, distance);
+    GlyphOutlineFlatten(&worker->outline, 0, 0, &worker->path);
+    if (! RasterPathGetBounds(&worker->path, &minX, &minY, &maxX, &maxY) || maxY - minY < 1
+        || maxX - minX > kBufferSize - 2 * kBufferMargin || maxY - minY > kBufferSize - 2 * kBufferMargin)
+        return -1;
+
+    RasterBufferClear(&worker->buffer);
+    RasterFillPath(&worker->buffer, &worker->path, kBufferMargin - minX, kBufferMargin - minY, 1);
+    for (y = 0; y < worker->buffer.height; y++) {
+        const unsigned char *row = worker->buffer.pixels + y * worker->buffer.rowBytes;
+
+        for (x = 0; x < worker->buffer.width; x++)
+            area += row[x];
+    }
+    return area / 255 / (maxY - minY);
+}
+
+
+// Marks in 'stems' the stem characters both faces have, and that can be measured
+// in both without emboldening.  Returns how many there are.
+//
+static int FindStemCharacters(CalibrationWorker *worker, const FontFile *regular, const FontFile *bold, float pointSize, int *stems)
+{
+    int                 count = 0;
+    size_t              i;
+
+    for (i = 0; i < kNumStemCharacters; i++) {
+        unsigned int    regularGlyph = FontFileGetGlyphIndex(regular, gStemCharacters[i]);
+        unsigned int    boldGlyph = FontFileGetGlyphIndex(bold, gStemCharacters[i]);
+
+        stems[i] = regularGlyph != 0 && boldGlyph != 0
+            && MeasureStem(worker, regular, regularGlyph, pointSize, 0) >= 0
+            && MeasureStem(worker, bold, boldGlyph, pointSize, 0) >= 0;
+        count += stems[i];
+    }
+    return count;
+}
+
+
+// Returns the mean stem width of a font at a size, emboldened by 'factor', over
+// the stem characters marked in 'stems'.  The mean is always over the same glyphs,
+// so if one of them cannot be measured this returns a negative number.
+//
+static float MeasureFont(CalibrationWorker *worker, const FontFile *font, float pointSize, float factor, const int *stems)
+{
+    float               total = 0;
+    int                 count = 0;
+    size_t              i;
+
+    for (i = 0; i < kNumStemCharacters; i++) {
+        float           stem;
+
+        if (! stems[i])
+            continue;
+        stem = MeasureStem(worker, font, FontFileGetGlyphIndex(font, gStemCharacters[i]), pointSize, factor * pointSize / 2);
+        if (stem < 0)
+            return -1;
+        total += stem;
+        count++;
+    }
+    return (count > 0) ? total / count : -1;
+}
+
+
+// Finds the factor by halving the range it can be in: the stems only get wider as
+// the factor grows.  A bold face no heavier than the regular one gets zero.  The
+// job fails if the emboldened stems outgrow the buffer along the way.
+//
+static void RunCalibrationJob(void *arg, int worker)
+{
+    CalibrationJob      *job = (CalibrationJob *) arg;
+    CalibrationWorker   *scratch = &gWorkers[worker];
+    float               pointSize = StrokeCalibrationGetBandSize(job->band);
+    float               low = 0, high = kMaxStrokeFactor;
+    int                 stems[kNumStemCharacters], step;
+
+    job->result = -1;
+    if (FindStemCharacters(scratch, job->regular, job->bold, pointSize, stems) == 0)
+        return;
+    job->boldStem = MeasureFont(scratch, job->bold, pointSize, 0, stems);
+    if (job->boldStem < 0)
+        return;
+
+    for (step = 0; step < kSearchSteps; step++) {
+        float           middle = (low + high) / 2;
+        float           stem = MeasureFont(scratch, job->regular, pointSize, middle, stems);
+
+        if (stem < 0)
+            return;
+        if (stem < job->boldStem)
+            low = middle;
+        else
+            high = middle;
+    }
+    job->factor = (low + high) / 2;
+    job->result = 0;
+}
+
+
+static void PrintUsage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-j threads] -o table.sbst -pair Regular.ttf Bold.ttf [-pair ...]\n", name);
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char          *regularNames[kMaxPairs], *boldNames[kMaxPairs], *outName = NULL;
+    FontFile            regulars[kMaxPairs], bolds[kMaxPairs];
+    char                psNames[kMaxPairs][128];
+    int                 numPairs = 0, numThreads = TaskPoolDefaultThreadCount();
+    int                 i, p, band, numJobs, failures = 0;
+    CalibrationJob      *jobs;
+    StrokeCalibrationBuilder builder;
+    TaskPool            pool;
+    unsigned long long  start, elapsed;
+
+    for (i = 1; i < argc; i++) {
+        int     hasValue = (i + 1 < argc);
+
+        if (hasValue && strcmp(argv[i], "-j") == 0)
+            numThreads = atoi(argv[++i]);
+        else if (hasValue && strcmp(argv[i], "-o") == 0)
+            outName = argv[++i];
+        else if (i + 2 < argc && strcmp(argv[i], "-pair") == 0 && numPairs < kMaxPairs) {
+            regularNames[numPairs] = argv[++i];
+            boldNames[numPairs++] = argv[++i];
+        }
+        else {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (outName == NULL || numPairs == 0) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+    if (numThreads < 1) numThreads = 1;
+
+    // Load everything up front; the fonts are shared read-only by all threads
+    for (p = 0; p < numPairs; p++) {
+        if (FontFileOpen(&regulars[p], regularNames[p]) != 0) {
+            fprintf(stderr, "%s: cannot read TrueType font %s\n", argv[0], regularNames[p]);
+            return 1;
+        }
+        if (FontFileOpen(&bolds[p], boldNames[p]) != 0) {
+            fprintf(stderr, "%s: cannot read TrueType font %s\n", argv[0], boldNames[p]);
+            return 1;
+        }
+        if (FontFileGetPostScriptName(&regulars[p], psNames[p], sizeof(psNames[p])) != 0) {
+            fprintf(stderr, "%s: %s has no PostScript name\n", argv[0], regularNames[p]);
+            return 1;
+        }
+    }
+
+    numJobs = numPairs * kStrokeCalibrationNumBands;
+    jobs = (CalibrationJob *) calloc(numJobs, sizeof(CalibrationJob));
+    gWorkers = (CalibrationWorker *) calloc(numThreads, sizeof(CalibrationWorker));
+    if (jobs == NULL || gWorkers == NULL) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+    for (i = 0; i < numThreads; i++) {
+        if (RasterBufferCreate(&gWorkers[i].buffer, kBufferSize, kBufferSize) != 0) {
+            fprintf(stderr, "%s: out of memory\n", argv[0]);
+            return 1;
+        }
+        GlyphOutlineInit(&gWorkers[i].outline);
+        RasterPathInit(&gWorkers[i].path);
+    }
+
+    if (TaskPoolCreate(&pool, numThreads) != 0) {
+        fprintf(stderr, "%s: cannot start threads\n", argv[0]);
+        return 1;
+    }
+
+    start = HeadlessGetNanoseconds();
+    for (p = 0, i = 0; p < numPairs; p++)
+        for (band = 0; band < kStrokeCalibrationNumBands; band++, i++) {
+            jobs[i].regular = &regulars[p];
+            jobs[i].bold = &bolds[p];
+            jobs[i].band = band;
+            TaskPoolSubmit(&pool, RunCalibrationJob, &jobs[i]);
+        }
+    TaskPoolWait(&pool);
+    elapsed = HeadlessGetNanoseconds() - start;
+    TaskPoolDispose(&pool);
+
+    // A font goes in the table only if every band of it was measured
+    StrokeCalibrationBuilderInit(&builder);
+    printf("font");
+    for (band = 0; band < kStrokeCalibrationNumBands; band++)
+        printf(",%gpt", StrokeCalibrationGetBandSize(band));
+    printf("\n");
+    for (p = 0; p < numPairs; p++) {
+        float           factors[kStrokeCalibrationNumBands];
+        int             ok = 1;
+
+        printf("\"%s\"", psNames[p]);
+        for (band = 0; band < kStrokeCalibrationNumBands; band++) {
+            const CalibrationJob *job = &jobs[p * kStrokeCalibrationNumBands + band];
+
+            factors[band] = job->factor;
+            if (job->result != 0) ok = 0;
+            printf(",%.4f", job->factor);
+        }
+        printf("\n");
+
+        if (! ok) {
+            fprintf(stderr, "%s: no stems to measure in %s and %s\n", argv[0], regularNames[p], boldNames[p]);
+            failures++;
+        }
+        else if (StrokeCalibrationBuilderAddFont(&builder, psNames[p], factors) != 0) {
+            fprintf(stderr, "%s: out of memory\n", argv[0]);
+            return 1;
+        }
+    }
+    if (StrokeCalibrationBuilderWrite(&builder, outName) != 0) {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], outName);
+        return 1;
+    }
+    StrokeCalibrationBuilderDispose(&builder);
+
+    fprintf(stderr, "%d fonts in %d bands on %d threads in %.3f s, %d failed\n",
+            numPairs, kStrokeCalibrationNumBands, numThreads, elapsed / 1e9, failures);
+
+    for (i = 0; i < numThreads; i++) {
+        RasterBufferDispose(&gWorkers[i].buffer);
+        GlyphOutlineDispose(&gWorkers[i].outline);
+        RasterPathDispose(&gWorkers[i].path);
+    }
+    for (p = 0; p < numPairs; p++) {
+        FontFileDispose(&regulars[p]);
+        FontFileDispose(&bolds[p]);
+    }
+    free(gWorkers);
+    free(jobs);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+/*
+
+File: sbfontruns.c
+
+Abstract: Command line tool that prints the font runs the fallback fonts
+split a string into, to check FontRunsSplit().
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fontfile.h"
+#include "fontruns.h"
+#include "headless.h"
+
+// Prints the font runs FontRunsSplit() makes of a string, given the fonts in the
+// order atsui.c would try them: the base font first, then its fallbacks.  Each run
+// is printed as start+length and the index of its font, or -1 for none.  With
+// -expect the runs are compared with a list in the same form instead, and the
+// exit status is 1 if they differ.
+//
+//     sbfontruns -font base.ttf [-font fallback.ttf ...] -text "text" [-expect 0+2:0,2+1:1,3+4:0]
+//
+// On Linux it builds with:
+//
+//     cc -O2 -o sbfontruns sbfontruns.c fontruns.c headless.c fontfile.c outline.c raster.c dilate.c glyphcache.c -lm
+
+#define kMaxFonts               16
+
+
+static void PrintUsage(const char *tool)
+{
+    fprintf(stderr, "usage: %s -font base.ttf [-font fallback.ttf ...] -text text [-expect start+length:font,...]\n", tool);
+}
+
+
+// Makes a font's coverage of the characters in the text.  Only the characters that
+// are there matter to the runs, so the font's whole 'cmap' is not read.
+//
+static int MakeCoverage(const FontFile *font, const unsigned short *text, size_t length, FontCoverage *coverage)
+{
+    size_t              i;
+
+    if (FontCoverageInit(coverage) != 0) return -1;
+    for (i = 0; i < length; i++) {
+        unsigned long   c = text[i];
+
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < length && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (text[i + 1] - 0xDC00);
+            i++;
+        }
+        if (FontFileGetGlyphIndex(font, c) != 0 && FontCoverageAdd(coverage, c, c) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char          *fontNames[kMaxFonts], *utf8 = NULL, *expected = NULL;
+    FontFile            fonts[kMaxFonts];
+    FontCoverage        coverages[kMaxFonts];
+    const FontCoverage  *coveragePtrs[kMaxFonts];
+    unsigned short      *text;
+    FontRun             *runs;
+    size_t              length, numRuns, r;
+    int                 numFonts = 0, i, mismatch = 0;
+    char                actual[4096];
+    size_t              used = 0;
+
+    for (i = 1; i < argc; i++) {
+        int     hasValue = (i + 1 < argc);
+
+        if (hasValue && strcmp(argv[i], "-font") == 0 && numFonts < kMaxFonts)
+            fontNames[numFonts++] = argv[++i];
+        else if (hasValue && strcmp(argv[i], "-text") == 0)
+            utf8 = argv[++i];
+        else if (hasValue && strcmp(argv[i], "-expect") == 0)
+            expected = argv[++i];
+        else {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (numFonts == 0 || utf8 == NULL) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    text = (unsigned short *) malloc((strlen(utf8) + 1) * 2 * sizeof(unsigned short));
+    if (text == NULL) return 1;
+    length = HeadlessDecodeUTF8(utf8, text);
+    runs = (FontRun *) malloc((length + 1) * sizeof(FontRun));
+    if (runs == NULL) return 1;
+
+    for (i = 0; i < numFonts; i++) {
+        if (FontFileOpen(&fonts[i], fontNames[i]) != 0) {
+            fprintf(stderr, "%s: cannot read TrueType font %s\n", argv[0], fontNames[i]);
+            return 1;
+        }
+        if (MakeCoverage(&fonts[i], text, length, &coverages[i]) != 0) {
+            fprintf(stderr, "%s: out of memory\n", argv[0]);
+            return 1;
+        }
+        coveragePtrs[i] = &coverages[i];
+    }
+
+    numRuns = FontRunsSplit(text, 0, length, coveragePtrs, numFonts, NULL, runs);
+    for (r = 0; r < numRuns && used < sizeof(actual); r++)
+        used += snprintf(actual + used, sizeof(actual) - used, "%s%lu+%lu:%d", (r > 0) ? "," : "",
+                         (unsigned long) runs[r].start, (unsigned long) runs[r].length, runs[r].font);
+    printf("%s\n", actual);
+
+    if (expected != NULL && strcmp(expected, actual) != 0) {
+        fprintf(stderr, "%s: expected %s\n", argv[0], expected);
+        mismatch = 1;
+    }
+
+    for (i = 0; i < numFonts; i++) {
+        FontCoverageDispose(&coverages[i]);
+        FontFileDispose(&fonts[i]);
+    }
+    free(runs);
+    free(text);
+    return mismatch;
+}
@@ -0,0 +1,186 @@
+/*
+
+File: sbrender.c
+
+Abstract: Command line tool that renders the SyntheticBoldDemo comparison view
+with the headless renderer and writes it to an image file.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headless.h"
+#include "glyphcache.h"
+
+// Command line front end for the headless renderer.  Renders the comparison view
+// for one font, size and stroke factor and writes it as a PGM image.
+//
+//     sbrender [-dilate] [-check-cache bytes] font.ttf size factor "text" out.pgm [width height [threshold]]
+//
+// With -dilate the bold box is made by dilating the regular box's coverage.
+//
+// With -check-cache the view is drawn through a glyph cache with the given budget
+// as well as through one that can hold every glyph, and the two must come out the
+// same: the budget may change how often glyphs are rendered, never what is drawn.
+// The image written is the one drawn through the small cache.  Exits with 1 if the
+// two differ.
+
+
+// Draws the view through a new glyph cache with the given budget
+//
+static int DrawWithGlyphCache(RasterBuffer *buffer, HeadlessParams *params, size_t budget)
+{
+    GlyphCache          cache;
+    int                 result;
+
+    if (GlyphCacheInit(&cache, budget, NULL) != 0) return -1;
+    params->glyphCache = &cache;
+    RasterBufferClear(buffer);
+    result = HeadlessDrawComparison(buffer, params, NULL);
+    params->glyphCache = NULL;
+    GlyphCacheDispose(&cache);
+    return result;
+}
+
+
+// Returns the number of pixels that differ between two buffers of the same size
+//
+static long CountDifferentPixels(const RasterBuffer *a, const RasterBuffer *b)
+{
+    long                count = 0;
+    int                 x, y;
+
+    for (y = 0; y < a->height; y++) {
+        for (x = 0; x < a->width; x++) {
+            if (a->pixels[y * a->rowBytes + x] != b->pixels[y * b->rowBytes + x])
+                count++;
+        }
+    }
+    return count;
+}
+
+
+int main(int argc, char* argv[])
+{
+    FontFile            font;
+    HeadlessParams      params;
+    RasterBuffer        buffer, reference;
+    unsigned short      *text;
+    int                 width = 640, height = 240;
+    int                 result, emboldenMethod = kHeadlessEmboldenOutline;
+    long                checkBudget = -1, differences = 0;
+
+    // The options are taken off the front of argv
+    while (argc >= 2 && argv[1][0] == '-') {
+        if (strcmp(argv[1], "-dilate") == 0) {
+            emboldenMethod = kHeadlessEmboldenDilate;
+            argv[1] = argv[0];
+            argc--;
+            argv++;
+        } else if (strcmp(argv[1], "-check-cache") == 0 && argc >= 3) {
+            checkBudget = atol(argv[2]);
+            argv[2] = argv[0];
+            argc -= 2;
+            argv += 2;
+        } else
+            break;
+    }
+    if (argc < 6) {
+        fprintf(stderr, "usage: %s [-dilate] [-check-cache bytes] font.ttf size factor text out.pgm [width height [threshold]]\n", argv[0]);
+        return 2;
+    }
+    if (argc >= 8) {
+        width = atoi(argv[6]);
+        height = atoi(argv[7]);
+    }
+
+    if (FontFileOpen(&font, argv[1]) != 0) {
+        fprintf(stderr, "%s: cannot read TrueType font %s\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    text = (unsigned short *) malloc((strlen(argv[4]) + 1) * 2 * sizeof(unsigned short));
+    if (text == NULL || RasterBufferCreate(&buffer, width, height) != 0) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+
+    params.font = &font;
+    params.text = text;
+    params.length = HeadlessDecodeUTF8(argv[4], text);
+    params.pointSize = (float) atof(argv[2]);
+    params.strokeThicknessFactor = (float) atof(argv[3]);
+    params.antiAliasingThreshold = (argc >= 9) ? atoi(argv[8]) : -1;
+    params.printing = 0;
+    params.emboldenMethod = emboldenMethod;
+    params.glyphCache = NULL;
+
+    if (checkBudget < 0)
+        result = HeadlessDrawComparison(&buffer, &params, NULL);
+    else {
+        result = RasterBufferCreate(&reference, width, height);
+        if (result == 0) {
+            result = DrawWithGlyphCache(&reference, &params, (size_t) width * height * 256);
+            if (result == 0)
+                result = DrawWithGlyphCache(&buffer, &params, (size_t) checkBudget);
+            if (result == 0)
+                differences = CountDifferentPixels(&buffer, &reference);
+            RasterBufferDispose(&reference);
+        }
+    }
+    if (result == 0)
+        result = RasterBufferWritePGM(&buffer, argv[5]);
+    if (result != 0)
+        fprintf(stderr, "%s: rendering failed\n", argv[0]);
+    else if (differences != 0)
+        fprintf(stderr, "%s: %ld pixels differ with a %ld byte glyph cache\n", argv[0], differences, checkBudget);
+
+    RasterBufferDispose(&buffer);
+    FontFileDispose(&font);
+    free(text);
+    return (result == 0 && differences == 0) ? 0 : 1;
+}
@@ -0,0 +1,319 @@
+/*
+
+File: sbsweep.c
+
+Abstract: Command line tool that renders the synthetic bold comparison for
+every combination of font, size, stroke factor and string on a thread pool.
+Has no Carbon dependencies.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headless.h"
+#include "taskpool.h"
+
+// Batch version of sbrender for calibrating the stroke factor.  Renders the
+// comparison view for every combination of font, point size, stroke factor and
+// string on a pool of threads, and writes one PGM per render plus a CSV of the
+// render times to the output directory.
+//
+//     sbsweep [-j threads] [-size WxH] [-dilate] -o outdir
+//             -font a.ttf [-font b.ttf ...] -sizes 9,12,24 -factors 0.01,0.024 -text "Hello" [-text ...]
+//
+// The output directory must exist.  On Linux the tool builds with:
+//
+//     cc -O2 -o sbsweep sbsweep.c taskpool.c headless.c fontfile.c outline.c raster.c dilate.c glyphcache.c -lm -lpthread
+
+#define kMaxListItems           256
+
+// One render
+//
+typedef struct {
+    const FontFile          *font;
+    const char              *fontName;          // Used to name the image
+    int                     fontIndex;
+    float                   pointSize;
+    float                   strokeThicknessFactor;
+    const unsigned short    *text;
+    size_t                  length;
+    int                     textIndex;
+    char                    fileName[1024];
+    unsigned long long      renderTime;         // Nanoseconds spent in HeadlessDrawComparison()
+    int                     result;
+} SweepJob;
+
+// Settings shared by every render, plus per-thread scratch space
+//
+typedef struct {
+    int                     width;
+    int                     height;
+    int                     emboldenMethod;
+    RasterBuffer            *buffers;           // One per worker
+    GlyphCache              *glyphCaches;       // One per worker
+} SweepContext;
+
+static SweepContext         gSweep;
+
+
+// Splits a comma-separated list of numbers.  Returns the number of items.
+//
+static int ParseList(const char *s, float *items)
+{
+    int             count = 0;
+
+    while (*s != 0 && count < kMaxListItems) {
+        char        *end;
+
+        items[count] = (float) strtod(s, &end);
+        if (end == s) break;
+        count++;
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+
+// The file name of a font without its directory or extension
+//
+static void GetBaseName(const char *path, char *out, size_t size)
+{
+    const char      *start = strrchr(path, '/');
+    const char      *dot;
+    size_t          length;
+
+    start = (start != NULL) ? start + 1 : path;
+    dot = strrchr(start, '.');
+    length = (dot != NULL && dot > start) ? (size_t) (dot - start) : strlen(start);
+    if (length >= size) length = size - 1;
+    memcpy(out, start, length);
+    out[length] = 0;
+}
+
+
+static void RunSweepJob(void *arg, int worker)
+{
+    SweepJob            *job = (SweepJob *) arg;
+    RasterBuffer        *buffer = &gSweep.buffers[worker];
+    HeadlessParams      params;
+    unsigned long long  start;
+
+    params.font = job->font;
+    params.text = job->text;
+    params.length = job->length;
+    params.pointSize = job->pointSize;
+    params.strokeThicknessFactor = job->strokeThicknessFactor;
+    params.antiAliasingThreshold = -1;
+    params.printing = 0;
+    params.emboldenMethod = gSweep.emboldenMethod;
+    params.glyphCache = &gSweep.glyphCaches[worker];
+
+    RasterBufferClear(buffer);
+    start = HeadlessGetNanoseconds();
+    job->result = HeadlessDrawComparison(buffer, &params, NULL);
+    job->renderTime = HeadlessGetNanoseconds() - start;
+
+    if (job->result == 0)
+        job->result = RasterBufferWritePGM(buffer, job->fileName);
+}
+
+
+static void PrintUsage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-j threads] [-size WxH] [-dilate] -o outdir -font a.ttf [-font ...]\n"
+                    "       -sizes 9,12,24 -factors 0.01,0.024 -text string [-text ...]\n", name);
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char          *fontNames[kMaxListItems], *texts[kMaxListItems], *outDir = NULL;
+    FontFile            fonts[kMaxListItems];
+    unsigned short      *utf16[kMaxListItems];
+    size_t              lengths[kMaxListItems];
+    float               sizes[kMaxListItems], factors[kMaxListItems];
+    int                 numFonts = 0, numTexts = 0, numSizes = 0, numFactors = 0;
+    int                 numThreads = TaskPoolDefaultThreadCount();
+    int                 i, f, s, k, t, numJobs, failures = 0;
+    SweepJob            *jobs;
+    TaskPool            pool;
+    FILE                *csv;
+    char                csvName[1024];
+    unsigned long long  start, elapsed;
+
+    gSweep.width = 640;
+    gSweep.height = 240;
+    gSweep.emboldenMethod = kHeadlessEmboldenOutline;
+
+    for (i = 1; i < argc; i++) {
+        int     hasValue = (i + 1 < argc);
+
+        if (strcmp(argv[i], "-dilate") == 0)
+            gSweep.emboldenMethod = kHeadlessEmboldenDilate;
+        else if (hasValue && strcmp(argv[i], "-j") == 0)
+            numThreads = atoi(argv[++i]);
+        else if (hasValue && strcmp(argv[i], "-size") == 0)
+            sscanf(argv[++i], "%dx%d", &gSweep.width, &gSweep.height);
+        else if (hasValue && strcmp(argv[i], "-o") == 0)
+            outDir = argv[++i];
+        else if (hasValue && strcmp(argv[i], "-font") == 0 && numFonts < kMaxListItems)
+            fontNames[numFonts++] = argv[++i];
+        else if (hasValue && strcmp(argv[i], "-text") == 0 && numTexts < kMaxListItems)
+            texts[numTexts++] = argv[++i];
+        else if (hasValue && strcmp(argv[i], "-sizes") == 0)
+            numSizes = ParseList(argv[++i], sizes);
+        else if (hasValue && strcmp(argv[i], "-factors") == 0)
+            numFactors = ParseList(argv[++i], factors);
+        else {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (outDir == NULL || numFonts == 0 || numTexts == 0 || numSizes == 0 || numFactors == 0
+        || gSweep.width <= 0 || gSweep.height <= 0) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+    if (numThreads < 1) numThreads = 1;
+
+    // Load everything up front; the fonts and strings are shared read-only by all threads
+    for (f = 0; f < numFonts; f++) {
+        if (FontFileOpen(&fonts[f], fontNames[f]) != 0) {
+            fprintf(stderr, "%s: cannot read TrueType font %s\n", argv[0], fontNames[f]);
+            return 1;
+        }
+    }
+    for (t = 0; t < numTexts; t++) {
+        utf16[t] = (unsigned short *) malloc((strlen(texts[t]) + 1) * 2 * sizeof(unsigned short));
+        if (utf16[t] == NULL) return 1;
+        lengths[t] = HeadlessDecodeUTF8(texts[t], utf16[t]);
+    }
+
+    numJobs = numFonts * numSizes * numFactors * numTexts;
+    jobs = (SweepJob *) calloc(numJobs, sizeof(SweepJob));
+    gSweep.buffers = (RasterBuffer *) calloc(numThreads, sizeof(RasterBuffer));
+    gSweep.glyphCaches = (GlyphCache *) calloc(numThreads, sizeof(GlyphCache));
+    if (jobs == NULL || gSweep.buffers == NULL || gSweep.glyphCaches == NULL) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+    for (i = 0; i < numThreads; i++) {
+        if (RasterBufferCreate(&gSweep.buffers[i], gSweep.width, gSweep.height) != 0
+            || GlyphCacheInit(&gSweep.glyphCaches[i], kGlyphCacheDefaultBudget, NULL) != 0) {
+            fprintf(stderr, "%s: out of memory\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (TaskPoolCreate(&pool, numThreads) != 0) {
+        fprintf(stderr, "%s: cannot start threads\n", argv[0]);
+        return 1;
+    }
+
+    // Queue every combination.  Consecutive jobs share a font and size, which keeps
+    // each thread's glyph cache warm.  Images are named with the font's place on the
+    // command line too, since fonts in different directories can share a file name.
+    start = HeadlessGetNanoseconds();
+    i = 0;
+    for (f = 0; f < numFonts; f++) {
+        char    baseName[256];
+
+        GetBaseName(fontNames[f], baseName, sizeof(baseName));
+        for (s = 0; s < numSizes; s++)
+            for (k = 0; k < numFactors; k++)
+                for (t = 0; t < numTexts; t++, i++) {
+                    SweepJob    *job = &jobs[i];
+
+                    job->font = &fonts[f];
+                    job->fontName = fontNames[f];
+                    job->fontIndex = f;
+                    job->pointSize = sizes[s];
+                    job->strokeThicknessFactor = factors[k];
+                    job->text = utf16[t];
+                    job->length = lengths[t];
+                    job->textIndex = t;
+                    snprintf(job->fileName, sizeof(job->fileName), "%s/%d-%s-%g-%g-%d.pgm",
+                             outDir, f, baseName, sizes[s], factors[k], t);
+                    TaskPoolSubmit(&pool, RunSweepJob, job);
+                }
+    }
+    TaskPoolWait(&pool);
+    elapsed = HeadlessGetNanoseconds() - start;
+    TaskPoolDispose(&pool);
+
+    // Write the timings in submission order so runs can be compared line by line
+    snprintf(csvName, sizeof(csvName), "%s/timings.csv", outDir);
+    csv = fopen(csvName, "w");
+    if (csv == NULL) {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], csvName);
+        return 1;
+    }
+    fprintf(csv, "font,size,factor,text,image,render_us,status\n");
+    for (i = 0; i < numJobs; i++) {
+        fprintf(csv, "\"%s\",%g,%g,%d,\"%s\",%.1f,%s\n", jobs[i].fontName, jobs[i].pointSize,
+                jobs[i].strokeThicknessFactor, jobs[i].textIndex, jobs[i].fileName,
+                jobs[i].renderTime / 1000.0, (jobs[i].result == 0) ? "ok" : "failed");
+        if (jobs[i].result != 0) failures++;
+    }
+    fclose(csv);
+
+    fprintf(stderr, "%d renders on %d threads in %.3f s (%.0f renders/min), %d failed\n",
+            numJobs, numThreads, elapsed / 1e9, numJobs / (elapsed / 6e10), failures);
+
+    for (i = 0; i < numThreads; i++) {
+        RasterBufferDispose(&gSweep.buffers[i]);
+        GlyphCacheDispose(&gSweep.glyphCaches[i]);
+    }
+    for (f = 0; f < numFonts; f++)
+        FontFileDispose(&fonts[f]);
+    for (t = 0; t < numTexts; t++)
+        free(utf16[t]);
+    free(gSweep.buffers);
+    free(gSweep.glyphCaches);
+    free(jobs);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,342 @@
+/*
+
+File: strokecal.c
+
+Abstract: Stroke factors measured for each font, kept in a file
+that is computed offline.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "strokecal.h"
+
+// The file starts with a header, then the hash slots, the records and the
+// strings.  Every number is a big-endian 32-bit word.  A slot holds one more than
+// the number of the record it points to, or zero if it is empty; there is always
+// at least one empty slot, so a search for a missing name ends.  A record is the
+// hash of the name, the offset of the name in the strings, and a factor for each
+// band in millionths.
+//
+#define kStrokeCalibrationMagic         0x53425354      // 'SBST'
+#define kStrokeCalibrationVersion       1
+#define kHeaderWords                    6
+#define kRecordWords                    (2 + kStrokeCalibrationNumBands)
+#define kFactorScale                    1000000.0f
+
+static const float gBandEdges[kStrokeCalibrationNumBands - 1] = kStrokeCalibrationBandEdges;
+
+
+static unsigned int ReadWord(const unsigned char *p)
+{
+    return ((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16) | ((unsigned int) p[2] << 8) | p[3];
+}
+
+
+static void WriteWord(unsigned char *p, unsigned int value)
+{
+    p[0] = (unsigned char) (value >> 24);
+    p[1] = (unsigned char) (value >> 16);
+    p[2] = (unsigned char) (value >> 8);
+    p[3] = (unsigned char) value;
+}
+
+
+// FNV-1a.  The file depends on it, so it must not change without a new version.
+//
+static unsigned int HashName(const char *name)
+{
+    unsigned int        hash = 2166136261u;
+
+    while (*name != 0)
+        hash = (hash ^ (unsigned char) *name++) * 16777619u;
+    return hash;
+}
+
+
+// Returns the band a point size falls in
+//
+int StrokeCalibrationGetBand(float pointSize)
+{
+    int                 band = 0;
+
+    while (band < kStrokeCalibrationNumBands - 1 && pointSize >= gBandEdges[band])
+        band++;
+    return band;
+}
+
+
+// Returns the point size a band is measured at: the middle of the band, or for the
+// open-ended bands at either end, a size a little way into them
+//
+float StrokeCalibrationGetBandSize(int band)
+{
+    if (band <= 0)
+        return gBandEdges[0] - 1;
+    if (band >= kStrokeCalibrationNumBands - 1)
+        return gBandEdges[kStrokeCalibrationNumBands - 2] * 4 / 3;
+    return (gBandEdges[band - 1] + gBandEdges[band]) / 2;
+}
+
+
+int StrokeCalibrationOpen(StrokeCalibration *table, const char *fileName)
+{
+    struct stat         info;
+    size_t              expected;
+    unsigned int        numFonts, numSlots, numBands, stringsSize;
+    void                *bytes;
+    int                 fd;
+
+    memset(table, 0, sizeof(StrokeCalibration));
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0) return -1;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < 4 * kHeaderWords) {
+        close(fd);
+        return -1;
+    }
+    bytes = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (bytes == MAP_FAILED) return -1;
+
+    table->bytes = (const unsigned char *) bytes;
+    table->size = (size_t) info.st_size;
+
+    // Check the header and that the parts add up to the size of the file
+    numFonts = ReadWord(table->bytes + 8);
+    numSlots = ReadWord(table->bytes + 12);
+    numBands = ReadWord(table->bytes + 16);
+    stringsSize = ReadWord(table->bytes + 20);
+    expected = 4 * (kHeaderWords + (size_t) numSlots + (size_t) numFonts * kRecordWords) + stringsSize;
+    if (ReadWord(table->bytes) != kStrokeCalibrationMagic || ReadWord(table->bytes + 4) != kStrokeCalibrationVersion
+        || numBands != kStrokeCalibrationNumBands || numFonts > table->size || numSlots > table->size
+        || numSlots <= numFonts || (numSlots & (numSlots - 1)) != 0
+        || expected != table->size || stringsSize == 0) {
+        StrokeCalibrationDispose(table);
+        return -1;
+    }
+
+    table->numFonts = numFonts;
+    table->numSlots = numSlots;
+    table->slots = table->bytes + 4 * kHeaderWords;
+    table->records = table->slots + 4 * (size_t) numSlots;
+    table->strings = (const char *) (table->records + 4 * (size_t) numFonts * kRecordWords);
+    table->stringsSize = stringsSize;
+
+    // Every string must end inside the file
+    if (table->strings[stringsSize - 1] != '\0') {
+        StrokeCalibrationDispose(table);
+        return -1;
+    }
+    return 0;
+}
+
+
+void StrokeCalibrationDispose(StrokeCalibration *table)
+{
+    if (table->bytes != NULL)
+        munmap((void *) table->bytes, table->size);
+    memset(table, 0, sizeof(StrokeCalibration));
+}
+
+
+// Looks up the stroke factor for a font at a point size.  Returns zero if the font
+// is in the table, -1 if it is not; a factor of zero is a real measurement.
+//
+int StrokeCalibrationLookup(const StrokeCalibration *table, const char *name, float pointSize, float *outFactor)
+{
+    unsigned int        hash, slot, probes;
+
+    if (table->bytes == NULL) return -1;
+
+    hash = HashName(name);
+    for (slot = hash & (table->numSlots - 1), probes = 0; probes < table->numSlots;
+         slot = (slot + 1) & (table->numSlots - 1), probes++) {
+        unsigned int        index = ReadWord(table->slots + 4 * slot);
+        const unsigned char *record;
+        unsigned int        nameOffset;
+
+        if (index == 0 || index > table->numFonts) return -1;
+        record = table->records + 4 * (size_t) (index - 1) * kRecordWords;
+        if (ReadWord(record) != hash) continue;
+        nameOffset = ReadWord(record + 4);
+        if (nameOffset < table->stringsSize && strcmp(table->strings + nameOffset, name) == 0) {
+            *outFactor = ReadWord(record + 8 + 4 * StrokeCalibrationGetBand(pointSize)) / kFactorScale;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+void StrokeCalibrationBuilderInit(StrokeCalibrationBuilder *builder)
+{
+    memset(builder, 0, sizeof(StrokeCalibrationBuilder));
+}
+
+
+void StrokeCalibrationBuilderDispose(StrokeCalibrationBuilder *builder)
+{
+    size_t              i;
+
+    for (i = 0; i < builder->numEntries; i++)
+        free(builder->entries[i].name);
+    free(builder->entries);
+    StrokeCalibrationBuilderInit(builder);
+}
+
+
+// Adds a font with a factor for each band.  The name is copied.  Adding a font
+// that is already there replaces its factors.  Returns zero on success.
+//
+int StrokeCalibrationBuilderAddFont(StrokeCalibrationBuilder *builder, const char *name, const float *factors)
+{
+    StrokeCalibrationEntry *entry;
+    size_t              i;
+
+    for (i = 0; i < builder->numEntries; i++) {
+        if (strcmp(builder->entries[i].name, name) == 0) {
+            memcpy(builder->entries[i].factors, factors, sizeof(builder->entries[i].factors));
+            return 0;
+        }
+    }
+
+    if (builder->numEntries == builder->entryCapacity) {
+        size_t              newCapacity = (builder->entryCapacity == 0) ? 64 : builder->entryCapacity * 2;
+        StrokeCalibrationEntry *newEntries = (StrokeCalibrationEntry *) realloc(builder->entries, newCapacity * sizeof(StrokeCalibrationEntry));
+
+        if (newEntries == NULL) return -1;
+        builder->entries = newEntries;
+        builder->entryCapacity = newCapacity;
+    }
+
+    entry = &builder->entries[builder->numEntries];
+    entry->name = (char *) malloc(strlen(name) + 1);
+    if (entry->name == NULL) return -1;
+    strcpy(entry->name, name);
+    memcpy(entry->factors, factors, sizeof(entry->factors));
+    builder->numEntries++;
+    return 0;
+}
+
+
+// Writes the table to a file, replacing any table already there only once the new
+// one is complete.  The hash table is kept at most half full.  Returns zero on success.
+//
+int StrokeCalibrationBuilderWrite(const StrokeCalibrationBuilder *builder, const char *fileName)
+{
+    unsigned int        numSlots = 16, stringsSize = 1;
+    unsigned char       *data = NULL, *slots, *records;
+    char                *strings, *tempName = NULL;
+    size_t              size, i;
+    int                 band, result = -1;
+    FILE                *file;
+
+    while (numSlots < 2 * builder->numEntries)
+        numSlots *= 2;
+    for (i = 0; i < builder->numEntries; i++)
+        stringsSize += (unsigned int) strlen(builder->entries[i].name) + 1;
+
+    size = 4 * (kHeaderWords + (size_t) numSlots + builder->numEntries * kRecordWords) + stringsSize;
+    data = (unsigned char *) calloc(1, size);
+    tempName = (char *) malloc(strlen(fileName) + 8);
+    if (data == NULL || tempName == NULL)
+        goto done;
+
+    WriteWord(data, kStrokeCalibrationMagic);
+    WriteWord(data + 4, kStrokeCalibrationVersion);
+    WriteWord(data + 8, (unsigned int) builder->numEntries);
+    WriteWord(data + 12, numSlots);
+    WriteWord(data + 16, kStrokeCalibrationNumBands);
+    WriteWord(data + 20, stringsSize);
+    slots = data + 4 * kHeaderWords;
+    records = slots + 4 * (size_t) numSlots;
+    strings = (char *) (records + 4 * builder->numEntries * kRecordWords);
+
+    // The strings start with an empty one, so no name is ever at offset zero
+    stringsSize = 1;
+    for (i = 0; i < builder->numEntries; i++) {
+        const StrokeCalibrationEntry *entry = &builder->entries[i];
+        unsigned char       *record = records + 4 * i * kRecordWords;
+        unsigned int        hash = HashName(entry->name), slot;
+
+        WriteWord(record, hash);
+        WriteWord(record + 4, stringsSize);
+        for (band = 0; band < kStrokeCalibrationNumBands; band++) {
+            float           factor = (entry->factors[band] > 0) ? entry->factors[band] : 0;
+
+            WriteWord(record + 8 + 4 * band, (unsigned int) (factor * kFactorScale + 0.5f));
+        }
+        strcpy(strings + stringsSize, entry->name);
+        stringsSize += (unsigned int) strlen(entry->name) + 1;
+
+        for (slot = hash & (numSlots - 1); ReadWord(slots + 4 * slot) != 0; slot = (slot + 1) & (numSlots - 1))
+            ;
+        WriteWord(slots + 4 * slot, (unsigned int) i + 1);
+    }
+
+    sprintf(tempName, "%s.new", fileName);
+    file = fopen(tempName, "wb");
+    if (file == NULL) goto done;
+    if (fwrite(data, 1, size, file) == size)
+        result = 0;
+    if (fclose(file) != 0)
+        result = -1;
+    if (result == 0 && rename(tempName, fileName) != 0)
+        result = -1;
+    if (result != 0)
+        unlink(tempName);
+
+done:
+    free(data);
+    free(tempName);
+    return result;
+}
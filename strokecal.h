@@ -0,0 +1,110 @@
+/*
+
+File: strokecal.h
+
+Abstract: Stroke factors measured for each font, kept in a file
+that is computed offline.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_STROKECAL_H
+#define MY_STROKECAL_H
+
+// A table of the stroke factor that makes each font's synthetic bold as heavy as
+// its real bold face, for a few bands of point sizes.  The table is computed
+// offline by sbcalibrate and loaded when the app starts; the file is mapped, not
+// read, and a font is found by its PostScript name through a hash table in the
+// file, so looking up a factor takes the same time however many fonts it holds.
+// Numbers are stored big-endian, so a table can be made on any machine.  Plain C
+// with no Carbon dependencies.
+
+#include <stddef.h>
+
+// The point sizes the bands start at.  Band 0 is everything below the first edge
+// and the last band everything from the last edge up.
+//
+#define kStrokeCalibrationNumBands      7
+#define kStrokeCalibrationBandEdges     { 10, 14, 18, 24, 36, 72 }
+
+// A table file, mapped
+//
+typedef struct {
+    const unsigned char *bytes;             // NULL if there is no table
+    size_t              size;
+    unsigned int        numFonts;
+    unsigned int        numSlots;           // A power of two
+    const unsigned char *slots;
+    const unsigned char *records;
+    const char          *strings;
+    unsigned int        stringsSize;
+} StrokeCalibration;
+
+// One font's factors, while a table is put together
+//
+typedef struct {
+    char                *name;              // PostScript name
+    float               factors[kStrokeCalibrationNumBands];
+} StrokeCalibrationEntry;
+
+typedef struct {
+    StrokeCalibrationEntry *entries;
+    size_t              numEntries;
+    size_t              entryCapacity;
+} StrokeCalibrationBuilder;
+
+
+int StrokeCalibrationGetBand(float pointSize);
+float StrokeCalibrationGetBandSize(int band);
+
+int StrokeCalibrationOpen(StrokeCalibration *table, const char *fileName);
+void StrokeCalibrationDispose(StrokeCalibration *table);
+int StrokeCalibrationLookup(const StrokeCalibration *table, const char *name, float pointSize, float *outFactor);
+
+void StrokeCalibrationBuilderInit(StrokeCalibrationBuilder *builder);
+void StrokeCalibrationBuilderDispose(StrokeCalibrationBuilder *builder);
+int StrokeCalibrationBuilderAddFont(StrokeCalibrationBuilder *builder, const char *name, const float *factors);
+int StrokeCalibrationBuilderWrite(const StrokeCalibrationBuilder *builder, const char *fileName);
+
+#endif  /* MY_STROKECAL_H */
@@ -0,0 +1,361 @@
+/*
+
+File: stylepool.c
+
+Abstract: Interned text styles and style runs for SyntheticBoldDemo
+project.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "stylepool.h"
+
+
+void StylePoolInit(StylePool *pool)
+{
+    memset(pool, 0, sizeof(StylePool));
+}
+
+
+void StylePoolDispose(StylePool *pool)
+{
+    free(pool->styles);
+    free(pool->slots);
+    StylePoolInit(pool);
+}
+
+
+// Attributes are compared field by field; the padding between them is never looked at
+//
+static int SameAttributes(const StyleAttributes *a, const StyleAttributes *b)
+{
+    return a->font == b->font && a->size == b->size && a->realBold == b->realBold
+        && a->syntheticBold == b->syntheticBold && a->strokeFactor == b->strokeFactor;
+}
+
+
+static size_t HashAttributes(const StyleAttributes *attributes)
+{
+    unsigned long       hash;
+    unsigned int        factor;
+
+    memcpy(&factor, &attributes->strokeFactor, sizeof(factor));
+    hash = attributes->font * 2654435761UL;
+    hash ^= (unsigned long) attributes->size * 40503UL;
+    hash ^= (unsigned long) factor * 97UL;
+    hash ^= (attributes->realBold << 1) | attributes->syntheticBold;
+    return (size_t) (hash ^ (hash >> 16));
+}
+
+
+// Returns the slot that holds the style with these attributes, or the empty slot it
+// would go in
+//
+static StyleID *FindSlot(const StylePool *pool, const StyleAttributes *attributes)
+{
+    size_t              i = HashAttributes(attributes) & (pool->numSlots - 1);
+
+    while (pool->slots[i] != kNoStyle && ! SameAttributes(&pool->styles[pool->slots[i]], attributes))
+        i = (i + 1) & (pool->numSlots - 1);
+    return &pool->slots[i];
+}
+
+
+// Doubles the hash table once it is half full
+//
+static int GrowSlots(StylePool *pool)
+{
+    size_t              numSlots = (pool->numSlots == 0) ? 64 : pool->numSlots * 2;
+    StyleID             *slots = (StyleID *) malloc(numSlots * sizeof(StyleID));
+    size_t              i;
+
+    if (slots == NULL) return -1;
+    for (i = 0; i < numSlots; i++)
+        slots[i] = kNoStyle;
+
+    free(pool->slots);
+    pool->slots = slots;
+    pool->numSlots = numSlots;
+    for (i = 0; i < pool->count; i++)
+        *FindSlot(pool, &pool->styles[i]) = (StyleID) i;
+    return 0;
+}
+
+
+// Returns the style with the given attributes, adding it to the pool if it is not
+// there yet.  The stroke factor only counts for synthetic bold.  Returns kNoStyle
+// if the pool is full or out of memory.
+//
+StyleID StylePoolIntern(StylePool *pool, const StyleAttributes *attributes)
+{
+    StyleAttributes     key;
+    StyleID             *slot;
+
+    memset(&key, 0, sizeof(key));
+    key.font = attributes->font;
+    key.size = attributes->size;
+    key.realBold = (attributes->realBold != 0);
+    key.syntheticBold = (attributes->syntheticBold != 0);
+    key.strokeFactor = key.syntheticBold ? attributes->strokeFactor : 0;
+
+    if (pool->numSlots != 0) {
+        slot = FindSlot(pool, &key);
+        if (*slot != kNoStyle)
+            return *slot;
+    }
+
+    if (pool->count == kNoStyle)
+        return kNoStyle;
+    if ((pool->count + 1) * 2 > pool->numSlots && GrowSlots(pool) != 0)
+        return kNoStyle;
+    if (pool->count == pool->capacity) {
+        size_t          newCapacity = (pool->capacity == 0) ? 32 : pool->capacity * 2;
+        StyleAttributes *newStyles = (StyleAttributes *) realloc(pool->styles, newCapacity * sizeof(StyleAttributes));
+
+        if (newStyles == NULL) return kNoStyle;
+        pool->styles = newStyles;
+        pool->capacity = newCapacity;
+    }
+
+    pool->styles[pool->count] = key;
+    *FindSlot(pool, &key) = (StyleID) pool->count;
+    return (StyleID) pool->count++;
+}
+
+
+void StyleRunsInit(StyleRuns *runs)
+{
+    memset(runs, 0, sizeof(StyleRuns));
+}
+
+
+void StyleRunsDispose(StyleRuns *runs)
+{
+    free(runs->runs);
+    StyleRunsInit(runs);
+}
+
+
+// Makes room for 'extra' more runs
+//
+static int ReserveRuns(StyleRuns *runs, size_t extra)
+{
+    if (runs->count + extra > runs->capacity) {
+        size_t          newCapacity = runs->count + extra + runs->count / 2 + 8;
+        StyleRun        *newRuns = (StyleRun *) realloc(runs->runs, newCapacity * sizeof(StyleRun));
+
+        if (newRuns == NULL) return -1;
+        runs->runs = newRuns;
+        runs->capacity = newCapacity;
+    }
+    return 0;
+}
+
+
+// Returns the index of the run that contains 'offset', or the number of runs if it
+// is at or past the end of the text.  A binary search, since a long document can
+// have thousands of runs.
+//
+size_t StyleRunsFind(const StyleRuns *runs, size_t offset)
+{
+    size_t              low = 0, high = runs->count;
+
+    if (offset >= runs->length)
+        return runs->count;
+    while (high - low > 1) {
+        size_t          middle = (low + high) / 2;
+
+        if (runs->runs[middle].start <= offset)
+            low = middle;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+
+// Makes sure a run starts at 'offset', splitting the run it falls in.  Returns the
+// index of that run.  There must be room for one more run.
+//
+static size_t SplitRun(StyleRuns *runs, size_t offset)
+{
+    size_t              i = StyleRunsFind(runs, offset);
+    StyleRun            *run;
+
+    if (i == runs->count || runs->runs[i].start == offset)
+        return i;
+
+    run = &runs->runs[i];
+    memmove(run + 2, run + 1, (runs->count - i - 1) * sizeof(StyleRun));
+    run[1].start = offset;
+    run[1].length = run->start + run->length - offset;
+    run[1].style = run->style;
+    run->length = offset - run->start;
+    runs->count++;
+    return i + 1;
+}
+
+
+// Joins neighbouring runs in the same style and drops empty ones
+//
+static void MergeRuns(StyleRuns *runs)
+{
+    size_t              from, to = 0;
+
+    for (from = 0; from < runs->count; from++) {
+        if (runs->runs[from].length == 0)
+            continue;
+        if (to > 0 && runs->runs[to - 1].style == runs->runs[from].style)
+            runs->runs[to - 1].length += runs->runs[from].length;
+        else
+            runs->runs[to++] = runs->runs[from];
+    }
+    runs->count = to;
+}
+
+
+// Sets 'length' units of the text at 'start' in 'style'.  The range is clipped to
+// the text.  Returns zero on success; on failure the runs are unchanged.
+//
+int StyleRunsSet(StyleRuns *runs, size_t start, size_t length, StyleID style)
+{
+    size_t              first, last;
+
+    if (start >= runs->length || length == 0)
+        return 0;
+    if (length > runs->length - start)
+        length = runs->length - start;
+    if (ReserveRuns(runs, 2) != 0)
+        return -1;
+
+    first = SplitRun(runs, start);
+    last = SplitRun(runs, start + length);
+
+    // The runs from 'first' up to 'last' become one
+    runs->runs[first].length = length;
+    runs->runs[first].style = style;
+    memmove(&runs->runs[first + 1], &runs->runs[last], (runs->count - last) * sizeof(StyleRun));
+    runs->count -= last - first - 1;
+    MergeRuns(runs);
+    return 0;
+}
+
+
+// Brings the runs up to date with an edit to the text: the units from 'start' to
+// 'start + oldLength' were replaced with 'newLength' new ones.  The new text takes
+// the style of the text before it, or after it at the start of the text;
+// 'defaultStyle' is only used when there is no text left to take it from.
+//
+int StyleRunsEdit(StyleRuns *runs, size_t start, size_t oldLength, size_t newLength, StyleID defaultStyle)
+{
+    StyleID             style = defaultStyle;
+    size_t              i, first, last;
+
+    if (start > runs->length)
+        start = runs->length;
+    if (oldLength > runs->length - start)
+        oldLength = runs->length - start;
+    if (ReserveRuns(runs, 3) != 0)
+        return -1;
+
+    if (runs->count > 0)
+        style = runs->runs[(start > 0) ? StyleRunsFind(runs, start - 1) : 0].style;
+
+    // Take out the deleted units, and move the runs after them
+    if (oldLength > 0) {
+        first = SplitRun(runs, start);
+        last = SplitRun(runs, start + oldLength);
+        memmove(&runs->runs[first], &runs->runs[last], (runs->count - last) * sizeof(StyleRun));
+        runs->count -= last - first;
+        for (i = first; i < runs->count; i++)
+            runs->runs[i].start -= oldLength;
+        runs->length -= oldLength;
+    }
+
+    // Put the new ones in a run of their own, which MergeRuns() joins to its neighbour
+    if (newLength > 0) {
+        first = SplitRun(runs, start);
+        memmove(&runs->runs[first + 1], &runs->runs[first], (runs->count - first) * sizeof(StyleRun));
+        runs->runs[first].start = start;
+        runs->runs[first].length = newLength;
+        runs->runs[first].style = style;
+        runs->count++;
+        for (i = first + 1; i < runs->count; i++)
+            runs->runs[i].start += newLength;
+        runs->length += newLength;
+    }
+
+    MergeRuns(runs);
+    return 0;
+}
+
+
+// Moves all the text in 'oldStyle' to 'newStyle'
+//
+void StyleRunsReplaceStyle(StyleRuns *runs, StyleID oldStyle, StyleID newStyle)
+{
+    size_t              i;
+
+    for (i = 0; i < runs->count; i++) {
+        if (runs->runs[i].style == oldStyle)
+            runs->runs[i].style = newStyle;
+    }
+    MergeRuns(runs);
+}
+
+
+// Moves the text in each style to map[style], for when the styles have been put in
+// a new pool
+//
+void StyleRunsMapStyles(StyleRuns *runs, const StyleID *map)
+{
+    size_t              i;
+
+    for (i = 0; i < runs->count; i++)
+        runs->runs[i].style = map[runs->runs[i].style];
+    MergeRuns(runs);
+}
@@ -0,0 +1,121 @@
+/*
+
+File: stylepool.h
+
+Abstract: Interned text styles and style runs for SyntheticBoldDemo
+project.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+
+#ifndef MY_STYLEPOOL_H
+#define MY_STYLEPOOL_H
+
+// The styles text is set in.  Each distinct set of attributes is stored once in a
+// pool and named by a small integer, so runs that look the same share one style,
+// and whatever is cached per style can use the number as its key.  Styles never
+// change once they are in the pool.  Plain C with no Carbon dependencies.
+
+#include <stddef.h>
+
+typedef unsigned short StyleID;
+
+#define kNoStyle            ((StyleID) 0xFFFF)
+
+// The attributes that make up a style
+//
+typedef struct {
+    unsigned long       font;               // ATSUFontID
+    long                size;               // Point size, as a Fixed
+    unsigned char       realBold;           // Set in the bold face of the font's family
+    unsigned char       syntheticBold;      // Emboldened by stroking the outlines
+    float               strokeFactor;       // With syntheticBold, the stroke width / point size
+} StyleAttributes;
+
+typedef struct {
+    StyleAttributes     *styles;            // Indexed by StyleID
+    size_t              count;
+    size_t              capacity;
+    StyleID             *slots;             // Open hash table of StyleIDs; kNoStyle if empty
+    size_t              numSlots;           // A power of two
+} StylePool;
+
+// A run of text in one style
+//
+typedef struct {
+    size_t              start;
+    size_t              length;
+    StyleID             style;
+} StyleRun;
+
+// The styles of a text, as runs in order with no gaps between them.  Neighbouring
+// runs are never in the same style.
+//
+typedef struct {
+    StyleRun            *runs;
+    size_t              count;
+    size_t              capacity;
+    size_t              length;             // The length of the text, in UTF-16 units
+} StyleRuns;
+
+
+void StylePoolInit(StylePool *pool);
+void StylePoolDispose(StylePool *pool);
+StyleID StylePoolIntern(StylePool *pool, const StyleAttributes *attributes);
+
+static inline const StyleAttributes *StylePoolGet(const StylePool *pool, StyleID style)
+{
+    return &pool->styles[style];
+}
+
+void StyleRunsInit(StyleRuns *runs);
+void StyleRunsDispose(StyleRuns *runs);
+int StyleRunsSet(StyleRuns *runs, size_t start, size_t length, StyleID style);
+int StyleRunsEdit(StyleRuns *runs, size_t start, size_t oldLength, size_t newLength, StyleID defaultStyle);
+void StyleRunsReplaceStyle(StyleRuns *runs, StyleID oldStyle, StyleID newStyle);
+void StyleRunsMapStyles(StyleRuns *runs, const StyleID *map);
+size_t StyleRunsFind(const StyleRuns *runs, size_t offset);
+
+#endif  /* MY_STYLEPOOL_H */
@@ -0,0 +1,197 @@
+/*
+
+File: taskpool.c
+
+Abstract: A small pool of worker threads running queued tasks for
+SyntheticBoldDemo project. Uses POSIX threads only.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "taskpool.h"
+
+// What each worker thread is started with
+//
+typedef struct {
+    TaskPool            *pool;
+    int                 index;
+} WorkerInfo;
+
+
+static void *WorkerMain(void *arg)
+{
+    WorkerInfo      info = *(WorkerInfo *) arg;
+    TaskPool        *pool = info.pool;
+
+    free(arg);
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        Task        *task;
+
+        while (pool->head == NULL && ! pool->quitting)
+            pthread_cond_wait(&pool->workAvailable, &pool->lock);
+        if (pool->head == NULL) break;
+
+        task = pool->head;
+        pool->head = task->next;
+        if (pool->head == NULL) pool->tail = NULL;
+
+        pthread_mutex_unlock(&pool->lock);
+        task->proc(task->arg, info.index);
+        free(task);
+        pthread_mutex_lock(&pool->lock);
+
+        if (--pool->pending == 0)
+            pthread_cond_broadcast(&pool->allDone);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+
+// Starts the worker threads.  Returns zero on success.
+//
+int TaskPoolCreate(TaskPool *pool, int numThreads)
+{
+    int             i;
+
+    memset(pool, 0, sizeof(TaskPool));
+    if (numThreads < 1) numThreads = 1;
+
+    pool->threads = (pthread_t *) calloc(numThreads, sizeof(pthread_t));
+    if (pool->threads == NULL) return -1;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->workAvailable, NULL);
+    pthread_cond_init(&pool->allDone, NULL);
+
+    for (i = 0; i < numThreads; i++) {
+        WorkerInfo  *info = (WorkerInfo *) malloc(sizeof(WorkerInfo));
+
+        if (info == NULL) break;
+        info->pool = pool;
+        info->index = i;
+        if (pthread_create(&pool->threads[i], NULL, WorkerMain, info) != 0) {
+            free(info);
+            break;
+        }
+    }
+    pool->numThreads = i;
+
+    if (pool->numThreads == 0) {
+        TaskPoolDispose(pool);
+        return -1;
+    }
+    return 0;
+}
+
+
+// Queues a task.  Returns zero on success.
+//
+int TaskPoolSubmit(TaskPool *pool, TaskProc proc, void *arg)
+{
+    Task            *task = (Task *) malloc(sizeof(Task));
+
+    if (task == NULL) return -1;
+    task->proc = proc;
+    task->arg = arg;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail != NULL) pool->tail->next = task;
+    else pool->head = task;
+    pool->tail = task;
+    pool->pending++;
+    pthread_cond_signal(&pool->workAvailable);
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+
+// Blocks until every task submitted so far has finished
+//
+void TaskPoolWait(TaskPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->allDone, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+
+// Finishes the queued tasks, then stops the threads
+//
+void TaskPoolDispose(TaskPool *pool)
+{
+    int             i;
+
+    if (pool->threads == NULL) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quitting = 1;
+    pthread_cond_broadcast(&pool->workAvailable);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->numThreads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->allDone);
+    pthread_cond_destroy(&pool->workAvailable);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    memset(pool, 0, sizeof(TaskPool));
+}
+
+
+// One thread per online processor
+//
+int TaskPoolDefaultThreadCount(void)
+{
+    long            count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (count > 0) ? (int) count : 1;
+}
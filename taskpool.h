@@ -0,0 +1,90 @@
+/*
+
+File: taskpool.h
+
+Abstract: A small pool of worker threads for SyntheticBoldDemo project.
+Uses POSIX threads only.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_TASKPOOL_H
+#define MY_TASKPOOL_H
+
+// A fixed set of worker threads that run queued tasks in the order they were
+// submitted.  POSIX threads only, so it builds with the portable files.
+
+#include <pthread.h>
+
+// A task.  'worker' is the index of the thread running it, from 0 to
+// numThreads - 1, so tasks can use per-thread scratch space without locking.
+//
+typedef void (*TaskProc)(void *arg, int worker);
+
+typedef struct Task {
+    TaskProc            proc;
+    void                *arg;
+    struct Task         *next;
+} Task;
+
+typedef struct {
+    pthread_t           *threads;
+    int                 numThreads;
+    pthread_mutex_t     lock;
+    pthread_cond_t      workAvailable;
+    pthread_cond_t      allDone;
+    Task                *head;              // Next task to run
+    Task                *tail;
+    int                 pending;            // Queued or running
+    int                 quitting;
+} TaskPool;
+
+
+int TaskPoolCreate(TaskPool *pool, int numThreads);
+int TaskPoolSubmit(TaskPool *pool, TaskProc proc, void *arg);
+void TaskPoolWait(TaskPool *pool);
+void TaskPoolDispose(TaskPool *pool);
+int TaskPoolDefaultThreadCount(void);
+
+#endif  /* MY_TASKPOOL_H */
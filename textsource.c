@@ -0,0 +1,289 @@
+/*
+
+File: textsource.c
+
+Abstract: Memory-mapped UTF-8 and UTF-16 text files, read a
+window of paragraphs at a time.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "textsource.h"
+
+// Paragraphs are looked for this many bytes at a time
+//
+#define kTextSourceScanChunk        (64 * 1024)
+
+
+// Reads one character starting at byte offset 'at', which must be before 'end'.
+// Returns the number of bytes used; malformed input comes out as U+FFFD.
+//
+static size_t ReadCharacter(const TextSource *source, size_t at, size_t end, unsigned long *outChar)
+{
+    const unsigned char     *p = source->bytes + at;
+    size_t                  available = end - at, length, i;
+    unsigned long           c;
+
+    if (source->encoding != kTextSourceUTF8) {
+        int     big = (source->encoding == kTextSourceUTF16BE);
+
+        if (available < 2) {
+            *outChar = 0xFFFD;
+            return available;
+        }
+        *outChar = big ? ((unsigned long) p[0] << 8 | p[1]) : ((unsigned long) p[1] << 8 | p[0]);
+        return 2;
+    }
+
+    if (*p < 0x80)                  { *outChar = *p; return 1; }
+    else if ((*p & 0xE0) == 0xC0)   { c = *p & 0x1F; length = 2; }
+    else if ((*p & 0xF0) == 0xE0)   { c = *p & 0x0F; length = 3; }
+    else if ((*p & 0xF8) == 0xF0)   { c = *p & 0x07; length = 4; }
+    else                            { *outChar = 0xFFFD; return 1; }
+
+    for (i = 1; i < length; i++) {
+        if (i >= available || (p[i] & 0xC0) != 0x80) {
+            *outChar = 0xFFFD;
+            return i;
+        }
+        c = (c << 6) | (p[i] & 0x3F);
+    }
+    *outChar = (c > 0x10FFFF) ? 0xFFFD : c;
+    return length;
+}
+
+
+static int IsParagraphSeparator(unsigned long c)
+{
+    return c == '\n' || c == '\r' || c == 0x2029;
+}
+
+
+static int AddParagraph(TextSource *source, size_t offset)
+{
+    if (source->numParagraphs == source->paragraphCapacity) {
+        size_t      newCapacity = (source->paragraphCapacity == 0) ? 1024 : source->paragraphCapacity * 2;
+        size_t      *newParagraphs;
+
+        newParagraphs = (size_t *) realloc(source->paragraphs, newCapacity * sizeof(size_t));
+        if (newParagraphs == NULL) return -1;
+        source->paragraphs = newParagraphs;
+        source->paragraphCapacity = newCapacity;
+    }
+    source->paragraphs[source->numParagraphs++] = offset;
+    return 0;
+}
+
+
+// Looks for paragraph starts in the next chunk of the file.  Only the separators
+// are looked at; nothing is decoded.  Returns zero once the whole file is scanned.
+//
+static int ScanParagraphs(TextSource *source)
+{
+    size_t          at = source->scanned, end = at + kTextSourceScanChunk;
+
+    if (at >= source->size)
+        return 0;
+    if (end > source->size)
+        end = source->size;
+
+    while (at < end) {
+        unsigned long   c;
+
+        at += ReadCharacter(source, at, source->size, &c);
+        if ( ! IsParagraphSeparator(c) ) continue;
+
+        // A CR LF pair ends one paragraph, not two
+        if (c == '\r' && at < source->size) {
+            unsigned long   next;
+            size_t          used = ReadCharacter(source, at, source->size, &next);
+
+            if (next == '\n')
+                at += used;
+        }
+        if (at < source->size && AddParagraph(source, at) != 0)
+            return 0;
+    }
+    source->scanned = at;
+    return at < source->size;
+}
+
+
+// Maps a file and works out its encoding from its byte order mark.  Files without
+// one are taken to be UTF-8.  Returns zero on success.
+//
+int TextSourceOpen(TextSource *source, const char *fileName)
+{
+    struct stat     info;
+    int             file;
+    void            *bytes;
+
+    memset(source, 0, sizeof(TextSource));
+
+    file = open(fileName, O_RDONLY);
+    if (file < 0) return -1;
+    if (fstat(file, &info) != 0) {
+        close(file);
+        return -1;
+    }
+
+    // An empty file cannot be mapped, but it is still one empty paragraph
+    source->size = (size_t) info.st_size;
+    if (source->size > 0) {
+        bytes = mmap(NULL, source->size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (bytes == MAP_FAILED) return -1;
+        source->bytes = (const unsigned char *) bytes;
+        (void) madvise(bytes, source->size, MADV_SEQUENTIAL);
+    }
+    else
+        close(file);
+
+    if (source->size >= 2 && source->bytes[0] == 0xFE && source->bytes[1] == 0xFF) {
+        source->encoding = kTextSourceUTF16BE;
+        source->textStart = 2;
+    }
+    else if (source->size >= 2 && source->bytes[0] == 0xFF && source->bytes[1] == 0xFE) {
+        source->encoding = kTextSourceUTF16LE;
+        source->textStart = 2;
+    }
+    else if (source->size >= 3 && source->bytes[0] == 0xEF && source->bytes[1] == 0xBB && source->bytes[2] == 0xBF) {
+        source->encoding = kTextSourceUTF8;
+        source->textStart = 3;
+    }
+    source->scanned = source->textStart;
+
+    if (AddParagraph(source, source->textStart) != 0) {
+        TextSourceDispose(source);
+        return -1;
+    }
+    return 0;
+}
+
+
+void TextSourceDispose(TextSource *source)
+{
+    if (source->bytes != NULL)
+        munmap((void *) source->bytes, source->size);
+    free(source->paragraphs);
+    free(source->window);
+    memset(source, 0, sizeof(TextSource));
+}
+
+
+// Returns the number of paragraphs in the file.  This has to look at the whole
+// file once, so it is only for when the total is really needed.
+//
+size_t TextSourceCountParagraphs(TextSource *source)
+{
+    while (ScanParagraphs(source))
+        ;
+    return source->numParagraphs;
+}
+
+
+// Decodes up to maxParagraphs paragraphs starting with firstParagraph into UTF-16.
+// If maxUnits is not zero the window is cut off after that many units.  The text
+// stays valid until the next call or until the source is disposed.  Paragraph
+// separators are kept.  Returns in outParagraphs how many paragraphs the window
+// starts, or zero if firstParagraph is past the end of the file.
+//
+int TextSourceGetWindow(TextSource *source, size_t firstParagraph, size_t maxParagraphs, size_t maxUnits,
+                        const unsigned short **outText, size_t *outLength, size_t *outParagraphs)
+{
+    size_t          start, end, at, length = 0, needed;
+
+    *outText = NULL;
+    *outLength = 0;
+    *outParagraphs = 0;
+
+    // Find the paragraph after the window, or the end of the file
+    while (source->numParagraphs <= firstParagraph + maxParagraphs && ScanParagraphs(source))
+        ;
+    if (firstParagraph >= source->numParagraphs)
+        return 0;
+    if (maxParagraphs > source->numParagraphs - firstParagraph)
+        maxParagraphs = source->numParagraphs - firstParagraph;
+
+    start = source->paragraphs[firstParagraph];
+    end = (firstParagraph + maxParagraphs < source->numParagraphs) ? source->paragraphs[firstParagraph + maxParagraphs] : source->size;
+
+    // A byte never makes more than one UTF-16 unit, and a UTF-16 unit takes two
+    needed = (source->encoding == kTextSourceUTF8) ? end - start : (end - start + 1) / 2;
+    if (maxUnits != 0 && needed > maxUnits)
+        needed = maxUnits;
+    if (needed + 1 > source->windowCapacity) {
+        unsigned short  *newWindow = (unsigned short *) realloc(source->window, (needed + 1) * sizeof(unsigned short));
+
+        if (newWindow == NULL) return -1;
+        source->window = newWindow;
+        source->windowCapacity = needed + 1;
+    }
+
+    for (at = start; at < end && length < needed; ) {
+        unsigned long   c;
+
+        at += ReadCharacter(source, at, end, &c);
+        if (c >= 0x10000) {
+            if (length + 2 > needed) break;
+            c -= 0x10000;
+            source->window[length++] = (unsigned short) (0xD800 + (c >> 10));
+            source->window[length++] = (unsigned short) (0xDC00 + (c & 0x3FF));
+        }
+        else
+            source->window[length++] = (unsigned short) c;
+    }
+
+    *outText = source->window;
+    *outLength = length;
+    *outParagraphs = maxParagraphs;
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+
+File: textsource.h
+
+Abstract: Memory-mapped UTF-8 and UTF-16 text files, read a
+window of paragraphs at a time.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_TEXTSOURCE_H
+#define MY_TEXTSOURCE_H
+
+// Text read from a memory-mapped UTF-8 or UTF-16 file.  The file is never copied
+// or decoded as a whole: callers ask for a window of paragraphs and only that is
+// converted to UTF-16.  Paragraphs are found on demand, so opening even a very
+// large file costs nothing until it is read.  Plain C with no Carbon dependencies.
+
+#include <stddef.h>
+
+enum {
+    kTextSourceUTF8             = 0,
+    kTextSourceUTF16BE          = 1,
+    kTextSourceUTF16LE          = 2
+};
+
+typedef struct {
+    const unsigned char *bytes;             // The mapped file
+    size_t              size;
+    size_t              textStart;          // Past the byte order mark, if any
+    int                 encoding;           // One of the constants above
+    size_t              *paragraphs;        // Byte offsets of the paragraphs found so far
+    size_t              numParagraphs;
+    size_t              paragraphCapacity;
+    size_t              scanned;            // Where the search for paragraphs stopped
+    unsigned short      *window;            // The last window, decoded
+    size_t              windowCapacity;     // In UTF-16 units
+} TextSource;
+
+
+int TextSourceOpen(TextSource *source, const char *fileName);
+void TextSourceDispose(TextSource *source);
+
+size_t TextSourceCountParagraphs(TextSource *source);
+int TextSourceGetWindow(TextSource *source, size_t firstParagraph, size_t maxParagraphs, size_t maxUnits,
+                        const unsigned short **outText, size_t *outLength, size_t *outParagraphs);
+
+#endif  /* MY_TEXTSOURCE_H */
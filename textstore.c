@@ -0,0 +1,141 @@
+/*
+
+File: textstore.c
+
+Abstract: Editable text that reports the range each edit
+changes.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "textstore.h"
+
+
+void TextStoreInit(TextStore *store)
+{
+    memset(store, 0, sizeof(TextStore));
+}
+
+
+void TextStoreDispose(TextStore *store)
+{
+    free(store->text);
+    TextStoreInit(store);
+}
+
+
+// Replaces deleteLength units at start with insertLength units of text.  The range
+// is clipped to the text.  Returns zero on success; on failure the text is unchanged.
+//
+int TextStoreReplace(TextStore *store, size_t start, size_t deleteLength, const unsigned short *text, size_t insertLength, TextEdit *outEdit)
+{
+    size_t              newLength;
+
+    if (start > store->length)
+        start = store->length;
+    if (deleteLength > store->length - start)
+        deleteLength = store->length - start;
+    newLength = store->length - deleteLength + insertLength;
+
+    outEdit->start = start;
+    outEdit->oldLength = deleteLength;
+    outEdit->newLength = insertLength;
+    outEdit->moved = 0;
+
+    // Grow by half again, so a run of small insertions rarely reallocates
+    if (newLength > store->capacity) {
+        size_t          newCapacity = newLength + newLength / 2 + 16;
+        unsigned short  *newText = (unsigned short *) realloc(store->text, newCapacity * sizeof(unsigned short));
+
+        if (newText == NULL) return -1;
+        outEdit->moved = (newText != store->text);
+        store->text = newText;
+        store->capacity = newCapacity;
+    }
+
+    memmove(store->text + start + insertLength, store->text + start + deleteLength,
+            (store->length - start - deleteLength) * sizeof(unsigned short));
+    memcpy(store->text + start, text, insertLength * sizeof(unsigned short));
+    store->length = newLength;
+    return 0;
+}
+
+
+int TextStoreInsert(TextStore *store, size_t start, const unsigned short *text, size_t length, TextEdit *outEdit)
+{
+    return TextStoreReplace(store, start, 0, text, length, outEdit);
+}
+
+
+int TextStoreDelete(TextStore *store, size_t start, size_t length, TextEdit *outEdit)
+{
+    return TextStoreReplace(store, start, length, NULL, 0, outEdit);
+}
+
+
+// Changes the whole text to 'text', as the smallest single edit that does it: the
+// units the old and new text start and end with are left alone.  Setting the text
+// a field holds after the user typed one character is a one-character edit.
+//
+int TextStoreSetText(TextStore *store, const unsigned short *text, size_t length, TextEdit *outEdit)
+{
+    size_t              prefix = 0, suffix = 0, shorter;
+
+    shorter = (length < store->length) ? length : store->length;
+    while (prefix < shorter && store->text[prefix] == text[prefix])
+        prefix++;
+    while (suffix < shorter - prefix && store->text[store->length - 1 - suffix] == text[length - 1 - suffix])
+        suffix++;
+
+    // Never split a surrogate pair
+    if (prefix > 0 && (text[prefix - 1] & 0xFC00) == 0xD800)
+        prefix--;
+    if (suffix > 0 && (text[length - suffix] & 0xFC00) == 0xDC00)
+        suffix--;
+
+    return TextStoreReplace(store, prefix, store->length - prefix - suffix, text + prefix, length - prefix - suffix, outEdit);
+}
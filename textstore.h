@@ -0,0 +1,88 @@
+/*
+
+File: textstore.h
+
+Abstract: Editable text that reports the range each edit
+changes.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_TEXTSTORE_H
+#define MY_TEXTSTORE_H
+
+// Editable UTF-16 text.  Every edit reports the range it changed, so whatever was
+// made from the text only has to be redone for that range.  The text is kept in
+// one block, because ATSUI lays out text from a single buffer; the block has room
+// to spare so most edits only move the text after them.  Plain C with no Carbon
+// dependencies.
+
+#include <stddef.h>
+
+typedef struct {
+    unsigned short      *text;
+    size_t              length;             // In UTF-16 units
+    size_t              capacity;
+} TextStore;
+
+// One edit: the units from 'start' to 'start + oldLength' were replaced with
+// 'newLength' new ones.  'moved' is set if the text had to be reallocated.
+//
+typedef struct {
+    size_t              start;
+    size_t              oldLength;
+    size_t              newLength;
+    int                 moved;
+} TextEdit;
+
+
+void TextStoreInit(TextStore *store);
+void TextStoreDispose(TextStore *store);
+
+int TextStoreReplace(TextStore *store, size_t start, size_t deleteLength, const unsigned short *text, size_t insertLength, TextEdit *outEdit);
+int TextStoreInsert(TextStore *store, size_t start, const unsigned short *text, size_t length, TextEdit *outEdit);
+int TextStoreDelete(TextStore *store, size_t start, size_t length, TextEdit *outEdit);
+int TextStoreSetText(TextStore *store, const unsigned short *text, size_t length, TextEdit *outEdit);
+
+#endif  /* MY_TEXTSTORE_H */
@@ -0,0 +1,347 @@
+/*
+
+File: trace.c
+
+Abstract: Phase timers recorded per thread and written out as a
+Chrome trace.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <time.h>
+#if defined(__APPLE__)
+#include <mach/mach_time.h>
+#endif
+
+#include "trace.h"
+
+// One timed phase
+//
+typedef struct {
+    const char          *name;
+    unsigned long long  start;              // In nanoseconds
+    unsigned long long  duration;
+} TraceEvent;
+
+// The events of one thread.  Only that thread adds to it; the lock is only ever
+// contended while the trace is being written.  A buffer is kept after its thread
+// ends, so what it did is still in the next trace written, and freed once that
+// trace is written or when more than kTraceExitedBuffers others are waiting too.
+//
+typedef struct TraceBuffer {
+    TraceEvent          events[kTraceBufferEvents];
+    unsigned long       numEvents;          // Ever recorded; the last kTraceBufferEvents are kept
+    unsigned int        threadID;           // Small numbers, in the order threads first record
+    const char          *threadName;
+    int                 exited;             // Its thread has ended
+    pthread_mutex_t     lock;
+    struct TraceBuffer  *next;
+} TraceBuffer;
+
+#define kTraceExitedBuffers     16
+
+static volatile int         gTraceEnabled = 0;
+static pthread_once_t       gTraceOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t        gTraceKey;
+static pthread_key_t        gTraceNameKey;          // Set by TraceSetThreadName(), before there is a buffer
+static pthread_mutex_t      gTraceBuffersLock = PTHREAD_MUTEX_INITIALIZER;
+static TraceBuffer          *gTraceBuffers = NULL;
+static unsigned int         gNextThreadID = 1;
+static unsigned long long   gTraceOrigin = 0;
+
+
+static void FreeBuffer(TraceBuffer *buffer)
+{
+    pthread_mutex_destroy(&buffer->lock);
+    free(buffer);
+}
+
+
+// Called as a thread ends.  Its buffer stays in the list until the trace is next
+// written, but only the newest kTraceExitedBuffers of those are kept, so a program
+// that keeps starting threads does not keep their buffers forever.  A buffer
+// with nothing in it is freed at once.
+//
+static void ThreadExited(void *value)
+{
+    TraceBuffer         *exited = (TraceBuffer *) value, *buffer, **link;
+    int                 numExited = 0;
+
+    pthread_mutex_lock(&gTraceBuffersLock);
+    exited->exited = 1;
+    for (link = &gTraceBuffers; (buffer = *link) != NULL; ) {
+        if (buffer->exited && (buffer->numEvents == 0 || ++numExited > kTraceExitedBuffers)) {
+            *link = buffer->next;
+            FreeBuffer(buffer);
+        }
+        else
+            link = &buffer->next;
+    }
+    pthread_mutex_unlock(&gTraceBuffersLock);
+}
+
+
+static void CreateTraceKey(void)
+{
+    pthread_key_create(&gTraceKey, ThreadExited);
+    pthread_key_create(&gTraceNameKey, NULL);
+}
+
+
+// Returns the calling thread's buffer, making it the first time.  Returns NULL if
+// there is not enough memory.
+//
+static TraceBuffer *GetThreadBuffer(void)
+{
+    TraceBuffer         *buffer;
+
+    pthread_once(&gTraceOnce, CreateTraceKey);
+    buffer = (TraceBuffer *) pthread_getspecific(gTraceKey);
+    if (buffer != NULL) return buffer;
+
+    buffer = (TraceBuffer *) calloc(1, sizeof(TraceBuffer));
+    if (buffer == NULL) return NULL;
+    pthread_mutex_init(&buffer->lock, NULL);
+    buffer->threadName = (const char *) pthread_getspecific(gTraceNameKey);
+
+    pthread_mutex_lock(&gTraceBuffersLock);
+    buffer->threadID = gNextThreadID++;
+    buffer->next = gTraceBuffers;
+    gTraceBuffers = buffer;
+    pthread_mutex_unlock(&gTraceBuffersLock);
+
+    pthread_setspecific(gTraceKey, buffer);
+    return buffer;
+}
+
+
+// Monotonic time in nanoseconds
+//
+unsigned long long TraceGetNanoseconds(void)
+{
+#if defined(__APPLE__)
+    static mach_timebase_info_data_t    timebase;
+
+    unsigned long long                  now = mach_absolute_time();
+
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+
+    // On PowerPC the time base runs at tens of MHz with a ratio like 1000000000/33333333,
+    // so multiplying first would overflow after about ten minutes of uptime
+    return (now / timebase.denom) * timebase.numer + (now % timebase.denom) * timebase.numer / timebase.denom;
+#else
+#if defined(CLOCK_MONOTONIC)
+    struct timespec     now;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) == 0)
+        return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+    {
+        struct timeval  tv;
+
+        gettimeofday(&tv, NULL);
+        return (unsigned long long) tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+    }
+#endif
+}
+
+
+// Turns recording on or off.  Phases that began while it was off are not recorded.
+//
+void TraceSetEnabled(int enabled)
+{
+    if (enabled && gTraceOrigin == 0)
+        gTraceOrigin = TraceGetNanoseconds();
+    gTraceEnabled = enabled;
+}
+
+
+int TraceIsEnabled(void)
+{
+    return gTraceEnabled;
+}
+
+
+// Names the calling thread in the trace.  The name must be a string constant.  The
+// thread's buffer is not made until it records a phase, so naming a thread costs
+// nothing while tracing is off.
+//
+void TraceSetThreadName(const char *name)
+{
+    TraceBuffer         *buffer;
+
+    pthread_once(&gTraceOnce, CreateTraceKey);
+    pthread_setspecific(gTraceNameKey, name);
+    buffer = (TraceBuffer *) pthread_getspecific(gTraceKey);
+    if (buffer != NULL)
+        buffer->threadName = name;
+}
+
+
+void TraceBegin(TraceScope *scope, const char *name)
+{
+    if (! gTraceEnabled) {
+        scope->name = NULL;
+        return;
+    }
+    scope->name = name;
+    scope->start = TraceGetNanoseconds();
+}
+
+
+void TraceEnd(TraceScope *scope)
+{
+    unsigned long long  end;
+    TraceBuffer         *buffer;
+    TraceEvent          *event;
+
+    if (scope->name == NULL) return;
+    end = TraceGetNanoseconds();
+    buffer = GetThreadBuffer();
+    if (buffer == NULL) return;
+
+    pthread_mutex_lock(&buffer->lock);
+    event = &buffer->events[buffer->numEvents % kTraceBufferEvents];
+    event->name = scope->name;
+    event->start = scope->start;
+    event->duration = end - scope->start;
+    buffer->numEvents++;
+    pthread_mutex_unlock(&buffer->lock);
+    scope->name = NULL;
+}
+
+
+// Writes a string as a JSON string
+//
+static void WriteJSONString(FILE *file, const char *s)
+{
+    fputc('"', file);
+    for (; *s != 0; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(file, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20)
+            fprintf(file, "\\u%04x", (unsigned char) *s);
+        else
+            fputc(*s, file);
+    }
+    fputc('"', file);
+}
+
+
+// Writes every thread's buffer as complete ("X") events, with times in
+// microseconds from when tracing was first turned on.  A phase is written after
+// the phases it contains, which the viewers put back in order.  Each buffer is
+// copied out under its lock, so a thread is only held up for the copy, not the
+// writing.  The buffers of threads that have ended are freed once written.
+// Returns zero on success.
+//
+int TraceWriteChromeJSON(const char *fileName)
+{
+    FILE                *file;
+    TraceBuffer         *buffer, **link;
+    TraceEvent          *events;
+    int                 first = 1, result;
+    unsigned int        pid = (unsigned int) getpid();
+
+    events = (TraceEvent *) malloc(kTraceBufferEvents * sizeof(TraceEvent));
+    if (events == NULL) return -1;
+    file = fopen(fileName, "w");
+    if (file == NULL) {
+        free(events);
+        return -1;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    pthread_mutex_lock(&gTraceBuffersLock);
+    for (link = &gTraceBuffers; (buffer = *link) != NULL; ) {
+        unsigned long   i, numEvents, oldest;
+
+        if (buffer->threadName != NULL) {
+            fprintf(file, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":",
+                    first ? "" : ",", pid, buffer->threadID);
+            WriteJSONString(file, buffer->threadName);
+            fprintf(file, "}}");
+            first = 0;
+        }
+
+        pthread_mutex_lock(&buffer->lock);
+        numEvents = buffer->numEvents;
+        memcpy(events, buffer->events, sizeof(buffer->events));
+        pthread_mutex_unlock(&buffer->lock);
+
+        oldest = (numEvents > kTraceBufferEvents) ? numEvents - kTraceBufferEvents : 0;
+        for (i = oldest; i < numEvents; i++) {
+            const TraceEvent    *event = &events[i % kTraceBufferEvents];
+            unsigned long long  start = (event->start > gTraceOrigin) ? event->start - gTraceOrigin : 0;
+
+            fprintf(file, "%s\n{\"ph\":\"X\",\"name\":", first ? "" : ",");
+            WriteJSONString(file, event->name);
+            fprintf(file, ",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    pid, buffer->threadID, start / 1000.0, event->duration / 1000.0);
+            first = 0;
+        }
+
+        if (buffer->exited) {
+            *link = buffer->next;
+            FreeBuffer(buffer);
+        }
+        else
+            link = &buffer->next;
+    }
+    pthread_mutex_unlock(&gTraceBuffersLock);
+
+    fprintf(file, "\n]}\n");
+    result = ferror(file) ? -1 : 0;
+    if (fclose(file) != 0)
+        result = -1;
+    free(events);
+    return result;
+}
@@ -0,0 +1,84 @@
+/*
+
+File: trace.h
+
+Abstract: Phase timers recorded per thread and written out as a
+Chrome trace.
+
+Version: <1.1>
+
+Disclaimer: IMPORTANT:  This Apple software is supplied to you by Apple
+Computer, Inc. ("Apple") in consideration of your agreement to the
+following terms, and your use, installation, modification or
+redistribution of this Apple software constitutes acceptance of these
+terms.  If you do not agree with these terms, please do not use,
+install, modify or redistribute this Apple software.
+
+In consideration of your agreement to abide by the following terms, and
+subject to these terms, Apple grants you a personal, non-exclusive
+license, under Apple's copyrights in this original Apple software (the
+"Apple Software"), to use, reproduce, modify and redistribute the Apple
+Software, with or without modifications, in source and/or binary forms;
+provided that if you redistribute the Apple Software in its entirety and
+without modifications, you must retain this notice and the following
+text and disclaimers in all such redistributions of the Apple Software. 
+Neither the name, trademarks, service marks or logos of Apple Computer,
+Inc. may be used to endorse or promote products derived from the Apple
+Software without specific prior written permission from Apple.  Except
+as expressly stated in this notice, no other rights or licenses, express
+or implied, are granted by Apple herein, including but not limited to
+any patent rights that may be infringed by your derivative works or by
+other works in which the Apple Software may be incorporated.
+
+The Apple Software is provided by Apple on an "AS IS" basis.  APPLE
+MAKES NO WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION
+THE IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND
+OPERATION ALONE OR IN COMBINATION WITH YOUR PRODUCTS.
+
+IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL
+OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION,
+MODIFICATION AND/OR DISTRIBUTION OF THE APPLE SOFTWARE, HOWEVER CAUSED
+AND WHETHER UNDER THEORY OF CONTRACT, TORT (INCLUDING NEGLIGENCE),
+STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+Copyright  2004-2007 Apple Inc., All Rights Reserved
+
+*/ 
+
+#ifndef MY_TRACE_H
+#define MY_TRACE_H
+
+// Timers for the phases of drawing, printing and event handling.  A phase is timed
+// from TraceBegin() to TraceEnd() on the same thread, and recorded in a ring buffer
+// that belongs to the thread, so recording never waits for another thread.  Each
+// buffer keeps the last kTraceBufferEvents phases.  The buffers can be written out
+// at any time as Chrome trace-event JSON, which chrome://tracing and Perfetto read.
+// Tracing is off until TraceSetEnabled() turns it on; until then a timer costs one
+// test.  Plain C with POSIX threads and no Carbon dependencies.
+
+#define kTraceBufferEvents      8192
+
+// A phase being timed.  The name must be a string constant: only the pointer is
+// kept, and it is not read until the trace is written.
+//
+typedef struct {
+    const char          *name;              // NULL if tracing was off when it began
+    unsigned long long  start;              // In nanoseconds
+} TraceScope;
+
+
+void TraceSetEnabled(int enabled);
+int TraceIsEnabled(void);
+void TraceSetThreadName(const char *name);
+
+void TraceBegin(TraceScope *scope, const char *name);
+void TraceEnd(TraceScope *scope);
+
+int TraceWriteChromeJSON(const char *fileName);
+unsigned long long TraceGetNanoseconds(void);
+
+#endif  /* MY_TRACE_H */
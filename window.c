@@ -51,12 +51,24 @@ Copyright 
 #include "atsui.h"
 #include "window.h"
 #include "globals.h"
+#include "redraw.h"
+#include "trace.h"
 
 
 // This will quit the application when the main window is closed
 //
 pascal OSStatus DoWindowClose(EventHandlerCallRef nextHandler, EventRef theEvent, void *userData)
 {
+    MyRedrawStats       stats;
+
+    // "defaults write <bundle id> LogRedrawStats -bool YES" reports how well the redraws were coalesced
+    if ( CFPreferencesGetAppBooleanValue(CFSTR("LogRedrawStats"), kCFPreferencesCurrentApplication, NULL) )
+    {
+        GetRedrawStats(&stats);
+        fprintf(stderr, "redraws: %lu requested, %lu merged, %lu dropped, %lu frames\n", (unsigned long) stats.requests,
+                (unsigned long) stats.merged, (unsigned long) stats.dropped, (unsigned long) stats.frames);
+    }
+
     // If the window closes, quit
     ExitToShell();
 
@@ -72,11 +84,16 @@ pascal OSStatus DoWindowBoundsChanged(EventHandlerCallRef nextHandler, EventRef
     UInt32              eventAttributes;
 	CGContextRef		cgContext;
 	HIRect				bounds;
+	Boolean				wholeView;
+	TraceScope			scope;
+
+    TraceBegin(&scope, "DoWindowBoundsChanged");
 
     // Get the WindowRef from the event structure
     verify_noerr( GetEventParameter(theEvent, kEventParamCGContextRef, typeCGContextRef, NULL, sizeof(CGContextRef), NULL, &cgContext) );
 
 	HIViewGetBounds(gView, &bounds);
+	wholeView = CGRectContainsRect(CGContextGetClipBoundingBox(cgContext), bounds);
 	
 	// Transform HIView coordinates to Quartz coordinates
 	CGContextTranslateCTM(cgContext, 0, bounds.size.height);
@@ -85,5 +102,25 @@ pascal OSStatus DoWindowBoundsChanged(EventHandlerCallRef nextHandler, EventRef
     // Draw the current ATSUI data using this window's CGContext
     DrawATSUIStuff(cgContext, bounds);
 
+    // Let the redraw scheduler know, so it does not ask for this again
+    NoteViewDrawn(wholeView);
+
+    TraceEnd(&scope);
     return noErr;
 }
+
+
+// Marks the part of the view showing the text in the given boxes as needing to be
+// redrawn, instead of the whole view.  The damage rect is in Quartz coordinates, so
+// it is flipped back into HIView coordinates first.
+//
+void InvalidateATSUIStuffBoxes(UInt32 inBoxes)
+{
+	HIRect				bounds, damage;
+
+	HIViewGetBounds(gView, &bounds);
+	damage = GetATSUIStuffDamageRect(bounds, inBoxes);
+	damage.origin.y = bounds.size.height - (damage.origin.y + damage.size.height);
+
+	verify_noerr( HIViewSetNeedsDisplayInRect(gView, &damage, true) );
+}
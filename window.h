@@ -53,5 +53,6 @@ Copyright 
 
 pascal OSStatus DoWindowBoundsChanged(EventHandlerCallRef nextHandler, EventRef theEvent, void *userData);
 pascal OSStatus DoWindowClose(EventHandlerCallRef nextHandler, EventRef theEvent, void *userData);
+void InvalidateATSUIStuffBoxes(UInt32 inBoxes);
 
 #endif  /* MY_WINDOW_H */